@@ -0,0 +1,138 @@
+/*
+ * CacheHierarchy - simulated data cache hierarchy in front of physical memory
+ *
+ * File:   CacheHierarchy.cpp
+ */
+
+#include "CacheHierarchy.h"
+#include "Exceptions.h"
+
+namespace mem {
+
+namespace {
+
+/**
+ * IsPowerOf2 - true if value is a non-zero power of 2
+ */
+inline bool IsPowerOf2(Addr value) {
+  return value != 0 && (value & (value - 1)) == 0;
+}
+
+}  // namespace
+
+CacheHierarchy::Level::Level(const LevelConfig &config_)
+: config(config_), line_bits(0), set_mask(0) {
+  if (!IsPowerOf2(config.line_size) || config.associativity == 0
+          || config.size % (config.associativity * config.line_size) != 0) {
+    throw InvalidCacheConfigurationException(
+            "Cache size must be a multiple of associativity * line size, "
+            "with line size a power of 2");
+  }
+  Addr set_count = config.size / (config.associativity * config.line_size);
+  if (!IsPowerOf2(set_count)) {
+    throw InvalidCacheConfigurationException(
+            "Cache set count must be a power of 2");
+  }
+  while ((Addr(1) << line_bits) < config.line_size) ++line_bits;
+  set_mask = set_count - 1;
+  lines.resize(set_count * config.associativity);
+}
+
+CacheHierarchy::CacheHierarchy(const std::vector<LevelConfig> &levels_)
+: access_seq(0) {
+  if (levels_.empty()) {
+    throw InvalidCacheConfigurationException("Cache hierarchy has no levels");
+  }
+  levels.reserve(levels_.size());
+  for (const LevelConfig &config : levels_) {
+    levels.emplace_back(config);
+  }
+}
+
+std::vector<CacheHierarchy::LevelConfig> CacheHierarchy::DefaultConfig() {
+  return { LevelConfig(32 * 1024, 8),
+           LevelConfig(256 * 1024, 8),
+           LevelConfig(2 * 1024 * 1024, 16) };
+}
+
+void CacheHierarchy::Access(Addr paddress, Addr count, bool write) {
+  Addr line_bits = levels[0].line_bits;
+  Addr first = paddress >> line_bits;
+  Addr last = (paddress + count - 1) >> line_bits;
+  for (Addr line = first; line <= last; ++line) {
+    AccessLine(0, line << line_bits, write);
+  }
+}
+
+void CacheHierarchy::AccessLine(size_t level, Addr paddress, bool write) {
+  Level &lvl = levels[level];
+  Addr tag = paddress >> lvl.line_bits;
+  Line *set = &lvl.lines[(tag & lvl.set_mask) * lvl.config.associativity];
+  bool write_back = lvl.config.write_policy == WritePolicy::kWriteBack;
+  ++access_seq;
+
+  // Look for a hit, remembering the LRU (or first invalid) way as victim
+  Line *victim = set;
+  for (Addr way = 0; way < lvl.config.associativity; ++way) {
+    Line &line = set[way];
+    if (line.valid && line.tag == tag) {
+      line.last_use = access_seq;
+      line.dirty |= write && write_back;
+      ++(write ? lvl.stats.write_hits : lvl.stats.read_hits);
+      if (write && !write_back) WriteThrough(level, paddress);
+      return;
+    }
+    if (victim->valid && (!line.valid || line.last_use < victim->last_use)) {
+      victim = &line;
+    }
+  }
+
+  ++(write ? lvl.stats.write_misses : lvl.stats.read_misses);
+  if (write && !lvl.config.write_allocate) {
+    WriteThrough(level, paddress);
+    return;
+  }
+  bool has_next = level + 1 < levels.size();
+
+  // Write back the victim if dirty
+  if (victim->valid && victim->dirty) {
+    ++lvl.stats.writebacks;
+    if (has_next) AccessLine(level + 1, victim->tag << lvl.line_bits, true);
+  }
+
+  // Fill the line from the next level (write-allocate)
+  if (has_next) AccessLine(level + 1, paddress, false);
+  victim->tag = tag;
+  victim->last_use = access_seq;
+  victim->valid = true;
+  victim->dirty = write && write_back;
+  if (write && !write_back) WriteThrough(level, paddress);
+}
+
+void CacheHierarchy::WriteThrough(size_t level, Addr paddress) {
+  ++levels[level].stats.write_throughs;
+  if (level + 1 < levels.size()) AccessLine(level + 1, paddress, true);
+}
+
+void CacheHierarchy::Flush() {
+  for (size_t level = 0; level < levels.size(); ++level) {
+    Level &lvl = levels[level];
+    for (Line &line : lvl.lines) {
+      if (line.valid && line.dirty) {
+        ++lvl.stats.writebacks;
+        if (level + 1 < levels.size()) {
+          AccessLine(level + 1, line.tag << lvl.line_bits, true);
+        }
+      }
+      line = Line();
+    }
+  }
+}
+
+void CacheHierarchy::ResetStats() {
+  for (Level &lvl : levels) {
+    lvl.stats = LevelStats();
+  }
+}
+
+} // namespace mem
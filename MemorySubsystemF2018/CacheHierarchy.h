@@ -0,0 +1,211 @@
+/*
+ * CacheHierarchy - simulated data cache hierarchy in front of physical memory
+ *
+ * Models a chain of set-associative caches (for example L1, L2 and LLC) with
+ * LRU replacement. Each level is write-back or write-through, and
+ * write-allocate or no-write-allocate (by default write-back and 
+ * write-allocate). A miss at one level is filled by a read from the next
+ * level; a dirty line evicted from one level is written back to the next
+ * level (or to memory from the last level). A write-through level passes
+ * every write on to the next level and never holds dirty lines; a write 
+ * miss at a no-write-allocate level is passed on without filling a line. The levels are not inclusive: a line evicted from a lower
+ * level is not removed from the levels above it.
+ *
+ * Only tags and state are kept; data always lives in PhysicalMemory. The
+ * model exists to count hits, misses and writebacks for memory layout
+ * studies, not to change the result of any access.
+ *
+ * File:   CacheHierarchy.h
+ */
+
+#ifndef MEM_CACHEHIERARCHY_H
+#define MEM_CACHEHIERARCHY_H
+
+#include "MemoryDefs.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace mem {
+
+class CacheHierarchy {
+public:
+  /**
+   * WritePolicy - when a written line reaches the next level
+   */
+  enum class WritePolicy { 
+    kWriteBack,     // when the dirty line is evicted or flushed
+    kWriteThrough   // on every write
+  };
+  
+  /**
+   * LevelConfig - geometry and write behavior of one cache level
+   */
+  class LevelConfig {
+  public:
+    /**
+     * Constructor
+     *
+     * @param size_ total capacity in bytes
+     * @param associativity_ number of ways in each set
+     * @param line_size_ bytes per line (power of 2)
+     * @param write_policy_ write-back or write-through
+     * @param write_allocate_ true if a write miss fills the line
+     */
+    LevelConfig(Addr size_, Addr associativity_, Addr line_size_ = 64,
+                WritePolicy write_policy_ = WritePolicy::kWriteBack,
+                bool write_allocate_ = true)
+    : size(size_), associativity(associativity_), line_size(line_size_),
+      write_policy(write_policy_), write_allocate(write_allocate_) {
+    }
+
+    Addr size;                 // total capacity in bytes
+    Addr associativity;        // ways per set
+    Addr line_size;            // bytes per line
+    WritePolicy write_policy;  // write-back or write-through
+    bool write_allocate;       // true if write misses fill the line
+  };
+
+  /**
+   * LevelStats - statistics for one cache level
+   */
+  class LevelStats {
+  public:
+    // Constructor
+    LevelStats()
+    : read_hits(0),
+    read_misses(0),
+    write_hits(0),
+    write_misses(0),
+    writebacks(0),
+    write_throughs(0) {
+    }
+
+    uint64_t hits() const { return read_hits + write_hits; }
+    uint64_t misses() const { return read_misses + write_misses; }
+
+    uint64_t read_hits;     // reads (including fills for the level above) which hit
+    uint64_t read_misses;   // reads which missed
+    uint64_t write_hits;    // writes (including writebacks from above) which hit
+    uint64_t write_misses;  // writes which missed
+    uint64_t writebacks;    // dirty lines evicted or flushed to the next level
+    uint64_t write_throughs;  // writes passed on to the next level unbuffered
+  };
+
+  /**
+   * Constructor - build hierarchy from configuration of each level
+   *
+   * @param levels_ configuration of each level, closest to the CPU first
+   * @throws InvalidCacheConfigurationException if levels_ is empty, or a
+   *         level's line size or set count is not a power of 2, or its size
+   *         is not a multiple of associativity * line size
+   */
+  CacheHierarchy(const std::vector<LevelConfig> &levels_);
+
+  // Prevent copy/move/assign
+  ~CacheHierarchy() { }
+  CacheHierarchy(const CacheHierarchy &other) = delete;
+  CacheHierarchy(CacheHierarchy &&other) = delete;
+  CacheHierarchy operator=(const CacheHierarchy &other) = delete;
+  CacheHierarchy operator=(CacheHierarchy &&other) = delete;
+
+  /**
+   * DefaultConfig - a typical desktop configuration: 32 KiB 8-way L1,
+   *   256 KiB 8-way L2 and 2 MiB 16-way LLC, all with 64 byte lines
+   */
+  static std::vector<LevelConfig> DefaultConfig();
+
+  /**
+   * Access - simulate an access to a range of physical memory. Every line
+   *   of the first level touched by the range is accessed once.
+   *
+   * @param paddress physical address of first byte
+   * @param count number of bytes (> 0)
+   * @param write true for a store, false for a load
+   */
+  void Access(Addr paddress, Addr count, bool write);
+
+  /**
+   * Flush - write back all dirty lines and invalidate every level.
+   *   Writebacks are counted in the statistics.
+   */
+  void Flush();
+
+  /**
+   * get_level_count - number of cache levels
+   */
+  size_t get_level_count() const { return levels.size(); }
+
+  /**
+   * get_stats - get statistics for one level
+   *
+   * @param level index of level (0 is closest to the CPU)
+   * @param stats set to a copy of the statistics for the level
+   */
+  void get_stats(size_t level, LevelStats &stats) const {
+    stats = levels.at(level).stats;
+  }
+
+  /**
+   * ResetStats - set statistics of all levels to zero (cache contents are
+   *   not changed)
+   */
+  void ResetStats();
+
+private:
+  /**
+   * Line - tag and state of one cache line
+   */
+  class Line {
+  public:
+    Line() : tag(0), last_use(0), valid(false), dirty(false) {}
+
+    Addr tag;           // line address (physical address >> line bits)
+    uint64_t last_use;  // access sequence number, for LRU replacement
+    bool valid;
+    bool dirty;
+  };
+
+  /**
+   * Level - one cache level
+   */
+  class Level {
+  public:
+    Level(const LevelConfig &config_);
+
+    LevelConfig config;
+    Addr line_bits;         // log2 of line size
+    Addr set_mask;          // set count - 1
+    std::vector<Line> lines;  // set_count * associativity lines, set by set
+    LevelStats stats;
+  };
+
+  /**
+   * AccessLine - access the line containing an address at one level,
+   *   filling from and writing back to the following levels as needed
+   *
+   * @param level index of level
+   * @param paddress physical address within the line
+   * @param write true if the line is written
+   */
+  void AccessLine(size_t level, Addr paddress, bool write);
+  
+  /**
+   * WriteThrough - pass a write at one level on to the next level (or to
+   *   memory from the last level)
+   *
+   * @param level index of level
+   * @param paddress physical address within the line
+   */
+  void WriteThrough(size_t level, Addr paddress);
+
+  // Cache levels, closest to CPU first
+  std::vector<Level> levels;
+
+  // Access sequence number, used by LRU replacement policy as pseudo-time
+  uint64_t access_seq;
+};
+
+} // namespace mem
+
+#endif /* MEM_CACHEHIERARCHY_H */
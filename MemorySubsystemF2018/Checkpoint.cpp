@@ -0,0 +1,99 @@
+/*
+ * Checkpoint - save and restore the contents of physical memory
+ *
+ * File:   Checkpoint.cpp
+ */
+
+#include "Checkpoint.h"
+
+#include <vector>
+
+namespace mem {
+
+namespace {
+
+const uint32_t kCheckpointMagic = 0x4B43454D;  // "MECK"
+const uint32_t kCheckpointVersion = 1;
+const uint32_t kFullCheckpoint = 0;
+const uint32_t kIncrementalCheckpoint = 1;
+
+/**
+ * WriteFrames - write header and frame records
+ */
+void WriteFrames(MMU &mmu, std::ostream &out, uint32_t kind,
+                 const std::vector<Addr> &frames) {
+  uint32_t header[5] = { kCheckpointMagic, kCheckpointVersion, kind,
+                         mmu.get_frame_count(), 
+                         static_cast<uint32_t>(frames.size()) };
+  out.write(reinterpret_cast<const char*>(header), sizeof(header));
+  
+  PhysicalMemory &phys_mem = mmu.get_physical_memory();
+  std::vector<uint8_t> buffer(kPageSize);
+  for (Addr frame_address : frames) {
+    uint32_t frame = frame_address >> kPageSizeBits;
+    phys_mem.get_bytes(buffer.data(), frame_address, kPageSize);
+    out.write(reinterpret_cast<const char*>(&frame), sizeof(frame));
+    out.write(reinterpret_cast<const char*>(buffer.data()), kPageSize);
+  }
+  out.flush();
+  if (!out) {
+    throw CheckpointFormatException("Checkpoint write failed");
+  }
+}
+
+}  // namespace
+
+void WriteFullCheckpoint(MMU &mmu, std::ostream &out) {
+  std::vector<Addr> frames;
+  mmu.CollectAndClearDirty(frames);
+  frames.clear();
+  for (Addr frame = 0; frame < mmu.get_frame_count(); ++frame) {
+    frames.push_back(frame << kPageSizeBits);
+  }
+  WriteFrames(mmu, out, kFullCheckpoint, frames);
+}
+
+Addr WriteIncrementalCheckpoint(MMU &mmu, std::ostream &out) {
+  std::vector<Addr> frames;
+  mmu.CollectAndClearDirty(frames);
+  WriteFrames(mmu, out, kIncrementalCheckpoint, frames);
+  return frames.size();
+}
+
+Addr RestoreCheckpoint(MMU &mmu, std::istream &in) {
+  uint32_t header[5];
+  if (!in.read(reinterpret_cast<char*>(header), sizeof(header))
+          || header[0] != kCheckpointMagic || header[1] != kCheckpointVersion
+          || header[2] > kIncrementalCheckpoint) {
+    throw CheckpointFormatException("Not a memory checkpoint");
+  }
+  if (header[3] != mmu.get_frame_count()) {
+    throw CheckpointFormatException(
+            "Checkpoint was written for a different memory size");
+  }
+  
+  PhysicalMemory &phys_mem = mmu.get_physical_memory();
+  std::vector<uint8_t> buffer(kPageSize);
+  for (uint32_t i = 0; i < header[4]; ++i) {
+    uint32_t frame;
+    if (!in.read(reinterpret_cast<char*>(&frame), sizeof(frame))
+            || !in.read(reinterpret_cast<char*>(buffer.data()), kPageSize)) {
+      throw CheckpointFormatException("Checkpoint is truncated");
+    }
+    if (frame >= mmu.get_frame_count()) {
+      throw CheckpointFormatException("Checkpoint frame number out of range");
+    }
+    phys_mem.put_bytes(frame << kPageSizeBits, kPageSize, buffer.data());
+  }
+  
+  // Restored page tables may no longer match the cached translations
+  mmu.FlushTLB();
+  
+  if (header[2] == kFullCheckpoint) {
+    std::vector<Addr> discard;
+    mmu.CollectAndClearDirty(discard);
+  }
+  return header[4];
+}
+
+} // namespace mem
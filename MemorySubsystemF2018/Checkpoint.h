@@ -0,0 +1,65 @@
+/*
+ * Checkpoint - save and restore the contents of physical memory
+ *
+ * A full checkpoint holds every page frame. An incremental checkpoint holds
+ * only the frames written since the previous checkpoint (full or 
+ * incremental), found from the MMU dirty frame bitmap. Restoring a full 
+ * checkpoint followed by each later incremental checkpoint, in order, 
+ * recreates memory as it was when the last one was written.
+ *
+ * Stream format (host byte order): a header of five 32 bit words (magic,
+ * version, kind, frame count, record count), followed by one record per
+ * frame: the frame number (32 bits) and kPageSize bytes of contents.
+ *
+ * Page tables and MMU state are saved only as far as they live in physical
+ * memory; the PMCBs, TLB and handlers are not part of a checkpoint.
+ *
+ * File:   Checkpoint.h
+ */
+
+#ifndef MEM_CHECKPOINT_H
+#define MEM_CHECKPOINT_H
+
+#include "MMU.h"
+
+#include <istream>
+#include <ostream>
+
+namespace mem {
+
+/**
+ * WriteFullCheckpoint - write all page frames, and mark all frames clean
+ *
+ * @param mmu memory to save
+ * @param out stream to write (opened in binary mode)
+ * @throws CheckpointFormatException if the stream fails
+ */
+void WriteFullCheckpoint(MMU &mmu, std::ostream &out);
+
+/**
+ * WriteIncrementalCheckpoint - write the page frames written since the last
+ *   checkpoint, and mark all frames clean
+ *
+ * @param mmu memory to save
+ * @param out stream to write (opened in binary mode)
+ * @return number of frames written
+ * @throws CheckpointFormatException if the stream fails
+ */
+Addr WriteIncrementalCheckpoint(MMU &mmu, std::ostream &out);
+
+/**
+ * RestoreCheckpoint - copy the frames of a full or incremental checkpoint 
+ *   into memory, and flush the TLB. Restoring a full checkpoint also marks
+ *   all frames clean, so the next incremental checkpoint is relative to it.
+ *
+ * @param mmu memory to restore
+ * @param in stream to read (opened in binary mode)
+ * @return number of frames restored
+ * @throws CheckpointFormatException if the stream is not a checkpoint, was
+ *         written for a different number of frames, or is truncated
+ */
+Addr RestoreCheckpoint(MMU &mmu, std::istream &in);
+
+} // namespace mem
+
+#endif /* MEM_CHECKPOINT_H */
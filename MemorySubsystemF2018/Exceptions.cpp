@@ -38,4 +38,14 @@ PhysicalMemoryBoundsException::PhysicalMemoryBoundsException(Addr address) {
   SetDescription(description_stream.str());
 }
 
+/**
+ * Constructor for PhysicalMemoryCorruptFrameException
+ */
+PhysicalMemoryCorruptFrameException::PhysicalMemoryCorruptFrameException(Addr address) {
+  std::stringstream description_stream;
+  description_stream << "PhysicalMemoryCorruptFrameException, frame starting at 0x" 
+          << std::hex << address;
+  SetDescription(description_stream.str());
+}
+
 } // namespace mem
\ No newline at end of file
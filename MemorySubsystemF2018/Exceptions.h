@@ -131,6 +131,37 @@ public:
 
 /******************************************************************************/
 
+/**
+ * Exception for a compressed frame which could not be decompressed
+ */
+class PhysicalMemoryCorruptFrameException : public MemorySubsystemException {
+public:
+  /**
+   * Constructor
+   * 
+   * @param address of start of corrupt frame
+   */
+  PhysicalMemoryCorruptFrameException(Addr address);
+};
+
+/******************************************************************************/
+
+/**
+ * PhysicalMemoryBankConfigurationException - memory bank layout is not 
+ *   valid, or a node number is out of range
+ */
+class PhysicalMemoryBankConfigurationException : public MemorySubsystemException {
+public:
+  /**
+   * Constructor with description
+   */
+  PhysicalMemoryBankConfigurationException(const std::string &description_) {
+    SetDescription(description_);
+  }
+};
+
+/******************************************************************************/
+
 /**
  * InvalidMMUOperationException - usually caused by an error in the program
  *   calling the MMU.
@@ -150,6 +181,37 @@ public:
   }
 };
 
+/******************************************************************************/
+
+/**
+ * InvalidCacheConfigurationException - cache hierarchy geometry is not valid
+ */
+class InvalidCacheConfigurationException : public MemorySubsystemException {
+public:
+  /**
+   * Constructor with description
+   */
+  InvalidCacheConfigurationException(const std::string &description_) {
+    SetDescription(description_);
+  }
+};
+
+/******************************************************************************/
+
+/**
+ * CheckpointFormatException - checkpoint stream is not a valid checkpoint 
+ *   for this memory, or could not be read or written
+ */
+class CheckpointFormatException : public MemorySubsystemException {
+public:
+  /**
+   * Constructor with description
+   */
+  CheckpointFormatException(const std::string &description_) {
+    SetDescription(description_);
+  }
+};
+
 } // namespace mem
 
 #endif /* MEM_EXCEPTIONS_H */
\ No newline at end of file
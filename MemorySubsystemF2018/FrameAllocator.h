@@ -0,0 +1,44 @@
+/*
+ * FrameAllocator - interface to a page frame allocator
+ *
+ * The MMU uses a frame allocator to supply frames for pages it maps itself
+ * (demand-zero pages of anonymous regions). The OS provides the allocator by
+ * deriving from FrameAllocator, typically as an adapter over its own
+ * physical memory manager.
+ *
+ * File:   FrameAllocator.h
+ */
+
+#ifndef MEM_FRAMEALLOCATOR_H
+#define MEM_FRAMEALLOCATOR_H
+
+#include "MemoryDefs.h"
+
+namespace mem {
+
+class FrameAllocator {
+public:
+  virtual ~FrameAllocator() {}
+
+  /**
+   * Allocate - allocate one page frame. The MMU initializes the frame
+   *   contents itself.
+   *
+   * @param frame_address set to the physical address of the frame
+   * @return true if a frame was allocated, false if none are free
+   */
+  virtual bool Allocate(Addr &frame_address) = 0;  // derived class must override
+
+  /**
+   * Free - return a frame previously allocated
+   *
+   * @param frame_address physical address of the frame
+   */
+  virtual void Free(Addr frame_address) = 0;  // derived class must override
+protected:
+  FrameAllocator() {}  // protected - only a derived class object can be created
+};
+
+} // namespace mem
+
+#endif /* MEM_FRAMEALLOCATOR_H */
@@ -0,0 +1,168 @@
+/*
+ * FrameCodec - compression of page frame contents
+ *
+ * File:   FrameCodec.cpp
+ */
+
+#include "FrameCodec.h"
+
+#include <array>
+#include <cstring>
+
+namespace {
+
+const mem::Addr kMinMatch = 4;       // shortest match encoded
+const int kHashBits = 12;            // log2 of hash table size
+const uint8_t kMaxNibble = 15;       // length field value meaning "more bytes"
+
+/**
+ * Read32 - unaligned 32 bit load
+ */
+inline uint32_t Read32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+/**
+ * PutLength - append extra length bytes for a length field which
+ *   overflowed its 4 bit nibble
+ *
+ * @param len remaining length (after subtracting kMaxNibble)
+ * @param dest output buffer
+ */
+void PutLength(mem::Addr len, std::vector<uint8_t> &dest) {
+  while (len >= 255) {
+    dest.push_back(255);
+    len -= 255;
+  }
+  dest.push_back(static_cast<uint8_t>(len));
+}
+
+/**
+ * GetLength - read extra length bytes
+ *
+ * @param ip input position, advanced past the length bytes
+ * @param end end of input
+ * @param len length to add to
+ * @return false if input ended before the length was complete
+ */
+bool GetLength(const uint8_t *&ip, const uint8_t *end, mem::Addr &len) {
+  uint8_t b;
+  do {
+    if (ip >= end) return false;
+    b = *ip++;
+    len += b;
+  } while (b == 255);
+  return true;
+}
+
+/**
+ * PutSequence - append a record of literals followed by an optional match
+ *
+ * @param literals start of literal bytes
+ * @param lit_len number of literal bytes
+ * @param offset distance back to match (ignored if match_len == 0)
+ * @param match_len length of match, or 0 for the final record
+ * @param dest output buffer
+ */
+void PutSequence(const uint8_t *literals, mem::Addr lit_len,
+                 mem::Addr offset, mem::Addr match_len,
+                 std::vector<uint8_t> &dest) {
+  mem::Addr match_code = match_len ? match_len - kMinMatch : 0;
+  uint8_t token = (lit_len < kMaxNibble ? lit_len : kMaxNibble) << 4;
+  token |= (match_code < kMaxNibble ? match_code : kMaxNibble);
+  dest.push_back(token);
+  if (lit_len >= kMaxNibble) PutLength(lit_len - kMaxNibble, dest);
+  dest.insert(dest.end(), literals, literals + lit_len);
+  if (match_len) {
+    dest.push_back(offset & 0xFF);
+    dest.push_back(offset >> 8);
+    if (match_code >= kMaxNibble) PutLength(match_code - kMaxNibble, dest);
+  }
+}
+
+}  // namespace
+
+namespace mem {
+
+void CompressFrame(const uint8_t *src, Addr src_len, std::vector<uint8_t> &dest) {
+  dest.clear();
+  dest.reserve(src_len / 2);
+
+  // Most recent position (+1, so that 0 means empty) of each hashed 4 byte
+  // sequence
+  std::array<uint32_t, 1 << kHashBits> table;
+  table.fill(0);
+
+  Addr ip = 0;      // current input position
+  Addr anchor = 0;  // start of pending literals
+  while (ip + kMinMatch <= src_len) {
+    uint32_t seq = Read32(src + ip);
+    uint32_t hash = (seq * 2654435761U) >> (32 - kHashBits);
+    Addr ref = table[hash];
+    table[hash] = ip + 1;
+    if (ref != 0 && Read32(src + ref - 1) == seq) {
+      // Extend match as far as possible
+      Addr match = ref - 1;
+      Addr match_len = kMinMatch;
+      while (ip + match_len < src_len
+              && src[match + match_len] == src[ip + match_len]) {
+        ++match_len;
+      }
+      PutSequence(src + anchor, ip - anchor, ip - match, match_len, dest);
+      ip += match_len;
+      anchor = ip;
+    } else {
+      ++ip;
+    }
+  }
+
+  // Final record holds the remaining literals
+  PutSequence(src + anchor, src_len - anchor, 0, 0, dest);
+}
+
+bool DecompressFrame(const uint8_t *src, Addr src_len,
+                     uint8_t *dest, Addr dest_len) {
+  const uint8_t *ip = src;
+  const uint8_t *ip_end = src + src_len;
+  Addr op = 0;  // output position
+
+  while (ip < ip_end) {
+    uint8_t token = *ip++;
+
+    // Literals
+    Addr lit_len = token >> 4;
+    if (lit_len == kMaxNibble && !GetLength(ip, ip_end, lit_len)) return false;
+    if (lit_len > static_cast<Addr>(ip_end - ip) || lit_len > dest_len - op) {
+      return false;
+    }
+    memcpy(dest + op, ip, lit_len);
+    ip += lit_len;
+    op += lit_len;
+    if (ip == ip_end) break;  // final record
+
+    // Match
+    if (ip_end - ip < 2) return false;
+    Addr offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    Addr match_len = token & kMaxNibble;
+    if (match_len == kMaxNibble && !GetLength(ip, ip_end, match_len)) {
+      return false;
+    }
+    match_len += kMinMatch;
+    if (offset == 0 || offset > op || match_len > dest_len - op) return false;
+
+    // Copy forward one byte at a time, since the match may overlap the
+    // bytes being produced (e.g. a run of one repeated value)
+    const uint8_t *match = dest + op - offset;
+    for (Addr i = 0; i < match_len; ++i) {
+      dest[op + i] = match[i];
+    }
+    op += match_len;
+  }
+
+  return op == dest_len;
+}
+
+}  // namespace mem
@@ -0,0 +1,48 @@
+/*
+ * FrameCodec - compression of page frame contents
+ *
+ * A small LZ77 codec (in the style of the LZ4 block format) used to store
+ * cold page frames compactly on the host. It is tuned for page-sized inputs:
+ * match offsets are 16 bits and the compressor keeps a 4096 entry hash table
+ * of recent positions. Compressed data is a sequence of records, each with
+ * a token byte (upper 4 bits literal count, lower 4 bits match length - 4),
+ * optional extra length bytes, the literal bytes, and a 2 byte offset. The
+ * last record contains only literals.
+ *
+ * File:   FrameCodec.h
+ */
+
+#ifndef MEM_FRAMECODEC_H
+#define MEM_FRAMECODEC_H
+
+#include "MemoryDefs.h"
+
+#include <vector>
+
+namespace mem {
+
+/**
+ * CompressFrame - compress a block of bytes
+ *
+ * @param src data to compress
+ * @param src_len number of bytes in src (at most 64 KiB)
+ * @param dest replaced with compressed data
+ */
+void CompressFrame(const uint8_t *src, Addr src_len, std::vector<uint8_t> &dest);
+
+/**
+ * DecompressFrame - expand data produced by CompressFrame
+ *
+ * @param src compressed data
+ * @param src_len number of bytes of compressed data
+ * @param dest buffer for decompressed data
+ * @param dest_len size of dest; must equal the original length
+ * @return true if exactly dest_len bytes were decoded, false if the
+ *         compressed data is malformed
+ */
+bool DecompressFrame(const uint8_t *src, Addr src_len,
+                     uint8_t *dest, Addr dest_len);
+
+}  // namespace mem
+
+#endif /* MEM_FRAMECODEC_H */
@@ -9,6 +9,8 @@
 
 #include "Exceptions.h"
 
+#include <algorithm>
+
 namespace {
  
 /**
@@ -26,11 +28,15 @@ public:
 
 namespace mem {
 
-MMU::MMU(Addr frame_count_, size_t tlb_size)
+MMU::MMU(Addr frame_count_, size_t tlb_size, PhysicalMemory::Backing backing)
 : frame_count(frame_count_),
-  phys_mem(frame_count_ * kPageSize),
+  phys_mem(frame_count_ * kPageSize, backing),
   pmcb(&kernel_pmcb),
   tlb(std::make_unique<TLB>(tlb_size)),
+  watches(kPageTableEntries),
+  watched_page(false),
+  demand_zero_faults(0),
+  dirty_frames((frame_count_ + 63) / 64, 0),
   virtual_mode(false),
   fault_handler_active(false),
   page_fault_handler(std::make_shared<DefaultHandler>()),
@@ -38,11 +44,15 @@ MMU::MMU(Addr frame_count_, size_t tlb_size)
 {
 }
 
-MMU::MMU(Addr frame_count_) 
+MMU::MMU(Addr frame_count_, PhysicalMemory::Backing backing) 
 : frame_count(frame_count_), 
-  phys_mem(frame_count_ * kPageSize),
+  phys_mem(frame_count_ * kPageSize, backing),
   pmcb(&kernel_pmcb),
   tlb(nullptr),
+  watches(kPageTableEntries),
+  watched_page(false),
+  demand_zero_faults(0),
+  dirty_frames((frame_count_ + 63) / 64, 0),
   virtual_mode(false),
   fault_handler_active(false),
   page_fault_handler(std::make_shared<DefaultHandler>()),
@@ -64,6 +74,8 @@ bool MMU::ToPhysical(Addr vaddress, Addr& paddress, bool write_op) {
   // If not in virtual memory mode, physical == virtual
   if (!virtual_mode) {
     paddress = vaddress;
+    if (write_op) MarkDirty(paddress);
+    watched_page = false;
     return true;
   }
   
@@ -91,11 +103,16 @@ bool MMU::ToPhysical(Addr vaddress, Addr& paddress, bool write_op) {
     // Get entry from page table
     Addr pt_index = (vaddress >> kPageSizeBits) & kPageTableIndexMask;
     pt_entry_addr = pmcb->page_table_base + pt_index * sizeof(PageTableEntry);
-    phys_mem.get_32(&pt_entry, pt_entry_addr);
+    CheckFrame(pt_entry_addr);
+    CacheAccess(pt_entry_addr, sizeof(PageTableEntry), false);
+    phys_mem.get_32_unchecked(&pt_entry, pt_entry_addr);
   }
 
-  // Check for page present; if not, call page fault handler
-  if ((pt_entry & kPTE_PresentMask) == 0) {
+  // Check for page present; if not, map it if demand-zero, otherwise call 
+  // page fault handler
+  if ((pt_entry & kPTE_PresentMask) == 0 
+          && ((pt_entry & kPTE_DemandZeroMask) == 0 
+              || !MapDemandZero(pt_entry_addr, pt_entry))) {
     PMCB *saved_pmcb = pmcb;
     pmcb = &kernel_pmcb;  // switch to kernel mode
     if (tlb) tlb->Flush();
@@ -111,30 +128,49 @@ bool MMU::ToPhysical(Addr vaddress, Addr& paddress, bool write_op) {
     }
     
     // Re-read page table entry and recheck state
-    phys_mem.get_32(&pt_entry, pt_entry_addr);
+    CacheAccess(pt_entry_addr, sizeof(PageTableEntry), false);
+    phys_mem.get_32_unchecked(&pt_entry, pt_entry_addr);
     if ((pt_entry & kPTE_PresentMask) == 0) {  // if still missing
       throw InvalidMMUOperationException(
               "Page fault handler returned true but page not present");
     }
   }
   
-  // If write operation and page not writable, call fault hander
+  // If write operation and page not writable, copy if copy-on-write, 
+  // otherwise call fault hander
   if (write_op && (pt_entry & kPTE_WritableMask) == 0) {
-    PMCB &saved_pmcb = *pmcb;
-    pmcb = &kernel_pmcb;  // switch to kernel mode
-    bool retry = write_permission_fault_handler->Run(saved_pmcb);
-    pmcb = &saved_pmcb;
-    if (!retry) {
-      return false;
-    }
-    if ((pt_entry & kPTE_WritableMask) == 0) { // if still protected
-      throw InvalidMMUOperationException(
-            "Write permission fault handler returned true but page still protected");
+    if ((pt_entry & kPTE_CopyOnWriteMask) != 0
+            && ResolveCopyOnWrite(vaddress, pt_entry_addr, pt_entry)) {
+      from_tlb = false;  // new entry must be written back and cached
+    } else {
+      PMCB &saved_pmcb = *pmcb;
+      pmcb = &kernel_pmcb;  // switch to kernel mode
+      if (tlb) tlb->Flush();
+      bool retry = write_permission_fault_handler->Run(saved_pmcb);
+      pmcb = &saved_pmcb;
+      if (tlb) tlb->Flush();
+      if (!retry) {
+        return false;
+      }
+
+      // Re-read page table entry (the handler may have changed it)
+      Addr pt_index = (vaddress >> kPageSizeBits) & kPageTableIndexMask;
+      pt_entry_addr = pmcb->page_table_base + pt_index * sizeof(PageTableEntry);
+      CheckFrame(pt_entry_addr);
+      CacheAccess(pt_entry_addr, sizeof(PageTableEntry), false);
+      phys_mem.get_32_unchecked(&pt_entry, pt_entry_addr);
+      from_tlb = false;
+      if ((pt_entry & kPTE_WritableMask) == 0) { // if still protected
+        throw InvalidMMUOperationException(
+              "Write permission fault handler returned true but page still protected");
+      }
     }
   }
   
   // If address not from TLB, set accessed and (optionally) modified flags 
-  // in 2nd level table, then update the TLB
+  // in 2nd level table, then update the TLB. Watched pages are never in the
+  // TLB, so only this path needs to look for watchpoints.
+  watched_page = false;
   if (!from_tlb) {
     PageTableEntry new_pt_entry = pt_entry | kPTE_AccessedMask
             | (write_op ? kPTE_ModifiedMask : 0);
@@ -142,18 +178,22 @@ bool MMU::ToPhysical(Addr vaddress, Addr& paddress, bool write_op) {
     // If changed, write back to page table
     if (new_pt_entry != pt_entry) {
       pt_entry = new_pt_entry;
-      phys_mem.put_bytes(pt_entry_addr, sizeof(PageTableEntry),
-                        reinterpret_cast<uint8_t*>(&pt_entry));
+      CacheAccess(pt_entry_addr, sizeof(PageTableEntry), true);
+      phys_mem.put_32_unchecked(pt_entry_addr, pt_entry);
+      MarkDirty(pt_entry_addr);
     }
     
-    // Update TLB
-    if (tlb) {
+    // Update TLB, unless page is watched
+    watched_page = !watches.empty() && watches.IsWatchedPage(
+            (vaddress >> kPageSizeBits) & kPageTableIndexMask);
+    if (tlb && !watched_page) {
       tlb->Cache(vaddress, pt_entry);
     }
   }
   
   // Page is mapped, return physical
   paddress = (pt_entry & kPTE_FrameMask) | (vaddress & kPageOffsetMask);
+  if (write_op) MarkDirty(paddress);
   
   return true;
 }
@@ -172,22 +212,33 @@ bool MMU::Execute() {
                pmcb->operation_state == PMCB::WRITE_OP)) {
       return false;
     }
+    bool watched = watched_page;
     
     // Determine remaining count within current page
     Addr count_in_page = std::min(pmcb->remaining_count,
                                   kPageSize - (pmcb->next_vaddress & kPageOffsetMask));
     
-    // Transfer bytes
+    // Transfer bytes. The transfer stays within one page frame, so checking
+    // that the frame exists validates the whole range.
+    CheckFrame(next_paddress);
+    CacheAccess(next_paddress, count_in_page, 
+                pmcb->operation_state == PMCB::WRITE_OP);
     if (pmcb->operation_state == PMCB::READ_OP) {
-      phys_mem.get_bytes(pmcb->user_buffer, next_paddress, count_in_page);
+      phys_mem.get_bytes_unchecked(pmcb->user_buffer, next_paddress, count_in_page);
     } else {  // write
-      phys_mem.put_bytes(next_paddress, count_in_page, pmcb->user_buffer);
+      phys_mem.put_bytes_unchecked(next_paddress, count_in_page, pmcb->user_buffer);
     }
     
     // Advance state of transfer
+    Addr transfer_vaddress = pmcb->next_vaddress;
     pmcb->next_vaddress += count_in_page;
     pmcb->user_buffer += count_in_page;
     pmcb->remaining_count -= count_in_page;
+    
+    if (watched) {
+      CheckWatch(transfer_vaddress, count_in_page, 
+                 pmcb->operation_state == PMCB::WRITE_OP);
+    }
   }
   
   return true;
@@ -217,6 +268,88 @@ bool MMU::put_bytes(Addr vaddress, Addr count, void *src) {
   return Execute();
 }
 
+uint8_t *MMU::TranslateAtomic(Addr vaddress, Addr size) {
+  if ((vaddress & (size - 1)) != 0) {
+    throw InvalidMMUOperationException(
+            "Atomic operation address not naturally aligned");
+  }
+  std::lock_guard<std::recursive_mutex> lock(atomic_mutex);
+  
+  // Record the address in the PMCB so a fault handler can find it. An 
+  // aborted atomic operation can't be resumed by Execute, so the PMCB is
+  // left with no operation pending.
+  InitMemoryOperation(PMCB::WRITE_OP, vaddress, size, nullptr);
+  Addr paddress;
+  bool mapped = ToPhysical(vaddress, paddress, true);
+  bool watched = watched_page;
+  pmcb->operation_state = PMCB::NONE;
+  if (!mapped) {
+    return nullptr;
+  }
+  CheckFrame(paddress);
+  CacheAccess(paddress, size, true);
+  if (watched) {
+    CheckWatch(vaddress, size, false);
+    CheckWatch(vaddress, size, true);
+  }
+  return phys_mem.get_atomic_pointer_unchecked(paddress, size);
+}
+
+bool MMU::atomic_cas32(Addr vaddress, uint32_t expected, uint32_t desired,
+                       uint32_t &old_value) {
+  uint32_t *word = reinterpret_cast<uint32_t*>(
+          TranslateAtomic(vaddress, sizeof(uint32_t)));
+  if (word == nullptr) return false;
+  // On failure, expected is updated to the current value of the word
+  __atomic_compare_exchange_n(word, &expected, desired, false,
+                              __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+  old_value = expected;
+  return true;
+}
+
+bool MMU::atomic_cas64(Addr vaddress, uint64_t expected, uint64_t desired,
+                       uint64_t &old_value) {
+  uint64_t *word = reinterpret_cast<uint64_t*>(
+          TranslateAtomic(vaddress, sizeof(uint64_t)));
+  if (word == nullptr) return false;
+  __atomic_compare_exchange_n(word, &expected, desired, false,
+                              __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+  old_value = expected;
+  return true;
+}
+
+bool MMU::atomic_fetch_add32(Addr vaddress, uint32_t addend, uint32_t &old_value) {
+  uint32_t *word = reinterpret_cast<uint32_t*>(
+          TranslateAtomic(vaddress, sizeof(uint32_t)));
+  if (word == nullptr) return false;
+  old_value = __atomic_fetch_add(word, addend, __ATOMIC_SEQ_CST);
+  return true;
+}
+
+bool MMU::atomic_fetch_add64(Addr vaddress, uint64_t addend, uint64_t &old_value) {
+  uint64_t *word = reinterpret_cast<uint64_t*>(
+          TranslateAtomic(vaddress, sizeof(uint64_t)));
+  if (word == nullptr) return false;
+  old_value = __atomic_fetch_add(word, addend, __ATOMIC_SEQ_CST);
+  return true;
+}
+
+bool MMU::atomic_exchange32(Addr vaddress, uint32_t value, uint32_t &old_value) {
+  uint32_t *word = reinterpret_cast<uint32_t*>(
+          TranslateAtomic(vaddress, sizeof(uint32_t)));
+  if (word == nullptr) return false;
+  old_value = __atomic_exchange_n(word, value, __ATOMIC_SEQ_CST);
+  return true;
+}
+
+bool MMU::atomic_exchange64(Addr vaddress, uint64_t value, uint64_t &old_value) {
+  uint64_t *word = reinterpret_cast<uint64_t*>(
+          TranslateAtomic(vaddress, sizeof(uint64_t)));
+  if (word == nullptr) return false;
+  old_value = __atomic_exchange_n(word, value, __ATOMIC_SEQ_CST);
+  return true;
+}
+
 void MMU::enter_virtual_mode(const PMCB &kernel_mode_pmcb) {
   if (virtual_mode) {
     throw InvalidMMUOperationException(
@@ -248,6 +381,286 @@ void MMU::get_TLBStats(TLB::TLBStats& stats) {
   }
 }
 
+void MMU::MapAnonymous(Addr vaddress, Addr length, bool writable) {
+  if (!virtual_mode) {
+    throw InvalidMMUOperationException("MapAnonymous invalid in physical mode");
+  }
+  if ((vaddress & kPageOffsetMask) != 0 || vaddress >= kVirtAddrSpaceSize
+          || length > kVirtAddrSpaceSize - vaddress) {
+    throw InvalidMMUOperationException(
+            "Anonymous region not page aligned or exceeds address space size");
+  }
+  Addr first_index = vaddress >> kPageSizeBits;
+  Addr page_count = (length + kPageSize - 1) >> kPageSizeBits;
+  Addr pt_base = pmcb->page_table_base;
+  CheckFrame(pt_base);
+  if (page_count == 0) return;
+  Addr entries_addr = pt_base + first_index * sizeof(PageTableEntry);
+  Addr entries_size = page_count * sizeof(PageTableEntry);
+  
+  // Check the whole region before changing anything
+  PageTableEntry pt_entry;
+  CacheAccess(entries_addr, entries_size, false);
+  for (Addr i = first_index; i < first_index + page_count; ++i) {
+    phys_mem.get_32_unchecked(&pt_entry, pt_base + i * sizeof(PageTableEntry));
+    if ((pt_entry & (kPTE_PresentMask | kPTE_DemandZeroMask)) != 0) {
+      throw InvalidMMUOperationException(
+              "Anonymous region overlaps a mapped page");
+    }
+  }
+  
+  pt_entry = kPTE_DemandZeroMask | (writable ? kPTE_WritableMask : 0);
+  for (Addr i = first_index; i < first_index + page_count; ++i) {
+    phys_mem.put_32_unchecked(pt_base + i * sizeof(PageTableEntry), pt_entry);
+  }
+  CacheAccess(entries_addr, entries_size, true);
+  MarkDirty(pt_base);
+}
+
+void MMU::Protect(Addr vaddress, Addr pages, bool writable) {
+  if (!virtual_mode) {
+    throw InvalidMMUOperationException("Protect invalid in physical mode");
+  }
+  if ((vaddress & kPageOffsetMask) != 0 || vaddress >= kVirtAddrSpaceSize
+          || pages > kPageTableEntries - (vaddress >> kPageSizeBits)) {
+    throw InvalidMMUOperationException(
+            "Protected range not page aligned or exceeds address space size");
+  }
+  if (pages == 0) return;
+  Addr first_index = vaddress >> kPageSizeBits;
+  Addr pt_base = pmcb->page_table_base;
+  CheckFrame(pt_base);
+  
+  // The page table is one frame, so the range is a single transfer
+  PageTable page_table;
+  Addr entries_addr = pt_base + first_index * sizeof(PageTableEntry);
+  Addr entries_size = pages * sizeof(PageTableEntry);
+  phys_mem.get_bytes(reinterpret_cast<uint8_t*>(page_table.data()), 
+                     entries_addr, entries_size);
+  CacheAccess(entries_addr, entries_size, false);
+  
+  bool changed = false;
+  for (Addr i = 0; i < pages; ++i) {
+    PageTableEntry pt_entry = page_table[i];
+    if ((pt_entry & (kPTE_PresentMask | kPTE_DemandZeroMask)) == 0) continue;
+    if (!writable) {
+      pt_entry &= ~(kPTE_WritableMask | kPTE_CopyOnWriteMask);
+    } else if ((pt_entry & kPTE_CopyOnWriteMask) == 0) {
+      if ((pt_entry & kPTE_PresentMask) != 0
+              && cow_share_count.count(pt_entry & kPTE_FrameMask) != 0) {
+        pt_entry |= kPTE_CopyOnWriteMask;
+      } else {
+        pt_entry |= kPTE_WritableMask;
+      }
+    }
+    if (pt_entry != page_table[i]) {
+      page_table[i] = pt_entry;
+      changed = true;
+      if (tlb) tlb->Invalidate((first_index + i) << kPageSizeBits);
+    }
+  }
+  
+  if (changed) {
+    phys_mem.put_bytes(entries_addr, entries_size, 
+                       reinterpret_cast<const uint8_t*>(page_table.data()));
+    CacheAccess(entries_addr, entries_size, true);
+    MarkDirty(pt_base);
+  }
+}
+
+bool MMU::MapDemandZero(Addr pt_entry_addr, PageTableEntry &pt_entry) {
+  Addr frame;
+  if (!frame_allocator || !frame_allocator->Allocate(frame)) {
+    return false;
+  }
+  CheckAllocatedFrame(frame);
+  phys_mem.ZeroFrame(frame);
+  CacheAccess(frame, kPageSize, true);
+  MarkDirty(frame);
+  ++demand_zero_faults;
+  
+  // Keep the writable bit; the accessed and modified bits are set by the
+  // caller for this access
+  pt_entry = (frame & kPTE_FrameMask) | kPTE_PresentMask 
+          | (pt_entry & kPTE_WritableMask);
+  CacheAccess(pt_entry_addr, sizeof(PageTableEntry), true);
+  phys_mem.put_32_unchecked(pt_entry_addr, pt_entry);
+  MarkDirty(pt_entry_addr);
+  return true;
+}
+
+void MMU::ForkPageTable(Addr parent_page_table, Addr child_page_table) {
+  if (parent_page_table == child_page_table) {
+    throw InvalidMMUOperationException("Fork to the parent page table");
+  }
+  CheckFrame(parent_page_table);
+  CheckFrame(child_page_table);
+  PageTable page_table;
+  phys_mem.get_bytes(reinterpret_cast<uint8_t*>(page_table.data()), 
+                     parent_page_table, kPageTableSizeBytes);
+  CacheAccess(parent_page_table, kPageTableSizeBytes, false);
+  
+  for (PageTableEntry &pt_entry : page_table) {
+    if ((pt_entry & (kPTE_PresentMask | kPTE_SharedMask)) != kPTE_PresentMask) {
+      continue;
+    }
+    if ((pt_entry & (kPTE_WritableMask | kPTE_CopyOnWriteMask)) != 0) {
+      pt_entry = (pt_entry & ~kPTE_WritableMask) | kPTE_CopyOnWriteMask;
+    }
+    // Read-only pages are counted too, so Protect makes them copy-on-write
+    uint32_t &share_count = cow_share_count[pt_entry & kPTE_FrameMask];
+    share_count = std::max<uint32_t>(share_count, 1) + 1;
+  }
+  
+  // Parent and child now have the same entries
+  const uint8_t *entries = reinterpret_cast<const uint8_t*>(page_table.data());
+  phys_mem.put_bytes(parent_page_table, kPageTableSizeBytes, entries);
+  phys_mem.put_bytes(child_page_table, kPageTableSizeBytes, entries);
+  CacheAccess(parent_page_table, kPageTableSizeBytes, true);
+  CacheAccess(child_page_table, kPageTableSizeBytes, true);
+  MarkDirty(parent_page_table);
+  MarkDirty(child_page_table);
+  if (tlb) tlb->Flush();
+}
+
+void MMU::ReleasePages(Addr page_table_base, Addr vaddress, Addr pages) {
+  if ((vaddress & kPageOffsetMask) != 0 || vaddress >= kVirtAddrSpaceSize
+          || pages > kPageTableEntries - (vaddress >> kPageSizeBits)) {
+    throw InvalidMMUOperationException(
+            "Released range not page aligned or exceeds address space size");
+  }
+  if (pages == 0 || cow_share_count.empty()) return;
+  CheckFrame(page_table_base);
+  
+  PageTable page_table;
+  Addr entries_addr = page_table_base 
+          + (vaddress >> kPageSizeBits) * sizeof(PageTableEntry);
+  Addr entries_size = pages * sizeof(PageTableEntry);
+  phys_mem.get_bytes(reinterpret_cast<uint8_t*>(page_table.data()), 
+                     entries_addr, entries_size);
+  CacheAccess(entries_addr, entries_size, false);
+  
+  for (Addr i = 0; i < pages; ++i) {
+    if ((page_table[i] & kPTE_PresentMask) == 0) continue;
+    auto shared = cow_share_count.find(page_table[i] & kPTE_FrameMask);
+    if (shared != cow_share_count.end() && --shared->second <= 1) {
+      cow_share_count.erase(shared);
+    }
+  }
+}
+
+bool MMU::ResolveCopyOnWrite(Addr vaddress, Addr &pt_entry_addr, 
+                             PageTableEntry &pt_entry) {
+  Addr pt_index = (vaddress >> kPageSizeBits) & kPageTableIndexMask;
+  pt_entry_addr = pmcb->page_table_base + pt_index * sizeof(PageTableEntry);
+  CheckFrame(pt_entry_addr);
+  
+  Addr frame = pt_entry & kPTE_FrameMask;
+  auto shared = cow_share_count.find(frame);
+  if (shared == cow_share_count.end()) {
+    // Last page sharing the frame, so it can just be written
+    ++cow_stats.frames_reused;
+  } else {
+    Addr new_frame;
+    if (!frame_allocator || !frame_allocator->Allocate(new_frame)) {
+      return false;
+    }
+    CheckAllocatedFrame(new_frame);
+    phys_mem.CopyFrame(new_frame, frame);
+    CacheAccess(frame, kPageSize, false);
+    CacheAccess(new_frame, kPageSize, true);
+    MarkDirty(new_frame);
+    if (--shared->second == 1) cow_share_count.erase(shared);
+    frame = new_frame;
+    ++cow_stats.frames_copied;
+  }
+  
+  pt_entry = frame | (pt_entry & ~(kPTE_FrameMask | kPTE_CopyOnWriteMask)) 
+          | kPTE_WritableMask;
+  CacheAccess(pt_entry_addr, sizeof(PageTableEntry), true);
+  phys_mem.put_32_unchecked(pt_entry_addr, pt_entry);
+  MarkDirty(pt_entry_addr);
+  return true;
+}
+
+Addr MMU::HarvestAccessedBits(Addr page_table_base, PageTable &entries) {
+  CheckFrame(page_table_base);
+  phys_mem.get_bytes(reinterpret_cast<uint8_t*>(entries.data()), 
+                     page_table_base, kPageTableSizeBytes);
+  CacheAccess(page_table_base, kPageTableSizeBytes, false);
+  
+  // Clear the bits without branches, so the loop vectorizes
+  PageTable cleared;
+  Addr accessed_count = 0;
+  for (Addr i = 0; i < kPageTableEntries; ++i) {
+    PageTableEntry pt_entry = entries[i];
+    uint32_t accessed = (pt_entry >> kPTE_Present) & (pt_entry >> kPTE_Accessed) & 1;
+    cleared[i] = pt_entry & ~(accessed << kPTE_Accessed);
+    accessed_count += accessed;
+  }
+  if (accessed_count == 0) return 0;
+  
+  phys_mem.put_bytes(page_table_base, kPageTableSizeBytes, 
+                     reinterpret_cast<const uint8_t*>(cleared.data()));
+  CacheAccess(page_table_base, kPageTableSizeBytes, true);
+  MarkDirty(page_table_base);
+  if (tlb) {
+    for (Addr i = 0; i < kPageTableEntries; ++i) {
+      if (cleared[i] != entries[i]) tlb->Invalidate(i << kPageSizeBits);
+    }
+  }
+  return accessed_count;
+}
+
+void MMU::CollectAndClearDirty(std::vector<Addr> &frames) {
+  // Skip clean words a whole word at a time, then visit the set bits of
+  // each dirty word with count-trailing-zeros
+  for (size_t i = 0; i < dirty_frames.size(); ++i) {
+    uint64_t word = dirty_frames[i];
+    if (word == 0) continue;
+    dirty_frames[i] = 0;
+    do {
+      Addr frame = i * 64 + __builtin_ctzll(word);
+      frames.push_back(frame << kPageSizeBits);
+      word &= word - 1;  // clear lowest set bit
+    } while (word != 0);
+  }
+}
+
+int MMU::AddWatchpoint(Addr vaddress, Addr length, uint32_t kinds,
+                       const std::shared_ptr<WatchHandler> &handler) {
+  if (length == 0 || vaddress >= kVirtAddrSpaceSize 
+          || length > kVirtAddrSpaceSize - vaddress) {
+    throw InvalidMMUOperationException(
+            "Watchpoint range exceeds address space size");
+  }
+  int id = watches.Add(vaddress, length, kinds, handler);
+  
+  // Pages now watched must not be translated by the TLB
+  if (tlb) {
+    for (Addr page = vaddress >> kPageSizeBits; 
+         page <= (vaddress + length - 1) >> kPageSizeBits; ++page) {
+      tlb->Invalidate(page << kPageSizeBits);
+    }
+  }
+  return id;
+}
+
+void MMU::CheckWatch(Addr vaddress, Addr count, bool write) {
+  PMCB *saved_pmcb_ptr = pmcb;
+  PMCB saved_pmcb = *pmcb;
+  watches.Check(vaddress, count, write);
+  pmcb = saved_pmcb_ptr;
+  *pmcb = saved_pmcb;
+}
+
+CacheHierarchy &MMU::get_cache() {
+  if (cache.get() == nullptr) {
+    throw InvalidMMUOperationException("Cache model is not enabled");
+  }
+  return *cache;
+}
+
 PMCB MMU::set_kernel_PMCB(void) {
   PMCB *prev_pmcb = pmcb;
   pmcb = &kernel_pmcb;
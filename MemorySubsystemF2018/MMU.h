@@ -8,12 +8,18 @@
 #ifndef MEM_MMU_H
 #define MEM_MMU_H
 
+#include "CacheHierarchy.h"
 #include "Exceptions.h"
+#include "FrameAllocator.h"
 #include "PageTable.h"
 #include "PMCB.h"
 #include "TLB.h"
+#include "Watchpoint.h"
 
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace mem {
 
@@ -27,9 +33,12 @@ public:
    * 
    * @param frame_count_ number of page frames to allocate in physical memory
    * @param tlb_size_ number of entries in TLB (must be > 0)
+   * @param backing host storage for physical memory (kSparse allocates 
+   *                frames only as they are written)
    * @throws std::bad_alloc if insufficient memory
    */
-  MMU(Addr frame_count_, size_t tlb_size);
+  MMU(Addr frame_count_, size_t tlb_size, 
+      PhysicalMemory::Backing backing = PhysicalMemory::Backing::kDense);
   
   /**
    * Constructor (TLB disabled)
@@ -38,9 +47,12 @@ public:
    * Set the PMCB non-zero to enable it. No TLB is used with MMU.
    * 
    * @param frame_count_ number of page frames to allocate in physical memory
+   * @param backing host storage for physical memory (kSparse allocates 
+   *                frames only as they are written)
    * @throws std::bad_alloc if insufficient memory
    */
-  MMU(Addr frame_count_);
+  MMU(Addr frame_count_, 
+      PhysicalMemory::Backing backing = PhysicalMemory::Backing::kDense);
   
   ~MMU() { }
   
@@ -56,6 +68,17 @@ public:
    */
   Addr get_frame_count() const { return frame_count; }
   
+  /**
+   * get_materialized_frame_count - return number of page frames which 
+   *   occupy host memory (less than get_frame_count() only for sparse
+   *   physical memory)
+   * 
+   * @return number of frames allocated on the host 
+   */
+  Addr get_materialized_frame_count() const { 
+    return phys_mem.get_materialized_frame_count(); 
+  }
+  
   /**
    * get_byte - get a single byte from the specified virtual address
    * 
@@ -94,6 +117,62 @@ public:
    */
   bool put_bytes(Addr vaddress, Addr count, void *src);
   
+  /*
+   * Atomic operations. Each operation translates the virtual address once
+   * as a write (so a write permission fault occurs for a read-only page, and 
+   * the accessed and modified bits are set even if a compare-and-swap 
+   * fails), then performs the operation with a host atomic instruction on 
+   * the backing store. The address must be naturally aligned, so the word 
+   * never spans pages.
+   * 
+   * The operations are atomic with respect to each other when called from 
+   * several host threads; address translation for atomic operations is 
+   * serialized internally. Other MMU operations are not thread-safe and 
+   * must not run concurrently with anything else.
+   * 
+   * Each function returns true if the operation was performed, false if it 
+   * was aborted by a fault handler, and throws InvalidMMUOperationException 
+   * if the address is not aligned.
+   */
+  
+  /**
+   * atomic_cas32, atomic_cas64 - compare and swap. If the word at vaddress
+   *   equals expected, replace it with desired.
+   * 
+   * @param vaddress virtual address of word
+   * @param expected value the word must have for the swap to occur
+   * @param desired new value for the word
+   * @param old_value set to the value of the word before the operation
+   *                  (the swap occurred if old_value == expected)
+   * @return true if success, false if operation aborted by fault handler
+   */
+  bool atomic_cas32(Addr vaddress, uint32_t expected, uint32_t desired,
+                    uint32_t &old_value);
+  bool atomic_cas64(Addr vaddress, uint64_t expected, uint64_t desired,
+                    uint64_t &old_value);
+  
+  /**
+   * atomic_fetch_add32, atomic_fetch_add64 - add to word (wrapping)
+   * 
+   * @param vaddress virtual address of word
+   * @param addend value to add
+   * @param old_value set to the value of the word before the addition
+   * @return true if success, false if operation aborted by fault handler
+   */
+  bool atomic_fetch_add32(Addr vaddress, uint32_t addend, uint32_t &old_value);
+  bool atomic_fetch_add64(Addr vaddress, uint64_t addend, uint64_t &old_value);
+  
+  /**
+   * atomic_exchange32, atomic_exchange64 - replace word
+   * 
+   * @param vaddress virtual address of word
+   * @param value new value for word
+   * @param old_value set to the value of the word before the exchange
+   * @return true if success, false if operation aborted by fault handler
+   */
+  bool atomic_exchange32(Addr vaddress, uint32_t value, uint32_t &old_value);
+  bool atomic_exchange64(Addr vaddress, uint64_t value, uint64_t &old_value);
+  
   /**
    * enter_virtual_mode - set kernel mode PMCB and put the MMU into virtual 
    *   mode. The system will save the specified PMCB as the kernel mode PMCB
@@ -166,6 +245,15 @@ public:
    */
   uint64_t get_byte_count() const { return phys_mem.get_byte_count(); }
   
+  /**
+   * get_physical_memory - access the physical memory model, for 
+   *   configuration and statistics (e.g. frame deduplication). Accesses made 
+   *   directly through this reference bypass address translation.
+   * 
+   * @return physical memory used by this MMU
+   */
+  PhysicalMemory &get_physical_memory() { return phys_mem; }
+  
   /**
    * isTLBEnabled - query whether MMU has TLB enabled
    * 
@@ -185,7 +273,255 @@ public:
    * @throws InvalidMMUOperationException if TLB not enabled
    */
   void get_TLBStats(TLB::TLBStats &stats);
+  
+  /**
+   * EnableCache - place a simulated data cache hierarchy in front of 
+   *   physical memory. Every physical memory access made by the MMU (page 
+   *   table reads and updates, and data transfers) then passes through the 
+   *   cache model. Replaces any existing cache model. With no cache model
+   *   (the default) accesses go straight to physical memory.
+   * 
+   * @param levels configuration of each cache level, closest to CPU first
+   * @throws InvalidCacheConfigurationException if configuration not valid
+   */
+  void EnableCache(const std::vector<CacheHierarchy::LevelConfig> &levels) {
+    cache = std::make_unique<CacheHierarchy>(levels);
+  }
+  
+  /**
+   * DisableCache - remove the cache model (and its statistics)
+   */
+  void DisableCache() { cache.reset(); }
+  
+  /**
+   * isCacheEnabled - query whether MMU has a cache model
+   * 
+   * @return true if cache model enabled, false otherwise
+   */
+  bool isCacheEnabled() const { return cache.get() != nullptr; }
+  
+  /**
+   * get_cache - access the cache model, for flushing and statistics
+   * 
+   * @return cache model used by this MMU
+   * @throws InvalidMMUOperationException if cache model not enabled
+   */
+  CacheHierarchy &get_cache();
 
+  /**
+   * SetFrameAllocator - set the allocator which supplies frames for 
+   *   demand-zero pages. Without one, a demand-zero page faults to the page
+   *   fault handler like any other page which isn't present.
+   * 
+   * @param allocator frame allocator
+   */
+  void SetFrameAllocator(const std::shared_ptr<FrameAllocator> &allocator) {
+    frame_allocator = allocator;
+  }
+  
+  /**
+   * MapAnonymous - map a region of demand-zero pages in the page table of 
+   *   the current PMCB. No frames are allocated now. On the first access to
+   *   each page the MMU allocates a frame from the frame allocator, zeros 
+   *   it and maps it, without calling the page fault handler. If no frame
+   *   is available, the page fault handler is called as usual (it sees the
+   *   kPTE_DemandZeroMask bit in the page table entry).
+   * 
+   * @param vaddress first virtual address (multiple of kPageSize)
+   * @param length length of region in bytes (rounded up to whole pages)
+   * @param writable true if the pages are writable
+   * @throws InvalidMMUOperationException if not in virtual mode, or the 
+   *         region is not aligned, exceeds the address space, or overlaps a
+   *         page which is present or already demand-zero
+   */
+  void MapAnonymous(Addr vaddress, Addr length, bool writable);
+  
+  /**
+   * Protect - make a range of pages in the page table of the current PMCB
+   *   writable or read-only. Only pages which are present or demand-zero 
+   *   are changed. The entries are read and written back in one transfer 
+   *   each, and only the TLB entries of changed pages are invalidated.
+   * 
+   *   A copy-on-write page made read-only loses kPTE_CopyOnWriteMask but 
+   *   still counts as sharing its frame; a page made writable while its 
+   *   frame is shared becomes copy-on-write rather than writable.
+   * 
+   * @param vaddress first virtual address (multiple of kPageSize)
+   * @param pages number of pages
+   * @param writable true to make the pages writable, false for read-only
+   * @throws InvalidMMUOperationException if not in virtual mode, or the 
+   *         range is not aligned or exceeds the address space
+   */
+  void Protect(Addr vaddress, Addr pages, bool writable);
+  
+  /**
+   * ForkPageTable - duplicate a page table for a new process, sharing its
+   *   frames copy-on-write. Every present page which is writable (or already
+   *   copy-on-write) becomes read-only with kPTE_CopyOnWriteMask set, in both
+   *   page tables. Other entries are copied unchanged; read-only present
+   *   pages still share their frames, so Protect later makes them 
+   *   copy-on-write. Pages with kPTE_SharedMask set (such as shared memory
+   *   regions) stay shared: they are copied unchanged and not counted. The
+   *   TLB is flushed.
+   * 
+   *   A write to a copy-on-write page takes a frame from the frame allocator,
+   *   copies the shared frame into it and maps it writable; if the page is 
+   *   the last one still sharing the frame, it is simply made writable 
+   *   again. Neither case calls the write permission fault handler. If no
+   *   frame is available, the handler is called as usual (it sees 
+   *   kPTE_CopyOnWriteMask in the page table entry). The MMU counts the 
+   *   page table entries sharing each frame; call ReleasePages before 
+   *   unmapping a present page or reusing its frame, and ReleasePageTable 
+   *   before discarding a page table.
+   * 
+   * @param parent_page_table physical address of page table to duplicate
+   * @param child_page_table physical address of frame for the new page table
+   * @throws InvalidMMUOperationException if the page tables are the same
+   */
+  void ForkPageTable(Addr parent_page_table, Addr child_page_table);
+  
+  /**
+   * ReleasePages - stop counting a range of pages of a page table as 
+   *   sharing their frames. Call before the entries are cleared or their
+   *   frames reused other than by the MMU. The entries and frames are not
+   *   changed; a frame still shared by another entry (see isSharedFrame)
+   *   must not be freed.
+   * 
+   * @param page_table_base physical address of page table
+   * @param vaddress first virtual address (multiple of kPageSize)
+   * @param pages number of pages
+   * @throws InvalidMMUOperationException if the range is not aligned or 
+   *         exceeds the address space
+   */
+  void ReleasePages(Addr page_table_base, Addr vaddress, Addr pages);
+  
+  /**
+   * ReleasePageTable - stop counting every page of a page table as sharing
+   *   its frame, before the page table is discarded (see ReleasePages)
+   * 
+   * @param page_table_base physical address of page table
+   */
+  void ReleasePageTable(Addr page_table_base) {
+    ReleasePages(page_table_base, 0, kPageTableEntries);
+  }
+  
+  /**
+   * isSharedFrame - true if more than one page table entry shares a page 
+   *   frame after ForkPageTable
+   * 
+   * @param frame_address physical address of the frame
+   */
+  bool isSharedFrame(Addr frame_address) const {
+    return cow_share_count.count(frame_address & kPTE_FrameMask) != 0;
+  }
+  
+  /**
+   * CopyOnWriteStats - results of writes to copy-on-write pages
+   */
+  class CopyOnWriteStats {
+  public:
+    CopyOnWriteStats() : frames_copied(0), frames_reused(0) {}
+    
+    uint64_t frames_copied;  // writes which copied a shared frame
+    uint64_t frames_reused;  // writes by the last sharer, made writable
+  };
+  
+  /**
+   * get_CopyOnWriteStats - get copy-on-write statistics
+   * 
+   * @param stats set to a copy of the statistics
+   */
+  void get_CopyOnWriteStats(CopyOnWriteStats &stats) const { 
+    stats = cow_stats; 
+  }
+  
+  /**
+   * get_demand_zero_fault_count - number of demand-zero pages mapped by the
+   *   MMU on first use
+   */
+  uint64_t get_demand_zero_fault_count() const { return demand_zero_faults; }
+  
+  /**
+   * HarvestAccessedBits - clear the accessed bit of every present page in a
+   *   page table, and invalidate the TLB entries of those pages so that the
+   *   next access to each sets the bit again. The page table is read and
+   *   written back in one transfer each.
+   * 
+   * @param page_table_base physical address of page table
+   * @param entries set to the page table entries as they were before the
+   *        accessed bits were cleared
+   * @return number of present pages which had been accessed
+   */
+  Addr HarvestAccessedBits(Addr page_table_base, PageTable &entries);
+  
+  /**
+   * CollectAndClearDirty - get the page frames written since the last call,
+   *   and mark all frames clean. A frame is dirty after any write through 
+   *   the MMU (in physical or virtual mode, including TLB hits and atomics) 
+   *   and after the MMU itself updates a page table entry or initializes a
+   *   frame. Writes made directly through get_physical_memory() are not 
+   *   tracked; the writer must call MarkDirty for them.
+   * 
+   * @param frames physical addresses of dirty frames are appended, in 
+   *        increasing order
+   */
+  void CollectAndClearDirty(std::vector<Addr> &frames);
+  
+  /**
+   * isDirtyFrame - true if a page frame was written since the last call to
+   *   CollectAndClearDirty
+   * 
+   * @param frame_address physical address in the frame
+   */
+  bool isDirtyFrame(Addr frame_address) const {
+    Addr frame = frame_address >> kPageSizeBits;
+    return frame < frame_count 
+            && (dirty_frames[frame / 64] & (uint64_t(1) << (frame % 64))) != 0;
+  }
+  
+  /**
+   * MarkDirty - set the dirty bit of the frame containing a physical 
+   *   address, after a write made through get_physical_memory() (ignored
+   *   if beyond the end of physical memory, which will fail when accessed)
+   * 
+   * @param paddress physical address written
+   */
+  void MarkDirty(Addr paddress) {
+    Addr frame = paddress >> kPageSizeBits;
+    if (frame < frame_count) {
+      dirty_frames[frame / 64] |= uint64_t(1) << (frame % 64);
+    }
+  }
+  
+  /**
+   * AddWatchpoint - call a handler whenever a range of virtual addresses is
+   *   read and/or written through this MMU in virtual mode (in whichever
+   *   address space is current). The handler runs after each page of the 
+   *   access is transferred (for an atomic operation, just before it), and
+   *   may use the MMU; the state of the interrupted operation is restored
+   *   afterwards. Watched pages are never cached in the TLB, so pages which
+   *   aren't watched are translated as usual.
+   * 
+   *   Physical watchpoints are available through get_physical_memory().
+   * 
+   * @param vaddress first virtual address of range
+   * @param length number of bytes in range (> 0)
+   * @param kinds kWatchRead, kWatchWrite, or kWatchReadWrite
+   * @param handler handler to call
+   * @return watchpoint number, for RemoveWatchpoint
+   * @throws InvalidMMUOperationException if range not in address space
+   */
+  int AddWatchpoint(Addr vaddress, Addr length, uint32_t kinds,
+                    const std::shared_ptr<WatchHandler> &handler);
+  
+  /**
+   * RemoveWatchpoint - remove a virtual watchpoint
+   * 
+   * @param id watchpoint number returned by AddWatchpoint
+   * @return true if removed, false if no such watchpoint
+   */
+  bool RemoveWatchpoint(int id) { return watches.Remove(id); }
+  
   /**
    * FaultHandler - abstract base class for fault handler
    * 
@@ -238,6 +574,25 @@ private:
   // TLB (null if TLB disabled)
   std::unique_ptr<TLB> tlb;
   
+  // Virtual watchpoints
+  WatchList watches;
+  bool watched_page;  // true if the page last translated by ToPhysical is watched
+  
+  // Frame allocator for demand-zero pages (null if not set)
+  std::shared_ptr<FrameAllocator> frame_allocator;
+  uint64_t demand_zero_faults;  // demand-zero pages mapped
+  
+  // Number of page table entries sharing each copy-on-write frame, keyed by
+  // frame address (frames with a single remaining entry are removed)
+  std::unordered_map<Addr, uint32_t> cow_share_count;
+  CopyOnWriteStats cow_stats;
+  
+  // Dirty frame bitmap, one bit per frame
+  std::vector<uint64_t> dirty_frames;
+  
+  // Data cache model (null if disabled)
+  std::unique_ptr<CacheHierarchy> cache;
+  
   // Fault handler data
   bool fault_handler_active;   // true while fault handler is running
   std::shared_ptr<FaultHandler> page_fault_handler;
@@ -267,6 +622,90 @@ private:
    * @return true if success, false if operation aborted by fault handler
    */
   bool Execute(void);
+  
+  // Serializes translation for atomic operations. Recursive, since a 
+  // fault handler may itself use atomic operations.
+  std::recursive_mutex atomic_mutex;
+  
+  /**
+   * TranslateAtomic - translate and prepare a word for an atomic operation
+   * 
+   * @param vaddress virtual address of word
+   * @param size size of word in bytes
+   * @return host pointer to word, or nullptr if aborted by fault handler
+   * @throws InvalidMMUOperationException if vaddress is not aligned
+   */
+  uint8_t *TranslateAtomic(Addr vaddress, Addr size);
+  
+  /**
+   * MapDemandZero - allocate, zero and map a frame for a demand-zero page
+   * 
+   * @param pt_entry_addr physical address of page table entry
+   * @param pt_entry page table entry; updated with the new mapping
+   * @return true if mapped, false if no frame allocator or no free frame
+   */
+  bool MapDemandZero(Addr pt_entry_addr, PageTableEntry &pt_entry);
+  
+  /**
+   * ResolveCopyOnWrite - give a copy-on-write page a private writable frame
+   * 
+   * @param vaddress virtual address being written
+   * @param pt_entry_addr set to physical address of page table entry
+   * @param pt_entry page table entry; updated with the new mapping
+   * @return true if resolved, false if no frame allocator or no free frame
+   */
+  bool ResolveCopyOnWrite(Addr vaddress, Addr &pt_entry_addr, 
+                          PageTableEntry &pt_entry);
+  
+  /**
+   * CheckWatch - call handlers of virtual watchpoints overlapping an 
+   *   access, preserving the state of the current operation
+   * 
+   * @param vaddress first virtual address accessed
+   * @param count number of bytes accessed
+   * @param write true for a write, false for a read
+   */
+  void CheckWatch(Addr vaddress, Addr count, bool write);
+  
+  /**
+   * CacheAccess - pass a physical memory access through the cache model,
+   *   if enabled
+   * 
+   * @param paddress physical address of first byte
+   * @param count number of bytes
+   * @param write true for a store, false for a load
+   */
+  void CacheAccess(Addr paddress, Addr count, bool write) {
+    if (cache) cache->Access(paddress, count, write);
+  }
+  
+  /**
+   * CheckFrame - verify that a physical address lies in an existing page
+   *   frame. Any range within that frame may then be accessed with the
+   *   unchecked PhysicalMemory functions.
+   * 
+   * @param paddress physical address
+   * @throws PhysicalMemoryBoundsException if the frame doesn't exist
+   */
+  void CheckFrame(Addr paddress) const {
+    if ((paddress >> kPageSizeBits) >= frame_count) {
+      throw PhysicalMemoryBoundsException(paddress);
+    }
+  }
+  
+  /**
+   * CheckAllocatedFrame - verify a frame taken from the frame allocator, 
+   *   returning it to the allocator if it doesn't exist
+   * 
+   * @param frame_address physical address of the frame
+   * @throws PhysicalMemoryBoundsException if the frame doesn't exist
+   */
+  void CheckAllocatedFrame(Addr frame_address) {
+    if ((frame_address >> kPageSizeBits) >= frame_count) {
+      frame_allocator->Free(frame_address);
+      throw PhysicalMemoryBoundsException(frame_address);
+    }
+  }
 };
 
 }  // namespace mem
@@ -43,6 +43,8 @@ const Addr kVirtAddrMask = kVirtAddrSpaceSize - 1;
 const uint32_t kPTE_FrameMask = kPageNumberMask;
 
 // Bit masks for other flags
+const uint32_t kPTE_Shared = 6;             // frame deliberately shared, never
+const uint32_t kPTE_SharedMask = (1 << kPTE_Shared);  // copied on write
 const uint32_t kPTE_Present = 7;            // page present in memory
 const uint32_t kPTE_PresentMask = (1 << kPTE_Present);
 const uint32_t kPTE_Writable = 8;           // page is writable
@@ -51,6 +53,10 @@ const uint32_t kPTE_Accessed = 9;           // set when page is accessed
 const uint32_t kPTE_AccessedMask = (1 << kPTE_Accessed);
 const uint32_t kPTE_Modified = 10;          // set when page is modified
 const uint32_t kPTE_ModifiedMask = (1 << kPTE_Modified);
+const uint32_t kPTE_DemandZero = 11;        // not present, zero filled on use
+const uint32_t kPTE_DemandZeroMask = (1 << kPTE_DemandZero);
+const uint32_t kPTE_CopyOnWrite = 12;       // not writable, copied on write
+const uint32_t kPTE_CopyOnWriteMask = (1 << kPTE_CopyOnWrite);
 
 // Define type for a page table as a derived class from std::array.
 // The page table is initialized to zero.
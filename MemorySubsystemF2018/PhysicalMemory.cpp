@@ -9,19 +9,61 @@
 #include "PhysicalMemory.h"
 
 #include "Exceptions.h"
+#include "FrameCodec.h"
+#include <algorithm>
+#include <chrono>
 #include <cstring>
+#include <unordered_map>
+
+namespace {
+
+/**
+ * LatencyBucket - histogram bucket for a duration
+ * 
+ * @param start time at which the operation started
+ * @return floor(log2(elapsed nanoseconds)), limited to the bucket count
+ */
+int LatencyBucket(std::chrono::steady_clock::time_point start) {
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start).count();
+  int bucket = 63 - __builtin_clzll(static_cast<uint64_t>(elapsed) | 1);
+  return std::min(bucket, 
+          mem::PhysicalMemory::CompressionStats::kLatencyBuckets - 1);
+}
+
+}  // namespace
 
 namespace mem {
 
 std::vector<uint8_t> PhysicalMemory::mem_data;
+std::vector<PhysicalMemory::FrameSlot> PhysicalMemory::frame_dir;
     
-PhysicalMemory::PhysicalMemory(Addr size) {
+PhysicalMemory::PhysicalMemory(Addr size, Backing backing_)
+: mem_size(size), 
+  backing(backing_), 
+  cold_frame_interval(0), 
+  next_cold_scan(0),
+  access_tracking(AccessTracking::kOff),
+  sample_interval(1),
+  sample_countdown(1),
+  sample_seed(1),
+  current_node(0),
+  watches((static_cast<uint64_t>(size) + kPageSize - 1) >> kPageSizeBits),
+  account_access(false) {
     if (size == 0)
       throw PhysicalMemoryZeroSizeException();
-    if (!mem_data.empty()) 
+    if (!mem_data.empty() || !frame_dir.empty()) 
       throw PhysicalMemoryDuplicateException();
-    mem_data.reserve(size);
-    mem_data.resize(size);
+    if (backing == Backing::kDense) {
+      mem_data.reserve(size);
+      mem_data.resize(size);
+      materialized_frames = (size + kPageSize - 1) >> kPageSizeBits;
+    } else {
+      // Only the directory is allocated; frames are added on first write
+      frame_dir.resize((static_cast<uint64_t>(size) + kPageSize - 1) 
+                       >> kPageSizeBits);
+      materialized_frames = 0;
+    }
     byte_count = 0;
 }
 
@@ -29,33 +71,412 @@ void PhysicalMemory::ValidateAddressRange(Addr address, Addr count) const {
   // Invalid if either end address is past end of memory, or if wrap-around
   // or 0 size block
   Addr end = address + count;
-  if (end > mem_data.size() || end <= address) {
+  if (end > mem_size || end <= address) {
     throw PhysicalMemoryBoundsException(address);
   }
 }
 
 void PhysicalMemory::get_byte(uint8_t *dest, Addr address) {
   ValidateAddressRange(address, 1);
-  ++byte_count;
-  *dest = mem_data[address];
+  get_bytes_unchecked(dest, address, 1);
 }
 
 void PhysicalMemory::get_bytes(uint8_t *dest, Addr address, Addr count) {
   ValidateAddressRange(address, count);
-  byte_count += count;
-  memcpy(dest, &mem_data[address], count);
+  get_bytes_unchecked(dest, address, count);
 }
 
 void PhysicalMemory::put_byte(Addr address, uint8_t *data) {
   ValidateAddressRange(address, 1);
-  ++byte_count;
-  mem_data[address] = *data;
+  put_bytes_unchecked(address, 1, data);
 }
 
 void PhysicalMemory::put_bytes(Addr address, Addr count, const uint8_t *src) {
   ValidateAddressRange(address, count);
-  byte_count += count;
-  memcpy(&mem_data[address], src, count);
+  put_bytes_unchecked(address, count, src);
+}
+
+void PhysicalMemory::ReadSparse(uint8_t *dest, Addr address, Addr count) {
+  // Copy one frame at a time; untouched frames read as zero
+  while (count > 0) {
+    Addr offset = address & kPageOffsetMask;
+    Addr count_in_frame = std::min(count, kPageSize - offset);
+    FrameSlot &slot = frame_dir[address >> kPageSizeBits];
+    TouchSlot(slot);
+    const FrameData *frame = slot.data.get();
+    if (frame != nullptr) {
+      memcpy(dest, frame->data() + offset, count_in_frame);
+    } else {
+      memset(dest, 0, count_in_frame);
+    }
+    dest += count_in_frame;
+    address += count_in_frame;
+    count -= count_in_frame;
+  }
+  CheckColdFrames();
+}
+
+void PhysicalMemory::WriteSparse(Addr address, Addr count, const uint8_t *src) {
+  // Copy one frame at a time, allocating (zero filled) frames as needed
+  while (count > 0) {
+    Addr offset = address & kPageOffsetMask;
+    Addr count_in_frame = std::min(count, kPageSize - offset);
+    FrameSlot &slot = frame_dir[address >> kPageSizeBits];
+    TouchSlot(slot);
+    memcpy(WritableFrame(slot).data() + offset, src, count_in_frame);
+    src += count_in_frame;
+    address += count_in_frame;
+    count -= count_in_frame;
+  }
+  CheckColdFrames();
+}
+
+PhysicalMemory::FrameData &PhysicalMemory::WritableFrame(FrameSlot &slot) {
+  std::shared_ptr<FrameData> &frame = slot.data;
+  if (!frame) {
+    frame = std::make_shared<FrameData>();  // value-initialized to zeros
+    ++materialized_frames;
+  } else if (frame.use_count() > 1) {
+    frame = std::make_shared<FrameData>(*frame);  // break sharing
+    ++materialized_frames;
+  }
+  return *frame;
+}
+
+void PhysicalMemory::ZeroFrame(Addr frame_address) {
+  if ((frame_address & kPageOffsetMask) != 0) {
+    throw PhysicalMemoryBoundsException(frame_address);
+  }
+  ValidateAddressRange(frame_address, kPageSize);
+  byte_count += kPageSize;
+  if (backing == Backing::kDense) {
+    memset(&mem_data[frame_address], 0, kPageSize);
+  } else {
+    FrameSlot &slot = frame_dir[frame_address >> kPageSizeBits];
+    if (slot.compressed) {
+      --compression_stats.compressed_frames;
+      compression_stats.uncompressed_bytes -= kPageSize;
+      compression_stats.compressed_bytes -= slot.compressed->size();
+      slot.compressed.reset();
+    }
+    if (slot.data) {
+      if (slot.data.use_count() == 1) --materialized_frames;
+      slot.data.reset();
+    }
+  }
+  if (account_access) AccountAccess(frame_address, kPageSize, true);
+}
+
+void PhysicalMemory::CopyFrame(Addr dest_frame, Addr src_frame) {
+  if (dest_frame == src_frame) return;
+  ZeroFrame(dest_frame);  // validates dest_frame and releases its contents
+  if ((src_frame & kPageOffsetMask) != 0) {
+    throw PhysicalMemoryBoundsException(src_frame);
+  }
+  ValidateAddressRange(src_frame, kPageSize);
+  if (backing == Backing::kDense) {
+    byte_count += kPageSize;
+    memcpy(&mem_data[dest_frame], &mem_data[src_frame], kPageSize);
+    if (account_access) AccountAccess(src_frame, kPageSize, false);
+  } else {
+    // Share the source contents (zero frames stay unmaterialized)
+    FrameSlot &src = frame_dir[src_frame >> kPageSizeBits];
+    TouchSlot(src);
+    byte_count += kPageSize;
+    frame_dir[dest_frame >> kPageSizeBits].data = src.data;
+    if (account_access) AccountAccess(src_frame, kPageSize, false);
+  }
+}
+
+uint8_t *PhysicalMemory::get_atomic_pointer_unchecked(Addr address, Addr size) {
+  byte_count += 2 * size;
+  if (account_access) {
+    AccountAccess(address, size, false);
+    AccountAccess(address, size, true);
+  }
+  if (backing == Backing::kDense) {
+    return &mem_data[address];
+  } else {
+    FrameSlot &slot = frame_dir[address >> kPageSizeBits];
+    TouchSlot(slot);
+    return WritableFrame(slot).data() + (address & kPageOffsetMask);
+  }
+}
+
+void PhysicalMemory::set_access_tracking(AccessTracking mode, 
+                                         uint32_t sample_interval_) {
+  access_tracking = mode;
+  sample_interval = std::max<uint32_t>(sample_interval_, 1);
+  sample_countdown = 1;  // take first sample on the next access
+  frame_access.clear();
+  if (mode != AccessTracking::kOff) {
+    frame_access.resize((static_cast<uint64_t>(mem_size) + kPageSize - 1) 
+                        >> kPageSizeBits);
+  }
+  UpdateAccountAccess();
+}
+
+void PhysicalMemory::ResetFrameAccessCounts() {
+  std::fill(frame_access.begin(), frame_access.end(), FrameAccessCounts());
+}
+
+void PhysicalMemory::AccountAccess(Addr address, Addr count, bool write) {
+  if (access_tracking != AccessTracking::kOff) {
+    CountAccess(address, count, write);
+  }
+  if (!banks.empty()) {
+    CountNodeAccess(address, count);
+  }
+  if (!watches.empty()) {
+    watches.Check(address, count, write);
+  }
+}
+
+void PhysicalMemory::CountAccess(Addr address, Addr count, bool write) {
+  uint64_t weight = 1;
+  if (access_tracking == AccessTracking::kSampled) {
+    if (--sample_countdown != 0) return;
+    
+    // Next gap is uniform in [1, 2 * sample_interval - 1], so its mean is
+    // sample_interval (xorshift32 random numbers)
+    sample_seed ^= sample_seed << 13;
+    sample_seed ^= sample_seed >> 17;
+    sample_seed ^= sample_seed << 5;
+    sample_countdown = 1 + sample_seed % (2 * uint64_t(sample_interval) - 1);
+    weight = sample_interval;
+  }
+  
+  Addr first = address >> kPageSizeBits;
+  Addr last = (address + count - 1) >> kPageSizeBits;
+  for (Addr frame = first; frame <= last; ++frame) {
+    uint64_t begin = std::max(address, frame << kPageSizeBits);
+    uint64_t end = std::min(static_cast<uint64_t>(address) + count, 
+                            static_cast<uint64_t>(frame + 1) << kPageSizeBits);
+    FrameAccessCounts &counts = frame_access[frame];
+    if (write) {
+      counts.writes += weight;
+      counts.write_bytes += weight * (end - begin);
+    } else {
+      counts.reads += weight;
+      counts.read_bytes += weight * (end - begin);
+    }
+  }
+}
+
+void PhysicalMemory::get_hot_frames(size_t n, std::vector<Addr> &frames) const {
+  frames.clear();
+  for (Addr frame = 0; frame < frame_access.size(); ++frame) {
+    if (frame_access[frame].total_bytes() != 0) frames.push_back(frame);
+  }
+  auto hotter = [this](Addr a, Addr b) {
+    uint64_t a_bytes = frame_access[a].total_bytes();
+    uint64_t b_bytes = frame_access[b].total_bytes();
+    return a_bytes > b_bytes || (a_bytes == b_bytes && a < b);
+  };
+  n = std::min(n, frames.size());
+  std::partial_sort(frames.begin(), frames.begin() + n, frames.end(), hotter);
+  frames.resize(n);
+}
+
+void PhysicalMemory::UpdateAccountAccess() {
+  account_access = access_tracking != AccessTracking::kOff || !banks.empty()
+          || !watches.empty();
+}
+
+int PhysicalMemory::AddWatchpoint(Addr address, Addr length, uint32_t kinds,
+                                  const std::shared_ptr<WatchHandler> &handler) {
+  ValidateAddressRange(address, length);
+  int id = watches.Add(address, length, kinds, handler);
+  UpdateAccountAccess();
+  return id;
+}
+
+bool PhysicalMemory::RemoveWatchpoint(int id) {
+  bool removed = watches.Remove(id);
+  UpdateAccountAccess();
+  return removed;
+}
+
+void PhysicalMemory::set_banks(const std::vector<BankConfig> &banks_) {
+  uint64_t total_frames = 0;
+  for (const BankConfig &bank : banks_) {
+    total_frames += bank.frame_count;
+  }
+  if (!banks_.empty() && total_frames 
+          != (static_cast<uint64_t>(mem_size) + kPageSize - 1) >> kPageSizeBits) {
+    throw PhysicalMemoryBankConfigurationException(
+            "Bank frame counts must add up to the number of frames in memory");
+  }
+  banks = banks_;
+  bank_first_frame.clear();
+  Addr first_frame = 0;
+  for (const BankConfig &bank : banks) {
+    bank_first_frame.push_back(first_frame);
+    first_frame += bank.frame_count;
+  }
+  node_stats.assign(banks.size(), NodeStats());
+  current_node = 0;
+  UpdateAccountAccess();
+}
+
+size_t PhysicalMemory::get_frame_node(Addr frame) const {
+  if (banks.empty()) return 0;
+  auto next = std::upper_bound(bank_first_frame.begin(), 
+                               bank_first_frame.end(), frame);
+  return (next - bank_first_frame.begin()) - 1;
+}
+
+void PhysicalMemory::set_current_node(size_t node) {
+  if (node >= get_node_count()) {
+    throw PhysicalMemoryBankConfigurationException("Node does not exist");
+  }
+  current_node = node;
+}
+
+void PhysicalMemory::ResetNodeStats() {
+  std::fill(node_stats.begin(), node_stats.end(), NodeStats());
+}
+
+void PhysicalMemory::CountNodeAccess(Addr address, Addr count) {
+  NodeStats &stats = node_stats[current_node];
+  Addr first = address >> kPageSizeBits;
+  Addr last = (address + count - 1) >> kPageSizeBits;
+  for (Addr frame = first; frame <= last; ++frame) {
+    uint64_t begin = std::max(address, frame << kPageSizeBits);
+    uint64_t end = std::min(static_cast<uint64_t>(address) + count, 
+                            static_cast<uint64_t>(frame + 1) << kPageSizeBits);
+    size_t node = get_frame_node(frame);
+    if (node == current_node) {
+      ++stats.local_accesses;
+      stats.local_bytes += end - begin;
+      stats.access_cost += banks[node].local_cost;
+    } else {
+      ++stats.remote_accesses;
+      stats.remote_bytes += end - begin;
+      stats.access_cost += banks[node].remote_cost;
+    }
+  }
+}
+
+void PhysicalMemory::DeduplicateFrames(DedupStats &stats) {
+  stats = DedupStats();
+  if (backing != Backing::kSparse) return;
+  
+  // Frames seen so far, keyed by hash of contents. Collisions are resolved
+  // by comparing contents, so the hash only needs to be fast.
+  std::unordered_multimap<uint64_t, Addr> frames_by_hash;
+  Addr materialized_before = materialized_frames;
+  
+  for (Addr frame_num = 0; frame_num < frame_dir.size(); ++frame_num) {
+    std::shared_ptr<FrameData> &frame = frame_dir[frame_num].data;
+    if (!frame) continue;  // zero or compressed
+    ++stats.frames_scanned;
+    
+    // FNV-1a over 64 bit words, noting at the same time whether any bit
+    // in the frame is set.
+    const uint64_t *words = reinterpret_cast<const uint64_t*>(frame->data());
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    uint64_t any_bits = 0;
+    for (Addr i = 0; i < kPageSize / sizeof(uint64_t); ++i) {
+      hash = (hash ^ words[i]) * 0x100000001b3ULL;
+      any_bits |= words[i];
+    }
+    
+    // Zero frames are dropped from the directory; they read back as zeros
+    if (any_bits == 0) {
+      if (frame.use_count() == 1) --materialized_frames;
+      frame.reset();
+      ++stats.zero_frames_released;
+      continue;
+    }
+    
+    // Look for an earlier frame with the same contents
+    bool merged = false;
+    auto range = frames_by_hash.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      std::shared_ptr<FrameData> &match = frame_dir[it->second].data;
+      if (match == frame) {  // already sharing
+        merged = true;
+        break;
+      }
+      if (memcmp(match->data(), frame->data(), kPageSize) == 0) {
+        if (frame.use_count() == 1) --materialized_frames;
+        frame = match;
+        ++stats.frames_merged;
+        merged = true;
+        break;
+      }
+    }
+    if (!merged) {
+      frames_by_hash.emplace(hash, frame_num);
+    }
+  }
+  
+  stats.bytes_saved = static_cast<uint64_t>(
+          materialized_before - materialized_frames) * kPageSize;
+}
+
+Addr PhysicalMemory::get_shared_frame_count() const {
+  Addr shared = 0;
+  for (const auto &slot : frame_dir) {
+    if (slot.data && slot.data.use_count() > 1) ++shared;
+  }
+  return shared;
+}
+
+Addr PhysicalMemory::CompressColdFrames(uint64_t idle_bytes) {
+  Addr compressed_now = 0;
+  std::vector<uint8_t> buffer;
+  for (FrameSlot &slot : frame_dir) {
+    if (!slot.data || slot.data.use_count() > 1
+            || byte_count - slot.last_access < idle_bytes) {
+      continue;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    CompressFrame(slot.data->data(), kPageSize, buffer);
+    ++compression_stats.compress_latency[LatencyBucket(start)];
+    
+    // Keep frames resident unless compression saves at least a quarter of 
+    // the frame, so that nearly incompressible frames don't pay the 
+    // decompression cost for no benefit. Restart their idle time so they 
+    // aren't retried on every pass.
+    if (buffer.size() > kPageSize - kPageSize / 4) {
+      ++compression_stats.incompressible_count;
+      slot.last_access = byte_count;
+      continue;
+    }
+    
+    slot.compressed.reset(new std::vector<uint8_t>(buffer));
+    slot.data.reset();
+    --materialized_frames;
+    ++compressed_now;
+    ++compression_stats.compressed_frames;
+    ++compression_stats.compress_count;
+    compression_stats.uncompressed_bytes += kPageSize;
+    compression_stats.compressed_bytes += slot.compressed->size();
+  }
+  return compressed_now;
+}
+
+void PhysicalMemory::DecompressSlot(FrameSlot &slot) {
+  auto start = std::chrono::steady_clock::now();
+  std::shared_ptr<FrameData> frame = std::make_shared<FrameData>();
+  if (!DecompressFrame(slot.compressed->data(), slot.compressed->size(), 
+                       frame->data(), kPageSize)) {
+    throw PhysicalMemoryCorruptFrameException(
+            static_cast<Addr>(&slot - frame_dir.data()) << kPageSizeBits);
+  }
+  
+  --compression_stats.compressed_frames;
+  ++compression_stats.decompress_count;
+  compression_stats.uncompressed_bytes -= kPageSize;
+  compression_stats.compressed_bytes -= slot.compressed->size();
+  
+  slot.data = std::move(frame);
+  slot.compressed.reset();
+  ++materialized_frames;
+  ++compression_stats.decompress_latency[LatencyBucket(start)];
 }
 
 } // namespace mem
\ No newline at end of file
@@ -10,24 +10,39 @@
 #define MEM_PHYSICALMEMORY_H
 
 #include "MemoryDefs.h"
+#include "Watchpoint.h"
 
+#include <array>
 #include <cstddef>
+#include <cstring>
+#include <memory>
 #include <vector>
 
 namespace mem {
 
 class PhysicalMemory {
 public:
+  /**
+   * Backing - how the memory contents are stored on the host.
+   * 
+   *   kDense  - a single contiguous host buffer of the full memory size.
+   *   kSparse - a directory indexed by page frame number. Each frame is 
+   *             allocated on the first write to it; reads of frames which 
+   *             were never written return zeros without allocating.
+   */
+  enum class Backing { kDense, kSparse };
+  
   /**
    * Constructor
    * 
    * @param size number of bytes of memory to allocate (must be a multiple
    *             of 16)
+   * @param backing_ host storage used for memory contents
    * @throws std::bad_alloc if insufficient memory
    */
-  PhysicalMemory(Addr size);
+  PhysicalMemory(Addr size, Backing backing_ = Backing::kDense);
   
-  virtual ~PhysicalMemory() { mem_data.clear(); }
+  virtual ~PhysicalMemory() { mem_data.clear(); frame_dir.clear(); }
   
   PhysicalMemory(const PhysicalMemory &other) = delete;  // no copy constructor
   PhysicalMemory(PhysicalMemory &&other) = delete;       // no move constructor
@@ -39,7 +54,22 @@ public:
    * 
    * @return number of bytes in physical memory 
    */
-  Addr size() const { return mem_data.size(); }
+  Addr size() const { return mem_size; }
+  
+  /**
+   * get_backing - return the host storage type of this memory
+   * 
+   * @return backing type specified at construction
+   */
+  Backing get_backing() const { return backing; }
+  
+  /**
+   * get_materialized_frame_count - return the number of page frames which 
+   *   currently occupy host memory. For dense backing this is every frame.
+   * 
+   * @return number of frames allocated on the host
+   */
+  Addr get_materialized_frame_count() const { return materialized_frames; }
   
   /**
    * get_byte - get a single byte from the specified address
@@ -58,6 +88,16 @@ public:
    */
   void get_bytes(uint8_t *dest, Addr address, Addr count);
   
+  /**
+   * get_16 - get a 16 bit (2 byte) value
+   * 
+   * @param dest where to copy to
+   * @param address source address
+   */
+  void get_16(uint16_t *dest, Addr address) {
+    get_bytes(reinterpret_cast<uint8_t*>(dest), address, 2);
+  }
+
   /**
    * get_32 - get a 32 bit (4 byte) value
    * 
@@ -68,6 +108,16 @@ public:
     get_bytes(reinterpret_cast<uint8_t*>(dest), address, 4);
   }
 
+  /**
+   * get_64 - get a 64 bit (8 byte) value
+   * 
+   * @param dest where to copy to
+   * @param address source address
+   */
+  void get_64(uint64_t *dest, Addr address) {
+    get_bytes(reinterpret_cast<uint8_t*>(dest), address, 8);
+  }
+
   /**
    * put_byte - store a single byte to the specified address
    * 
@@ -85,6 +135,122 @@ public:
    */
   void put_bytes(Addr address, Addr count, const uint8_t *src);
   
+  /**
+   * put_32 - store a 32 bit (4 byte) value
+   * 
+   * @param address destination in physical memory
+   * @param data value to store
+   */
+  void put_32(Addr address, uint32_t data) {
+    put_bytes(address, 4, reinterpret_cast<const uint8_t*>(&data));
+  }
+  
+  /**
+   * put_64 - store a 64 bit (8 byte) value
+   * 
+   * @param address destination in physical memory
+   * @param data value to store
+   */
+  void put_64(Addr address, uint64_t data) {
+    put_bytes(address, 8, reinterpret_cast<const uint8_t*>(&data));
+  }
+  
+  /*
+   * Unchecked accessors. These behave like the functions above but do not 
+   * call ValidateAddressRange, and are inline so that the dense case 
+   * reduces to a counter update and a copy. They are for internal callers 
+   * such as the MMU which have already established that the whole range 
+   * lies in memory (e.g. inside a page frame known to exist). Passing an 
+   * invalid range is undefined behavior.
+   */
+  
+  /**
+   * get_bytes_unchecked - get_bytes without the range check
+   */
+  void get_bytes_unchecked(uint8_t *dest, Addr address, Addr count) {
+    byte_count += count;
+    if (backing == Backing::kDense) {
+      memcpy(dest, &mem_data[address], count);
+    } else {
+      ReadSparse(dest, address, count);
+    }
+    if (account_access) AccountAccess(address, count, false);
+  }
+  
+  /**
+   * put_bytes_unchecked - put_bytes without the range check
+   */
+  void put_bytes_unchecked(Addr address, Addr count, const uint8_t *src) {
+    byte_count += count;
+    if (backing == Backing::kDense) {
+      memcpy(&mem_data[address], src, count);
+    } else {
+      WriteSparse(address, count, src);
+    }
+    if (account_access) AccountAccess(address, count, true);
+  }
+  
+  /**
+   * get_16_unchecked, get_32_unchecked, get_64_unchecked - typed loads 
+   *   without the range check
+   */
+  void get_16_unchecked(uint16_t *dest, Addr address) {
+    get_bytes_unchecked(reinterpret_cast<uint8_t*>(dest), address, 2);
+  }
+  void get_32_unchecked(uint32_t *dest, Addr address) {
+    get_bytes_unchecked(reinterpret_cast<uint8_t*>(dest), address, 4);
+  }
+  void get_64_unchecked(uint64_t *dest, Addr address) {
+    get_bytes_unchecked(reinterpret_cast<uint8_t*>(dest), address, 8);
+  }
+  
+  /**
+   * put_32_unchecked, put_64_unchecked - typed stores without the range 
+   *   check
+   */
+  void put_32_unchecked(Addr address, uint32_t data) {
+    put_bytes_unchecked(address, 4, reinterpret_cast<const uint8_t*>(&data));
+  }
+  void put_64_unchecked(Addr address, uint64_t data) {
+    put_bytes_unchecked(address, 8, reinterpret_cast<const uint8_t*>(&data));
+  }
+  
+  /**
+   * ZeroFrame - set every byte of a page frame to zero. Sparse memory 
+   *   releases the frame's host storage instead of writing zeros. Counts as
+   *   a write of the whole frame.
+   * 
+   * @param frame_address physical address of frame (multiple of kPageSize)
+   * @throws PhysicalMemoryBoundsException if not the address of a frame
+   */
+  void ZeroFrame(Addr frame_address);
+  
+  /**
+   * CopyFrame - copy the contents of one page frame to another. Sparse 
+   *   memory shares the host copy of the contents between the frames until
+   *   either is written. Counts as a read and a write of a whole frame.
+   * 
+   * @param dest_frame physical address of destination frame
+   * @param src_frame physical address of source frame
+   * @throws PhysicalMemoryBoundsException if either is not the address of a
+   *         frame
+   */
+  void CopyFrame(Addr dest_frame, Addr src_frame);
+  
+  /**
+   * get_atomic_pointer_unchecked - get the host address of a naturally 
+   *   aligned word, for atomic read-modify-write operations. The frame 
+   *   holding the word is made resident and private to this address 
+   *   (materialized, decompressed and unshared), so the pointer remains 
+   *   valid until the next deduplication or compression pass. Counts as a 
+   *   read and a write of size bytes. The range is not checked.
+   * 
+   * @param address physical address of word (must be a multiple of size)
+   * @param size size of word in bytes
+   * @return host pointer to word
+   */
+  uint8_t *get_atomic_pointer_unchecked(Addr address, Addr size);
+  
   /**
    * ValidateAddressRange - check that address range is valid, throw
    *   PhysicalMemoryBoundsException if not.
@@ -101,14 +267,475 @@ public:
    */
   uint64_t get_byte_count() const { return byte_count; }
   
+  /**
+   * DedupStats - results of a frame deduplication pass
+   */
+  class DedupStats {
+  public:
+    DedupStats()
+    : frames_scanned(0),
+      zero_frames_released(0),
+      frames_merged(0),
+      bytes_saved(0) {
+    }
+    
+    uint64_t frames_scanned;        // materialized frames examined
+    uint64_t zero_frames_released;  // all-zero frames returned to host
+    uint64_t frames_merged;         // frames now sharing another's contents
+    uint64_t bytes_saved;           // host bytes released by this pass
+  };
+  
+  /**
+   * DeduplicateFrames - scan all materialized frames, release frames which
+   *   contain only zeros, and merge frames with identical contents so that
+   *   they share one host copy. A shared frame is copied again on the next
+   *   write to any frame sharing it (copy-on-write), so the contents seen 
+   *   through get_bytes/put_bytes are unchanged.
+   * 
+   *   Only sparse memory can share frames; for dense backing nothing is
+   *   merged and the returned stats are all zero.
+   * 
+   * @param stats set to the results of this pass
+   */
+  void DeduplicateFrames(DedupStats &stats);
+  
+  /**
+   * get_shared_frame_count - return number of frames whose contents are
+   *   currently shared with at least one other frame.
+   * 
+   * @return count of shared frames
+   */
+  Addr get_shared_frame_count() const;
+  
+  /**
+   * CompressionStats - statistics for the compressed cold frame store.
+   *   Latency histograms count operations by duration: bucket i counts
+   *   operations taking from 2^i to 2^(i+1)-1 nanoseconds.
+   */
+  class CompressionStats {
+  public:
+    static const int kLatencyBuckets = 32;
+    
+    CompressionStats()
+    : compressed_frames(0),
+      uncompressed_bytes(0),
+      compressed_bytes(0),
+      compress_count(0),
+      decompress_count(0),
+      incompressible_count(0) {
+      compress_latency.fill(0);
+      decompress_latency.fill(0);
+    }
+    
+    /**
+     * ratio - compression ratio of frames currently in the store
+     * 
+     * @return original bytes / compressed bytes, or 0 if store is empty
+     */
+    double ratio() const {
+      return compressed_bytes == 0 ? 0.0 
+              : static_cast<double>(uncompressed_bytes) / compressed_bytes;
+    }
+    
+    uint64_t compressed_frames;     // frames currently held compressed
+    uint64_t uncompressed_bytes;    // original size of compressed frames
+    uint64_t compressed_bytes;      // host bytes used by compressed frames
+    uint64_t compress_count;        // total frames compressed
+    uint64_t decompress_count;      // total frames decompressed
+    uint64_t incompressible_count;  // frames left uncompressed (too little gain)
+    // every compression attempt, including incompressible frames
+    std::array<uint64_t, kLatencyBuckets> compress_latency;
+    std::array<uint64_t, kLatencyBuckets> decompress_latency;
+  };
+  
+  /**
+   * CompressColdFrames - compress every sparse frame which has not been
+   *   accessed during the last idle_bytes bytes transferred (byte_count is
+   *   the access clock). A compressed frame is decompressed on its next 
+   *   read or write. Frames shared by deduplication are not compressed.
+   *   Has no effect for dense backing.
+   * 
+   * @param idle_bytes minimum idle time, in bytes transferred
+   * @return number of frames compressed by this call
+   */
+  Addr CompressColdFrames(uint64_t idle_bytes);
+  
+  /**
+   * set_cold_frame_interval - compress cold frames automatically. After
+   *   every interval bytes transferred, frames idle for at least interval
+   *   bytes are compressed. Only used with sparse backing.
+   * 
+   * @param interval idle interval in bytes transferred (0 to disable)
+   */
+  void set_cold_frame_interval(uint64_t interval) {
+    cold_frame_interval = interval;
+    next_cold_scan = byte_count + interval;
+  }
+  
+  /**
+   * get_compression_stats - get statistics for the compressed frame store
+   * 
+   * @param stats set to a copy of the current statistics
+   */
+  void get_compression_stats(CompressionStats &stats) const { 
+    stats = compression_stats; 
+  }
+  
+  /**
+   * AccessTracking - per-frame access accounting mode.
+   * 
+   *   kOff     - no per-frame accounting (the default).
+   *   kExact   - every access is counted.
+   *   kSampled - about one access in sample_interval is counted, with its
+   *              counts scaled by sample_interval, so the totals estimate
+   *              the exact counts at a fraction of the cost. The gap between
+   *              samples is randomized so that strided access patterns 
+   *              don't alias with the sampling.
+   */
+  enum class AccessTracking { kOff, kExact, kSampled };
+  
+  /**
+   * FrameAccessCounts - access counts for one page frame. An access which
+   *   spans frames counts as one access to each frame it touches.
+   */
+  class FrameAccessCounts {
+  public:
+    FrameAccessCounts()
+    : reads(0), 
+      writes(0), 
+      read_bytes(0), 
+      write_bytes(0) {
+    }
+    
+    uint64_t total_bytes() const { return read_bytes + write_bytes; }
+    
+    uint64_t reads;        // number of read accesses
+    uint64_t writes;       // number of write accesses
+    uint64_t read_bytes;   // bytes read
+    uint64_t write_bytes;  // bytes written
+  };
+  
+  /**
+   * set_access_tracking - select per-frame access accounting mode. All 
+   *   per-frame counts are reset to zero.
+   * 
+   * @param mode accounting mode
+   * @param sample_interval_ average number of accesses per sample (used 
+   *                         only for kSampled; 0 is treated as 1)
+   */
+  void set_access_tracking(AccessTracking mode, uint32_t sample_interval_ = 64);
+  
+  /**
+   * get_access_tracking - return current per-frame accounting mode
+   */
+  AccessTracking get_access_tracking() const { return access_tracking; }
+  
+  /**
+   * get_frame_access_counts - snapshot of per-frame access counts
+   * 
+   * @param counts set to a copy of the counts, indexed by frame number (one
+   *               entry per frame; empty if accounting is off)
+   */
+  void get_frame_access_counts(std::vector<FrameAccessCounts> &counts) const {
+    counts = frame_access;
+  }
+  
+  /**
+   * ResetFrameAccessCounts - set all per-frame counts to zero
+   */
+  void ResetFrameAccessCounts();
+  
+  /**
+   * get_hot_frames - find the most heavily used frames
+   * 
+   * @param n maximum number of frames to return
+   * @param frames set to the numbers of the (at most n) frames with the 
+   *               most bytes transferred, most used first. Frames which 
+   *               were never accessed are not included.
+   */
+  void get_hot_frames(size_t n, std::vector<Addr> &frames) const;
+  
+  /**
+   * AddWatchpoint - call a handler whenever a range of physical memory is
+   *   read and/or written. The handler runs after the access completes (for
+   *   an MMU atomic operation, just before it). It may use this 
+   *   PhysicalMemory, but must not use the data access functions of an MMU
+   *   whose operation caused the access.
+   * 
+   * @param address first address of range
+   * @param length number of bytes in range (> 0)
+   * @param kinds kWatchRead, kWatchWrite, or kWatchReadWrite
+   * @param handler handler to call
+   * @return watchpoint number, for RemoveWatchpoint
+   * @throws PhysicalMemoryBoundsException if range not in memory
+   */
+  int AddWatchpoint(Addr address, Addr length, uint32_t kinds,
+                    const std::shared_ptr<WatchHandler> &handler);
+  
+  /**
+   * RemoveWatchpoint - remove a watchpoint
+   * 
+   * @param id watchpoint number returned by AddWatchpoint
+   * @return true if removed, false if no such watchpoint
+   */
+  bool RemoveWatchpoint(int id);
+  
+  /**
+   * BankConfig - one memory bank (NUMA node). Banks divide physical memory
+   *   into contiguous ranges of frames, in order, starting at frame 0. The
+   *   access costs are in arbitrary simulated time units, charged once per
+   *   access to each frame touched.
+   */
+  class BankConfig {
+  public:
+    BankConfig(Addr frame_count_, uint64_t local_cost_, uint64_t remote_cost_)
+    : frame_count(frame_count_), 
+      local_cost(local_cost_), 
+      remote_cost(remote_cost_) {
+    }
+    
+    Addr frame_count;      // number of frames in bank
+    uint64_t local_cost;   // cost of an access from the bank's own node
+    uint64_t remote_cost;  // cost of an access from any other node
+  };
+  
+  /**
+   * set_banks - divide memory into banks, each forming one node. Every 
+   *   access is charged to the current node (see set_current_node) as local
+   *   if the frame is in that node's bank, remote otherwise. Node statistics
+   *   are reset and the current node is set to 0. An empty list removes the
+   *   banks, leaving memory as a single node with no accounting.
+   * 
+   * @param banks_ configuration of each bank, in frame order
+   * @throws PhysicalMemoryBankConfigurationException if the frame counts
+   *         don't add up to the number of frames in memory
+   */
+  void set_banks(const std::vector<BankConfig> &banks_);
+  
+  /**
+   * get_node_count - return number of nodes (1 if no banks configured)
+   */
+  size_t get_node_count() const { return banks.empty() ? 1 : banks.size(); }
+  
+  /**
+   * get_node_first_frame, get_node_frame_count - range of frames in a node
+   * 
+   * @param node node number (< get_node_count())
+   */
+  Addr get_node_first_frame(size_t node) const {
+    return banks.empty() ? 0 : bank_first_frame.at(node);
+  }
+  Addr get_node_frame_count(size_t node) const {
+    return banks.empty() ? (mem_size >> kPageSizeBits) 
+                         : banks.at(node).frame_count;
+  }
+  
+  /**
+   * get_frame_node - return node holding a frame
+   * 
+   * @param frame frame number
+   * @return node number
+   */
+  size_t get_frame_node(Addr frame) const;
+  
+  /**
+   * set_current_node, get_current_node - node of the simulated CPU making
+   *   accesses
+   * 
+   * @param node node number (< get_node_count())
+   * @throws PhysicalMemoryBankConfigurationException if node doesn't exist
+   */
+  void set_current_node(size_t node);
+  size_t get_current_node() const { return current_node; }
+  
+  /**
+   * NodeStats - accesses made from one node
+   */
+  class NodeStats {
+  public:
+    NodeStats()
+    : local_accesses(0),
+      remote_accesses(0),
+      local_bytes(0),
+      remote_bytes(0),
+      access_cost(0) {
+    }
+    
+    uint64_t local_accesses;   // accesses to frames in the node's own bank
+    uint64_t remote_accesses;  // accesses to frames in other banks
+    uint64_t local_bytes;      // bytes transferred by local accesses
+    uint64_t remote_bytes;     // bytes transferred by remote accesses
+    uint64_t access_cost;      // total simulated cost of all accesses
+  };
+  
+  /**
+   * get_node_stats - get statistics for accesses made from a node
+   * 
+   * @param node node number (< get_node_count())
+   * @param stats set to a copy of the statistics (all zero if no banks)
+   */
+  void get_node_stats(size_t node, NodeStats &stats) const {
+    stats = banks.empty() ? NodeStats() : node_stats.at(node);
+  }
+  
+  /**
+   * ResetNodeStats - set statistics of all nodes to zero
+   */
+  void ResetNodeStats();
+  
 private:
+  // Contents of a single page frame in sparse memory. Aligned so that
+  // naturally aligned words in the frame can be accessed atomically.
+  class alignas(sizeof(uint64_t)) FrameData 
+  : public std::array<uint8_t, kPageSize> {
+  };
+  
+  /**
+   * FrameSlot - entry in the sparse frame directory. A frame is in one of
+   *   three states: zero (both pointers null), resident (data non-null), or
+   *   compressed (compressed non-null).
+   */
+  class FrameSlot {
+  public:
+    FrameSlot() : last_access(0) {}
+    
+    std::shared_ptr<FrameData> data;                   // resident contents
+    std::unique_ptr<std::vector<uint8_t>> compressed;  // compressed contents
+    uint64_t last_access;                              // byte_count at access
+  };
+  
   // Actual memory contents; ensure only a single PhysicalMemory instance
-  // can exist by making this static.
+  // can exist by making this static. Dense memory uses mem_data, sparse
+  // memory uses frame_dir.
+  // Frames with identical contents may share a FrameData after 
+  // deduplication; a shared FrameData is copied before it is written.
   static std::vector<uint8_t> mem_data;
+  static std::vector<FrameSlot> frame_dir;
+  
+  Addr mem_size;              // size of memory in bytes
+  Backing backing;            // host storage type
+  Addr materialized_frames;   // number of frames allocated on host
+  
+  // Compressed cold frame store
+  uint64_t cold_frame_interval;  // automatic compression interval (0 = off)
+  uint64_t next_cold_scan;       // byte_count at which to next compress
+  CompressionStats compression_stats;
+  
+  // Per-frame access accounting
+  AccessTracking access_tracking;
+  uint32_t sample_interval;    // average accesses per sample
+  uint32_t sample_countdown;   // accesses until next sample
+  uint32_t sample_seed;        // state of random sample gap generator
+  std::vector<FrameAccessCounts> frame_access;  // indexed by frame number
+  
+  // Memory banks (empty if not configured)
+  std::vector<BankConfig> banks;
+  std::vector<Addr> bank_first_frame;  // first frame of each bank
+  std::vector<NodeStats> node_stats;   // indexed by accessing node
+  size_t current_node;
+  
+  // Physical watchpoints
+  WatchList watches;
+  
+  // True if any per-access work (frame counts, banks or watchpoints) is 
+  // needed
+  bool account_access;
   
   // Define counter for number of bytes transferred.  Can be used as
   // pseudo-clock for ordering of cache entries.
   uint64_t byte_count;  // increments by one for every request
+  
+  /**
+   * UpdateAccountAccess - recompute account_access after a change of 
+   *   accounting mode, banks or watchpoints
+   */
+  void UpdateAccountAccess();
+  
+  /**
+   * AccountAccess - update per-frame counts and node statistics and check
+   *   watchpoints, as enabled
+   * 
+   * @param address first byte accessed
+   * @param count number of bytes accessed
+   * @param write true for a write, false for a read
+   */
+  void AccountAccess(Addr address, Addr count, bool write);
+  
+  /**
+   * CountNodeAccess - update node statistics (banks must be configured)
+   * 
+   * @param address first byte accessed
+   * @param count number of bytes accessed
+   */
+  void CountNodeAccess(Addr address, Addr count);
+  
+  /**
+   * CountAccess - update per-frame access counts (accounting must be on)
+   * 
+   * @param address first byte accessed
+   * @param count number of bytes accessed
+   * @param write true for a write, false for a read
+   */
+  void CountAccess(Addr address, Addr count, bool write);
+  
+  /**
+   * ReadSparse - copy bytes out of the frame directory, supplying zeros
+   *   for frames which have not been materialized.
+   * 
+   * @param dest where to copy to
+   * @param address source address (range must already be validated)
+   * @param count number of bytes to copy
+   */
+  void ReadSparse(uint8_t *dest, Addr address, Addr count);
+  
+  /**
+   * WriteSparse - copy bytes into the frame directory, materializing 
+   *   frames on first write and copying shared frames before writing.
+   * 
+   * @param address destination address (range must already be validated)
+   * @param count number of bytes to copy
+   * @param src source buffer
+   */
+  void WriteSparse(Addr address, Addr count, const uint8_t *src);
+  
+  /**
+   * WritableFrame - prepare a sparse frame to be written, allocating it if 
+   *   it reads as zeros and copying it if it is shared. The slot must 
+   *   already be resident (see TouchSlot).
+   * 
+   * @param slot frame directory entry
+   * @return frame contents
+   */
+  FrameData &WritableFrame(FrameSlot &slot);
+  
+  /**
+   * TouchSlot - record an access to a sparse frame, decompressing it if
+   *   it is in the compressed store.
+   * 
+   * @param slot frame directory entry
+   */
+  void TouchSlot(FrameSlot &slot) {
+    slot.last_access = byte_count;
+    if (slot.compressed) DecompressSlot(slot);
+  }
+  
+  /**
+   * DecompressSlot - move a frame from the compressed store back to 
+   *   resident memory
+   * 
+   * @param slot frame directory entry (must be compressed)
+   */
+  void DecompressSlot(FrameSlot &slot);
+  
+  /**
+   * CheckColdFrames - run automatic compression if it is due
+   */
+  void CheckColdFrames() {
+    if (cold_frame_interval != 0 && byte_count >= next_cold_scan) {
+      next_cold_scan = byte_count + cold_frame_interval;
+      CompressColdFrames(cold_frame_interval);
+    }
+  }
 };
 
 } // namespace mem
@@ -57,6 +57,13 @@ public:
    */
   void Flush();
   
+  /**
+   * Invalidate - remove the entry (if any) for the page containing vaddr
+   * 
+   * @param vaddr virtual address in page
+   */
+  void Invalidate(Addr vaddr) { tlb_map.erase(vaddr & kPageNumberMask); }
+  
 /**
    * TLBStats - statistics on TLB operations
    */
@@ -0,0 +1,76 @@
+/*
+ * Watchpoint - call a handler when a range of memory is read or written
+ *
+ * File:   Watchpoint.cpp
+ */
+
+#include "Watchpoint.h"
+
+#include <algorithm>
+
+namespace mem {
+
+int WatchList::Add(Addr address, Addr length, uint32_t kinds,
+                   const std::shared_ptr<WatchHandler> &handler) {
+  Watchpoint wp;
+  wp.id = next_id++;
+  wp.start = address;
+  wp.end = wp.start + length;
+  wp.kinds = kinds;
+  wp.handler = handler;
+  watchpoints.push_back(wp);
+  for (uint64_t page = wp.start >> kPageSizeBits;
+       page <= (wp.end - 1) >> kPageSizeBits; ++page) {
+    ++page_watch_count[page];
+  }
+  return wp.id;
+}
+
+bool WatchList::Remove(int id) {
+  auto wp = std::find_if(watchpoints.begin(), watchpoints.end(),
+                         [id](const Watchpoint &w) { return w.id == id; });
+  if (wp == watchpoints.end()) return false;
+  for (uint64_t page = wp->start >> kPageSizeBits;
+       page <= (wp->end - 1) >> kPageSizeBits; ++page) {
+    --page_watch_count[page];
+  }
+  watchpoints.erase(wp);
+  return true;
+}
+
+void WatchList::Check(Addr address, Addr count, bool write) {
+  if (in_handler) return;
+  uint64_t start = address;
+  uint64_t end = start + count;
+
+  // Most accesses touch no watched page
+  bool watched = false;
+  for (uint64_t page = start >> kPageSizeBits; 
+       page <= (end - 1) >> kPageSizeBits; ++page) {
+    watched |= page_watch_count[page] != 0;
+  }
+  if (!watched) return;
+
+  uint32_t kind = write ? kWatchWrite : kWatchRead;
+
+  // Copy the matching watchpoints first, so a handler may add or remove
+  // watchpoints
+  std::vector<Watchpoint> hits;
+  for (const Watchpoint &wp : watchpoints) {
+    if ((wp.kinds & kind) != 0 && wp.start < end && start < wp.end) {
+      hits.push_back(wp);
+    }
+  }
+  in_handler = true;
+  try {
+    for (const Watchpoint &wp : hits) {
+      wp.handler->Run(WatchEvent(wp.id, address, count, write));
+    }
+  } catch (...) {
+    in_handler = false;
+    throw;
+  }
+  in_handler = false;
+}
+
+} // namespace mem
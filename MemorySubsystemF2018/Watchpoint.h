@@ -0,0 +1,133 @@
+/*
+ * Watchpoint - call a handler when a range of memory is read or written
+ *
+ * WatchList holds the watchpoints for one address space (physical memory, or
+ * the virtual address space of the MMU), together with a count per page of
+ * the watchpoints covering it. Check looks at the watchpoints only if the
+ * access touches a watched page, and owners test empty() before calling
+ * Check at all, so there is no cost when there are no watchpoints.
+ *
+ * File:   Watchpoint.h
+ */
+
+#ifndef MEM_WATCHPOINT_H
+#define MEM_WATCHPOINT_H
+
+#include "MemoryDefs.h"
+
+#include <memory>
+#include <vector>
+
+namespace mem {
+
+// Kinds of access which trigger a watchpoint (may be combined with |)
+const uint32_t kWatchRead = 1;
+const uint32_t kWatchWrite = 2;
+const uint32_t kWatchReadWrite = kWatchRead | kWatchWrite;
+
+/**
+ * WatchEvent - description of an access which triggered a watchpoint
+ */
+class WatchEvent {
+public:
+  WatchEvent(int id_, Addr address_, Addr count_, bool write_)
+  : id(id_), address(address_), count(count_), write(write_) {
+  }
+
+  int id;         // watchpoint number, as returned when it was added
+  Addr address;   // first address accessed (may be before the watched range)
+  Addr count;     // number of bytes accessed
+  bool write;     // true for a write, false for a read
+};
+
+/**
+ * WatchHandler - abstract base class for watchpoint handler
+ *
+ * To define a handler, create a derived class, supplying the Run function.
+ * Accesses made while a handler runs don't trigger watchpoints.
+ */
+class WatchHandler {
+public:
+  virtual void Run(const WatchEvent &event) = 0;  // derived class must override
+protected:
+  WatchHandler() {}  // protected - only a derived class object can be created
+};
+
+class WatchList {
+public:
+  /**
+   * Constructor
+   *
+   * @param page_count number of pages in the watched address space
+   */
+  WatchList(Addr page_count) : page_watch_count(page_count, 0), next_id(1),
+                               in_handler(false) {
+  }
+
+  /**
+   * empty - true if there are no watchpoints
+   */
+  bool empty() const { return watchpoints.empty(); }
+
+  /**
+   * IsWatchedPage - true if any watchpoint covers part of a page
+   *
+   * @param page page number
+   */
+  bool IsWatchedPage(Addr page) const { return page_watch_count[page] != 0; }
+
+  /**
+   * Add - add a watchpoint. The range must lie in the address space.
+   *
+   * @param address first address of range
+   * @param length number of bytes in range (> 0)
+   * @param kinds kWatchRead, kWatchWrite, or both
+   * @param handler called on each access overlapping the range
+   * @return watchpoint number (> 0)
+   */
+  int Add(Addr address, Addr length, uint32_t kinds,
+          const std::shared_ptr<WatchHandler> &handler);
+
+  /**
+   * Remove - remove a watchpoint
+   *
+   * @param id watchpoint number
+   * @return true if removed, false if no such watchpoint
+   */
+  bool Remove(int id);
+
+  /**
+   * Check - call the handler of each watchpoint overlapping an access.
+   *   Does nothing while a handler is already running. The range must lie
+   *   in the address space.
+   *
+   * @param address first address accessed
+   * @param count number of bytes accessed (> 0)
+   * @param write true for a write, false for a read
+   */
+  void Check(Addr address, Addr count, bool write);
+
+private:
+  /**
+   * Watchpoint - a single watched range
+   */
+  class Watchpoint {
+  public:
+    int id;
+    uint64_t start;   // first address
+    uint64_t end;     // last address + 1
+    uint32_t kinds;   // accesses which trigger
+    std::shared_ptr<WatchHandler> handler;
+  };
+
+  // Number of watchpoints covering each page
+  std::vector<uint32_t> page_watch_count;
+
+  std::vector<Watchpoint> watchpoints;
+  int next_id;      // number of next watchpoint added
+  bool in_handler;  // true while a handler is running
+};
+
+} // namespace mem
+
+#endif /* MEM_WATCHPOINT_H */
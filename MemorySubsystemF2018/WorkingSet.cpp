@@ -0,0 +1,52 @@
+/*
+ * WorkingSet - estimate the working set of an address space from the
+ *   accessed bits of its page table
+ *
+ * File:   WorkingSet.cpp
+ */
+
+#include "WorkingSet.h"
+
+namespace mem {
+
+const uint32_t WorkingSetEstimator::kMaxIdleAge;
+const uint16_t WorkingSetEstimator::kNotPresent;
+
+WorkingSetEstimator::WorkingSetEstimator(MMU &mmu_, Addr page_table_base_)
+: mmu(mmu_), page_table_base(page_table_base_),
+  idle_age(kPageTableEntries, kNotPresent) {
+}
+
+Addr WorkingSetEstimator::Scan() {
+  Addr accessed_count = mmu.HarvestAccessedBits(page_table_base, entries);
+  
+  // Update every page with the same branch-free arithmetic, so the loop
+  // vectorizes
+  uint16_t *age = idle_age.data();
+  for (Addr i = 0; i < kPageTableEntries; ++i) {
+    uint32_t page_present = (entries[i] >> kPTE_Present) & 1;
+    uint32_t idle = page_present & ~(entries[i] >> kPTE_Accessed);
+    uint32_t previous = age[i] == kNotPresent ? 0 : age[i];
+    uint32_t next_age = (previous + (previous < kMaxIdleAge)) & -idle;
+    age[i] = page_present ? next_age : kNotPresent;
+  }
+  wss_history.push_back(accessed_count);
+  return accessed_count;
+}
+
+Addr WorkingSetEstimator::get_working_set_size(uint32_t window) const {
+  Addr count = 0;
+  for (Addr i = 0; i < kPageTableEntries; ++i) {
+    count += idle_age[i] < window;  // kNotPresent is never in the window
+  }
+  return count;
+}
+
+void WorkingSetEstimator::get_idle_histogram(std::vector<Addr> &histogram) const {
+  histogram.assign(kMaxIdleAge + 1, 0);
+  for (Addr i = 0; i < kPageTableEntries; ++i) {
+    if (idle_age[i] != kNotPresent) ++histogram[idle_age[i]];
+  }
+}
+
+} // namespace mem
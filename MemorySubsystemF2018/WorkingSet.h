@@ -0,0 +1,96 @@
+/*
+ * WorkingSet - estimate the working set of an address space from the
+ *   accessed bits of its page table
+ *
+ * Each call to Scan harvests and clears the accessed bits (see 
+ * MMU::HarvestAccessedBits). A present page which was accessed since the
+ * previous scan gets idle age 0; any other present page ages by one scan,
+ * saturating at kMaxIdleAge. The working set size for a window of n scans
+ * is the number of present pages with idle age less than n.
+ *
+ * File:   WorkingSet.h
+ */
+
+#ifndef MEM_WORKINGSET_H
+#define MEM_WORKINGSET_H
+
+#include "MMU.h"
+
+#include <vector>
+
+namespace mem {
+
+class WorkingSetEstimator {
+public:
+  // Largest idle age (scans since last access)
+  static const uint32_t kMaxIdleAge = 255;
+  
+  /**
+   * Constructor - no pages are counted until the first scan
+   * 
+   * @param mmu_ MMU holding the page table
+   * @param page_table_base_ physical address of page table to scan
+   */
+  WorkingSetEstimator(MMU &mmu_, Addr page_table_base_);
+  
+  /**
+   * Scan - harvest accessed bits and update idle ages
+   * 
+   * @return number of pages accessed since the previous scan
+   */
+  Addr Scan();
+  
+  /**
+   * get_scan_count - number of scans so far
+   */
+  size_t get_scan_count() const { return wss_history.size(); }
+  
+  /**
+   * get_working_set_size - number of present pages accessed in the last 
+   *   window scans
+   * 
+   * @param window number of scans (1 to kMaxIdleAge)
+   */
+  Addr get_working_set_size(uint32_t window = 1) const;
+  
+  /**
+   * get_wss_history - working set size (pages accessed since the previous
+   *   scan) recorded by each scan, oldest first
+   */
+  const std::vector<Addr> &get_wss_history() const { return wss_history; }
+  
+  /**
+   * get_idle_histogram - count present pages by idle age
+   * 
+   * @param histogram resized to kMaxIdleAge + 1; entry n is set to the 
+   *        number of present pages with idle age n
+   */
+  void get_idle_histogram(std::vector<Addr> &histogram) const;
+  
+  /**
+   * get_idle_age - idle age of a page (0 if not present at last scan)
+   * 
+   * @param vaddress virtual address in the page
+   */
+  uint32_t get_idle_age(Addr vaddress) const {
+    uint16_t age = idle_age[(vaddress >> kPageSizeBits) & kPageTableIndexMask];
+    return age == kNotPresent ? 0 : age;
+  }
+  
+private:
+  MMU &mmu;
+  Addr page_table_base;
+  
+  // Idle age of each page, indexed by page number (kNotPresent if not 
+  // present at last scan)
+  static const uint16_t kNotPresent = 0xFFFF;
+  std::vector<uint16_t> idle_age;
+  
+  std::vector<Addr> wss_history;  // pages accessed, by scan
+  
+  PageTable entries;  // page table read by last scan
+};
+
+} // namespace mem
+
+#endif /* MEM_WORKINGSET_H */
@@ -0,0 +1,132 @@
+/*
+ * DemandZeroBench - compare first-touch fault cost of demand-zero pages
+ *   mapped by the MMU with pages mapped by a user page fault handler
+ *
+ * Each round maps every page of a user address space, then touches each
+ * page once with a 4 byte write. The user handler does what an OS handler
+ * would: take a frame, zero it through the kernel mapping, and write the
+ * page table entry.
+ *
+ * Build and run with "make bench" in the project directory.
+ *
+ * File:   DemandZeroBench.cpp
+ */
+
+#include "../MMU.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace mem;
+
+namespace {
+
+const Addr kUserPages = kPageTableEntries - 8;  // leave room for kernel frames
+const Addr kFirstUserFrame = 4;
+const Addr kFrames = kFirstUserFrame + kUserPages;
+const Addr kKernelPageTableBase = 1 * kPageSize;
+const Addr kPageTableBase = 2 * kPageSize;
+const int kRounds = 20;
+
+/**
+ * StackFrameAllocator - hands out the user frames in order
+ */
+class StackFrameAllocator : public FrameAllocator {
+public:
+  StackFrameAllocator() : next(kFirstUserFrame) {}
+  virtual bool Allocate(Addr &frame_address) {
+    if (next >= kFrames) return false;
+    frame_address = next++ * kPageSize;
+    return true;
+  }
+  virtual void Free(Addr frame_address) {}
+  void Reset() { next = kFirstUserFrame; }
+private:
+  Addr next;
+};
+
+/**
+ * ZeroFillHandler - page fault handler which maps a zeroed frame
+ */
+class ZeroFillHandler : public MMU::FaultHandler {
+public:
+  ZeroFillHandler(MMU &vm_, StackFrameAllocator &frames_)
+  : vm(vm_), frames(frames_), zeros(kPageSize, 0) {}
+  virtual bool Run(const PMCB &pmcb) {
+    Addr frame;
+    if (!frames.Allocate(frame)) return false;
+    vm.put_bytes(frame, kPageSize, zeros.data());
+    PageTableEntry pt_entry = frame | kPTE_PresentMask | kPTE_WritableMask;
+    vm.put_bytes(pmcb.page_table_base
+                 + (pmcb.next_vaddress >> kPageSizeBits) * sizeof(PageTableEntry),
+                 sizeof(pt_entry), &pt_entry);
+    return true;
+  }
+private:
+  MMU &vm;
+  StackFrameAllocator &frames;
+  std::vector<uint8_t> zeros;
+};
+
+/**
+ * ClearUserPageTable - unmap all user pages (in kernel mode)
+ */
+void ClearUserPageTable(MMU &vm) {
+  vm.set_kernel_PMCB();
+  vm.FlushTLB();
+  PageTable page_table;
+  vm.put_bytes(kPageTableBase, kPageTableSizeBytes, &page_table);
+}
+
+/**
+ * TouchAll - write to each user page once, return ns per page
+ */
+double TouchAll(MMU &vm) {
+  vm.set_user_PMCB(PMCB(kPageTableBase));
+  vm.FlushTLB();
+  auto start = std::chrono::steady_clock::now();
+  for (Addr page = 0; page < kUserPages; ++page) {
+    uint32_t value = page;
+    vm.put_bytes(page * kPageSize, sizeof(value), &value);
+  }
+  return std::chrono::duration<double, std::nano>(
+          std::chrono::steady_clock::now() - start).count() / kUserPages;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  MMU vm(kFrames, 64);
+  PageTable kernel_page_table;
+  for (Addr i = 0; i < kFrames; ++i) {
+    kernel_page_table.at(i) = (i << kPageSizeBits) | kPTE_PresentMask
+            | kPTE_WritableMask;
+  }
+  vm.put_bytes(kKernelPageTableBase, kPageTableSizeBytes, &kernel_page_table);
+  vm.enter_virtual_mode(PMCB(kKernelPageTableBase));
+
+  auto frames = std::make_shared<StackFrameAllocator>();
+  vm.SetFrameAllocator(frames);
+  vm.SetPageFaultHandler(std::make_shared<ZeroFillHandler>(vm, *frames));
+
+  double handler_ns = 0, demand_zero_ns = 0;
+  for (int round = 0; round < kRounds; ++round) {
+    // User fault handler
+    ClearUserPageTable(vm);
+    frames->Reset();
+    handler_ns += TouchAll(vm);
+
+    // Demand-zero region mapped by the MMU
+    ClearUserPageTable(vm);
+    frames->Reset();
+    vm.set_user_PMCB(PMCB(kPageTableBase));
+    vm.MapAnonymous(0, kUserPages * kPageSize, true);
+    demand_zero_ns += TouchAll(vm);
+  }
+  printf("%-36s %8.1f ns/page\n", "first touch, user fault handler",
+         handler_ns / kRounds);
+  printf("%-36s %8.1f ns/page\n", "first touch, demand-zero (MMU)",
+         demand_zero_ns / kRounds);
+  return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * PhysicalMemoryBench - compare checked and unchecked PhysicalMemory access
+ *
+ * Times small loads and stores through the public (range checked) API and
+ * through the unchecked accessors used by the MMU on validated paths, plus
+ * MMU reads which use the unchecked path internally.
+ *
+ * Build and run with "make bench" in the project directory.
+ *
+ * File:   PhysicalMemoryBench.cpp
+ */
+
+#include "../MMU.h"
+#include "../PhysicalMemory.h"
+
+#include <chrono>
+#include <cstdio>
+
+using mem::Addr;
+using mem::MMU;
+using mem::PhysicalMemory;
+
+namespace {
+
+const Addr kFrames = 256;
+const Addr kMemSize = kFrames * mem::kPageSize;
+const int kIterations = 20000000;
+
+// Sink for loaded values, so the loads aren't optimized away
+volatile uint64_t sink;
+
+/**
+ * Time - run a benchmark body and print nanoseconds per iteration
+ *
+ * @param name label for output
+ * @param body function run once per iteration, given the iteration number
+ */
+template <typename Body>
+void Time(const char *name, Body body) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIterations; ++i) {
+    body(i);
+  }
+  double ns = std::chrono::duration<double, std::nano>(
+          std::chrono::steady_clock::now() - start).count();
+  printf("%-36s %8.2f ns/op\n", name, ns / kIterations);
+}
+
+// Spread accesses over memory, 8 byte aligned
+inline Addr AddrFor(uint32_t i) {
+  return (i * 2654435761U) % (kMemSize - 8) & ~7U;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  {
+    PhysicalMemory pm(kMemSize);
+    Time("get_32 (checked)", [&pm](uint32_t i) {
+      uint32_t v;
+      pm.get_32(&v, AddrFor(i));
+      sink = v;
+    });
+    Time("get_32_unchecked", [&pm](uint32_t i) {
+      uint32_t v;
+      pm.get_32_unchecked(&v, AddrFor(i));
+      sink = v;
+    });
+    Time("put_64 (checked)", [&pm](uint32_t i) {
+      pm.put_64(AddrFor(i), i);
+    });
+    Time("put_64_unchecked", [&pm](uint32_t i) {
+      pm.put_64_unchecked(AddrFor(i), i);
+    });
+    Time("get_bytes 64 (checked)", [&pm](uint32_t i) {
+      uint8_t buf[64];
+      pm.get_bytes(buf, AddrFor(i) & ~63U, sizeof(buf));
+      sink = buf[0];
+    });
+    Time("get_bytes_unchecked 64", [&pm](uint32_t i) {
+      uint8_t buf[64];
+      pm.get_bytes_unchecked(buf, AddrFor(i) & ~63U, sizeof(buf));
+      sink = buf[0];
+    });
+  }
+  {
+    MMU vm(kFrames);
+    Time("MMU::get_bytes 4 (physical mode)", [&vm](uint32_t i) {
+      uint32_t v;
+      vm.get_bytes(&v, AddrFor(i), sizeof(v));
+      sink = v;
+    });
+  }
+  return 0;
+}
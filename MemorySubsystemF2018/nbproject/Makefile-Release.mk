@@ -35,10 +35,15 @@ OBJECTDIR=${CND_BUILDDIR}/${CND_CONF}/${CND_PLATFORM}
 
 # Object Files
 OBJECTFILES= \
+	${OBJECTDIR}/CacheHierarchy.o \
+	${OBJECTDIR}/Checkpoint.o \
 	${OBJECTDIR}/Exceptions.o \
+	${OBJECTDIR}/FrameCodec.o \
 	${OBJECTDIR}/MMU.o \
 	${OBJECTDIR}/PhysicalMemory.o \
-	${OBJECTDIR}/TLB.o
+	${OBJECTDIR}/TLB.o \
+	${OBJECTDIR}/Watchpoint.o \
+	${OBJECTDIR}/WorkingSet.o
 
 # Test Directory
 TESTDIR=${CND_BUILDDIR}/${CND_CONF}/${CND_PLATFORM}/tests
@@ -49,9 +54,13 @@ TESTFILES= \
 
 # Test Object Files
 TESTOBJECTFILES= \
+	${TESTDIR}/tests/CacheHierarchyTests.o \
+	${TESTDIR}/tests/CheckpointTests.o \
+	${TESTDIR}/tests/FrameCodecTests.o \
 	${TESTDIR}/tests/MMUTests.o \
 	${TESTDIR}/tests/PhysicalMemoryTests.o \
-	${TESTDIR}/tests/TLBTests.o
+	${TESTDIR}/tests/TLBTests.o \
+	${TESTDIR}/tests/WorkingSetTests.o
 
 # C Compiler Flags
 CFLAGS=
@@ -79,11 +88,26 @@ ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/libmemorysubsystemf2018.a: ${OBJECTFI
 	${AR} -rv ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/libmemorysubsystemf2018.a ${OBJECTFILES} 
 	$(RANLIB) ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/libmemorysubsystemf2018.a
 
+${OBJECTDIR}/CacheHierarchy.o: CacheHierarchy.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/CacheHierarchy.o CacheHierarchy.cpp
+
+${OBJECTDIR}/Checkpoint.o: Checkpoint.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/Checkpoint.o Checkpoint.cpp
+
 ${OBJECTDIR}/Exceptions.o: Exceptions.cpp
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
 	$(COMPILE.cc) -O2 -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/Exceptions.o Exceptions.cpp
 
+${OBJECTDIR}/FrameCodec.o: FrameCodec.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/FrameCodec.o FrameCodec.cpp
+
 ${OBJECTDIR}/MMU.o: MMU.cpp
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
@@ -99,6 +123,16 @@ ${OBJECTDIR}/TLB.o: TLB.cpp
 	${RM} "$@.d"
 	$(COMPILE.cc) -O2 -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/TLB.o TLB.cpp
 
+${OBJECTDIR}/Watchpoint.o: Watchpoint.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/Watchpoint.o Watchpoint.cpp
+
+${OBJECTDIR}/WorkingSet.o: WorkingSet.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/WorkingSet.o WorkingSet.cpp
+
 # Subprojects
 .build-subprojects:
 
@@ -106,11 +140,26 @@ ${OBJECTDIR}/TLB.o: TLB.cpp
 .build-tests-conf: .build-tests-subprojects .build-conf ${TESTFILES}
 .build-tests-subprojects:
 
-${TESTDIR}/TestFiles/f1: ${TESTDIR}/tests/MMUTests.o ${TESTDIR}/tests/PhysicalMemoryTests.o ${TESTDIR}/tests/TLBTests.o ${OBJECTFILES:%.o=%_nomain.o}
+${TESTDIR}/TestFiles/f1: ${TESTDIR}/tests/CacheHierarchyTests.o ${TESTDIR}/tests/CheckpointTests.o ${TESTDIR}/tests/FrameCodecTests.o ${TESTDIR}/tests/MMUTests.o ${TESTDIR}/tests/PhysicalMemoryTests.o ${TESTDIR}/tests/TLBTests.o ${TESTDIR}/tests/WorkingSetTests.o ${OBJECTFILES:%.o=%_nomain.o}
 	${MKDIR} -p ${TESTDIR}/TestFiles
 	${LINK.cc} -o ${TESTDIR}/TestFiles/f1 $^ ${LDLIBSOPTIONS}   
 
 
+${TESTDIR}/tests/CacheHierarchyTests.o: tests/CacheHierarchyTests.cpp 
+	${MKDIR} -p ${TESTDIR}/tests
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I. -std=c++14 -MMD -MP -MF "$@.d" -o ${TESTDIR}/tests/CacheHierarchyTests.o tests/CacheHierarchyTests.cpp
+
+${TESTDIR}/tests/CheckpointTests.o: tests/CheckpointTests.cpp 
+	${MKDIR} -p ${TESTDIR}/tests
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I. -std=c++14 -MMD -MP -MF "$@.d" -o ${TESTDIR}/tests/CheckpointTests.o tests/CheckpointTests.cpp
+
+${TESTDIR}/tests/FrameCodecTests.o: tests/FrameCodecTests.cpp 
+	${MKDIR} -p ${TESTDIR}/tests
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I. -std=c++14 -MMD -MP -MF "$@.d" -o ${TESTDIR}/tests/FrameCodecTests.o tests/FrameCodecTests.cpp
+
 ${TESTDIR}/tests/MMUTests.o: tests/MMUTests.cpp 
 	${MKDIR} -p ${TESTDIR}/tests
 	${RM} "$@.d"
@@ -129,6 +178,38 @@ ${TESTDIR}/tests/TLBTests.o: tests/TLBTests.cpp
 	$(COMPILE.cc) -O2 -I. -std=c++14 -MMD -MP -MF "$@.d" -o ${TESTDIR}/tests/TLBTests.o tests/TLBTests.cpp
 
 
+${TESTDIR}/tests/WorkingSetTests.o: tests/WorkingSetTests.cpp 
+	${MKDIR} -p ${TESTDIR}/tests
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I. -std=c++14 -MMD -MP -MF "$@.d" -o ${TESTDIR}/tests/WorkingSetTests.o tests/WorkingSetTests.cpp
+
+
+${OBJECTDIR}/CacheHierarchy_nomain.o: ${OBJECTDIR}/CacheHierarchy.o CacheHierarchy.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/CacheHierarchy.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -std=c++14 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/CacheHierarchy_nomain.o CacheHierarchy.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/CacheHierarchy.o ${OBJECTDIR}/CacheHierarchy_nomain.o;\
+	fi
+
+${OBJECTDIR}/Checkpoint_nomain.o: ${OBJECTDIR}/Checkpoint.o Checkpoint.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/Checkpoint.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -std=c++14 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/Checkpoint_nomain.o Checkpoint.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/Checkpoint.o ${OBJECTDIR}/Checkpoint_nomain.o;\
+	fi
+
 ${OBJECTDIR}/Exceptions_nomain.o: ${OBJECTDIR}/Exceptions.o Exceptions.cpp 
 	${MKDIR} -p ${OBJECTDIR}
 	@NMOUTPUT=`${NM} ${OBJECTDIR}/Exceptions.o`; \
@@ -142,6 +223,19 @@ ${OBJECTDIR}/Exceptions_nomain.o: ${OBJECTDIR}/Exceptions.o Exceptions.cpp
 	    ${CP} ${OBJECTDIR}/Exceptions.o ${OBJECTDIR}/Exceptions_nomain.o;\
 	fi
 
+${OBJECTDIR}/FrameCodec_nomain.o: ${OBJECTDIR}/FrameCodec.o FrameCodec.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/FrameCodec.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -std=c++14 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/FrameCodec_nomain.o FrameCodec.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/FrameCodec.o ${OBJECTDIR}/FrameCodec_nomain.o;\
+	fi
+
 ${OBJECTDIR}/MMU_nomain.o: ${OBJECTDIR}/MMU.o MMU.cpp 
 	${MKDIR} -p ${OBJECTDIR}
 	@NMOUTPUT=`${NM} ${OBJECTDIR}/MMU.o`; \
@@ -181,6 +275,32 @@ ${OBJECTDIR}/TLB_nomain.o: ${OBJECTDIR}/TLB.o TLB.cpp
 	    ${CP} ${OBJECTDIR}/TLB.o ${OBJECTDIR}/TLB_nomain.o;\
 	fi
 
+${OBJECTDIR}/Watchpoint_nomain.o: ${OBJECTDIR}/Watchpoint.o Watchpoint.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/Watchpoint.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -std=c++14 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/Watchpoint_nomain.o Watchpoint.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/Watchpoint.o ${OBJECTDIR}/Watchpoint_nomain.o;\
+	fi
+
+${OBJECTDIR}/WorkingSet_nomain.o: ${OBJECTDIR}/WorkingSet.o WorkingSet.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/WorkingSet.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -std=c++14 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/WorkingSet_nomain.o WorkingSet.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/WorkingSet.o ${OBJECTDIR}/WorkingSet_nomain.o;\
+	fi
+
 # Run Test Targets
 .test-conf:
 	@if [ "${TEST}" = "" ]; \
@@ -0,0 +1,149 @@
+/*
+ * File:   CacheHierarchyTests.cpp
+ */
+#include "../CacheHierarchy.h"
+#include "../Exceptions.h"
+#include "../MMU.h"
+
+#include <gtest/gtest.h>
+
+using mem::Addr;
+using mem::CacheHierarchy;
+using mem::kPageSize;
+
+class CacheHierarchyTests : public testing::Test {
+protected:
+  /**
+   * Stats - get statistics for a level
+   */
+  CacheHierarchy::LevelStats Stats(const CacheHierarchy &cache, size_t level) {
+    CacheHierarchy::LevelStats stats;
+    cache.get_stats(level, stats);
+    return stats;
+  }
+};
+
+TEST_F(CacheHierarchyTests, Config) {
+  EXPECT_THROW(CacheHierarchy(std::vector<CacheHierarchy::LevelConfig>()),
+               mem::InvalidCacheConfigurationException);
+  EXPECT_THROW(CacheHierarchy({ CacheHierarchy::LevelConfig(1024, 2, 48) }),
+               mem::InvalidCacheConfigurationException);
+  EXPECT_THROW(CacheHierarchy({ CacheHierarchy::LevelConfig(1000, 2, 64) }),
+               mem::InvalidCacheConfigurationException);
+  EXPECT_THROW(CacheHierarchy({ CacheHierarchy::LevelConfig(3 * 128, 2, 64) }),
+               mem::InvalidCacheConfigurationException);
+  EXPECT_THROW(CacheHierarchy({ CacheHierarchy::LevelConfig(1024, 0, 64) }),
+               mem::InvalidCacheConfigurationException);
+
+  CacheHierarchy cache(CacheHierarchy::DefaultConfig());
+  EXPECT_EQ(3, cache.get_level_count());
+}
+
+TEST_F(CacheHierarchyTests, HitsAndMisses) {
+  // Single level: 2 sets of 2 ways, 64 byte lines
+  CacheHierarchy cache({ CacheHierarchy::LevelConfig(256, 2, 64) });
+
+  cache.Access(0, 4, false);     // miss
+  cache.Access(60, 4, false);    // hit, same line
+  cache.Access(62, 4, false);    // spans two lines: hit, then miss
+  CacheHierarchy::LevelStats stats = Stats(cache, 0);
+  EXPECT_EQ(2, stats.read_hits);
+  EXPECT_EQ(2, stats.read_misses);
+  EXPECT_EQ(0, stats.writebacks);
+
+  // Lines 0, 128 and 256 all map to set 0. Write line 0, touch 128, then
+  // load 256: line 0 is least recently used, so it's evicted and written back
+  cache.Access(0, 8, true);      // write hit
+  cache.Access(128, 8, false);   // miss
+  cache.Access(256, 8, false);   // miss, evicts dirty line 0
+  stats = Stats(cache, 0);
+  EXPECT_EQ(1, stats.write_hits);
+  EXPECT_EQ(4, stats.read_misses);
+  EXPECT_EQ(1, stats.writebacks);
+
+  // Line 128 is still cached; line 0 isn't
+  cache.Access(128, 1, false);
+  cache.Access(0, 1, true);      // write miss, allocates line
+  stats = Stats(cache, 0);
+  EXPECT_EQ(3, stats.read_hits);
+  EXPECT_EQ(1, stats.write_misses);
+
+  // Flush writes back the one dirty line
+  cache.Flush();
+  EXPECT_EQ(2, Stats(cache, 0).writebacks);
+  cache.ResetStats();
+  cache.Access(128, 1, false);   // miss after flush
+  EXPECT_EQ(1, Stats(cache, 0).read_misses);
+  EXPECT_EQ(0, Stats(cache, 0).writebacks);
+}
+
+TEST_F(CacheHierarchyTests, Levels) {
+  // Direct mapped 128 byte L1 over 4-way 1 KiB L2
+  CacheHierarchy cache({ CacheHierarchy::LevelConfig(128, 1, 64),
+                         CacheHierarchy::LevelConfig(1024, 4, 64) });
+
+  cache.Access(0, 64, true);     // L1 write miss, L2 read miss (fill)
+  cache.Access(128, 64, false);  // L1 miss evicts dirty line 0 to L2 (hit)
+  cache.Access(0, 64, false);    // L1 miss, L2 hit
+  CacheHierarchy::LevelStats l1 = Stats(cache, 0);
+  CacheHierarchy::LevelStats l2 = Stats(cache, 1);
+  EXPECT_EQ(1, l1.write_misses);
+  EXPECT_EQ(2, l1.read_misses);
+  EXPECT_EQ(0, l1.hits());
+  EXPECT_EQ(1, l1.writebacks);
+  EXPECT_EQ(2, l2.read_misses);
+  EXPECT_EQ(1, l2.read_hits);
+  EXPECT_EQ(1, l2.write_hits);
+  EXPECT_EQ(0, l2.writebacks);
+
+  // Flush pushes the dirty L2 line out to memory
+  cache.Flush();
+  EXPECT_EQ(1, Stats(cache, 1).writebacks);
+}
+
+TEST_F(CacheHierarchyTests, WritePolicies) {
+  // Write-through, no-write-allocate direct mapped L1 over a write-back L2
+  CacheHierarchy cache({ CacheHierarchy::LevelConfig(
+                             128, 1, 64, 
+                             CacheHierarchy::WritePolicy::kWriteThrough, false),
+                         CacheHierarchy::LevelConfig(1024, 4, 64) });
+
+  cache.Access(0, 8, true);      // L1 write miss, not allocated; L2 fills
+  cache.Access(0, 8, false);     // L1 read miss, L2 hit
+  cache.Access(0, 8, true);      // L1 write hit, written through to L2
+  cache.Access(128, 8, false);   // L1 miss evicts clean line 0
+  CacheHierarchy::LevelStats l1 = Stats(cache, 0);
+  CacheHierarchy::LevelStats l2 = Stats(cache, 1);
+  EXPECT_EQ(1, l1.write_misses);
+  EXPECT_EQ(1, l1.write_hits);
+  EXPECT_EQ(2, l1.read_misses);
+  EXPECT_EQ(2, l1.write_throughs);
+  EXPECT_EQ(0, l1.writebacks);
+  EXPECT_EQ(1, l2.write_misses);
+  EXPECT_EQ(1, l2.write_hits);
+  EXPECT_EQ(1, l2.read_hits);
+  EXPECT_EQ(0, l2.write_throughs);
+
+  // Only L2 holds dirty data
+  cache.Flush();
+  EXPECT_EQ(0, Stats(cache, 0).writebacks);
+  EXPECT_EQ(1, Stats(cache, 1).writebacks);
+}
+
+TEST_F(CacheHierarchyTests, MMU) {
+  mem::MMU vm(8);
+  EXPECT_FALSE(vm.isCacheEnabled());
+  EXPECT_THROW(vm.get_cache(), mem::InvalidMMUOperationException);
+
+  vm.EnableCache(CacheHierarchy::DefaultConfig());
+  ASSERT_TRUE(vm.isCacheEnabled());
+  uint8_t buf[kPageSize] = { 0 };
+  vm.put_bytes(0, kPageSize, buf);
+  vm.get_bytes(buf, 0, kPageSize);
+  CacheHierarchy::LevelStats stats = Stats(vm.get_cache(), 0);
+  EXPECT_EQ(kPageSize / 64, stats.write_misses);
+  EXPECT_EQ(kPageSize / 64, stats.read_hits);
+
+  vm.DisableCache();
+  EXPECT_FALSE(vm.isCacheEnabled());
+}
@@ -0,0 +1,114 @@
+/*
+ * File:   CheckpointTests.cpp
+ */
+#include "../Checkpoint.h"
+#include "../Exceptions.h"
+#include "../MMU.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <vector>
+
+using mem::Addr;
+using mem::MMU;
+using mem::kPageSize;
+
+class CheckpointTests : public testing::Test {
+protected:
+  /**
+   * Fill - fill a frame with a byte value (in physical mode)
+   */
+  void Fill(MMU &vm, Addr frame, uint8_t value) {
+    std::vector<uint8_t> buf(kPageSize, value);
+    vm.put_bytes(frame * kPageSize, kPageSize, buf.data());
+  }
+  
+  /**
+   * FirstByte - get the first byte of a frame
+   */
+  uint8_t FirstByte(MMU &vm, Addr frame) {
+    uint8_t value;
+    vm.get_byte(&value, frame * kPageSize);
+    return value;
+  }
+};
+
+TEST_F(CheckpointTests, FullAndIncremental) {
+  const Addr kPageCount = 16;
+  MMU vm(kPageCount);
+  for (Addr frame = 0; frame < kPageCount; ++frame) {
+    Fill(vm, frame, frame);
+  }
+  std::stringstream full;
+  mem::WriteFullCheckpoint(vm, full);
+  
+  // Only the changed frames go into an incremental checkpoint
+  Fill(vm, 3, 0x33);
+  Fill(vm, 9, 0x99);
+  std::stringstream incremental;
+  EXPECT_EQ(2, mem::WriteIncrementalCheckpoint(vm, incremental));
+  EXPECT_LT(incremental.str().size(), 3 * kPageSize);
+  std::stringstream empty;
+  EXPECT_EQ(0, mem::WriteIncrementalCheckpoint(vm, empty));
+  
+  // Scribble over memory, then restore both checkpoints
+  for (Addr frame = 0; frame < kPageCount; ++frame) {
+    Fill(vm, frame, 0xEE);
+  }
+  EXPECT_EQ(kPageCount, mem::RestoreCheckpoint(vm, full));
+  EXPECT_FALSE(vm.isDirtyFrame(5 * kPageSize));
+  EXPECT_EQ(3, FirstByte(vm, 3));
+  EXPECT_EQ(2, mem::RestoreCheckpoint(vm, incremental));
+  for (Addr frame = 0; frame < kPageCount; ++frame) {
+    uint8_t expected = frame == 3 ? 0x33 : (frame == 9 ? 0x99 : frame);
+    EXPECT_EQ(expected, FirstByte(vm, frame));
+  }
+  EXPECT_EQ(0, mem::RestoreCheckpoint(vm, empty));
+}
+
+TEST_F(CheckpointTests, RestoreFlushesTLB) {
+  const Addr kPageCount = 16;
+  const Addr kPageTableFrame = 1;
+  MMU vm(kPageCount, kPageCount / 4);
+  Fill(vm, 10, 0xAA);
+  Fill(vm, 11, 0xBB);
+  
+  // Identity page table, except page 5 maps frame 10
+  mem::PageTable page_table;
+  for (Addr i = 0; i < kPageCount; ++i) {
+    page_table[i] = (i * kPageSize) | mem::kPTE_PresentMask 
+            | mem::kPTE_WritableMask;
+  }
+  page_table[5] = (10 * kPageSize) | mem::kPTE_PresentMask;
+  vm.put_bytes(kPageTableFrame * kPageSize, mem::kPageTableSizeBytes, 
+               &page_table);
+  std::stringstream full;
+  mem::WriteFullCheckpoint(vm, full);
+  mem::PMCB pmcb(kPageTableFrame * kPageSize);
+  vm.enter_virtual_mode(pmcb);
+  
+  // Remap page 5 to frame 11, and load the translation into the TLB
+  Addr pt_entry_address = kPageTableFrame * kPageSize 
+          + 5 * sizeof(mem::PageTableEntry);
+  vm.get_physical_memory().put_32(pt_entry_address, 
+                                  (11 * kPageSize) | mem::kPTE_PresentMask);
+  vm.FlushTLB();
+  EXPECT_EQ(0xBB, FirstByte(vm, 5));
+  
+  mem::RestoreCheckpoint(vm, full);
+  EXPECT_EQ(0xAA, FirstByte(vm, 5));
+}
+
+TEST_F(CheckpointTests, BadStream) {
+  MMU vm(8);
+  std::stringstream garbage("not a checkpoint at all");
+  EXPECT_THROW(mem::RestoreCheckpoint(vm, garbage), 
+               mem::CheckpointFormatException);
+  
+  std::stringstream full;
+  mem::WriteFullCheckpoint(vm, full);
+  std::stringstream truncated(full.str().substr(0, full.str().size() - 1));
+  EXPECT_THROW(mem::RestoreCheckpoint(vm, truncated), 
+               mem::CheckpointFormatException);
+}
@@ -0,0 +1,91 @@
+/*
+ * File:   FrameCodecTests.cpp
+ */
+#include "../FrameCodec.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+using mem::Addr;
+using mem::kPageSize;
+using mem::CompressFrame;
+using mem::DecompressFrame;
+
+class FrameCodecTests : public testing::Test {
+protected:
+  /**
+   * RoundTrip - compress and decompress a buffer, checking the result
+   *
+   * @param data buffer to compress
+   * @param len number of bytes in data
+   * @return compressed size
+   */
+  size_t RoundTrip(const uint8_t *data, Addr len) {
+    std::vector<uint8_t> compressed;
+    CompressFrame(data, len, compressed);
+    std::vector<uint8_t> out(len + 1, 0xAA);  // extra sentinel byte
+    EXPECT_TRUE(DecompressFrame(compressed.data(), compressed.size(),
+                                out.data(), len));
+    EXPECT_EQ(0, memcmp(data, out.data(), len));
+    EXPECT_EQ(0xAA, out[len]);
+    return compressed.size();
+  }
+};
+
+TEST_F(FrameCodecTests, Patterns) {
+  uint8_t frame[kPageSize];
+
+  // All zeros and a repeated byte compress to a few bytes
+  memset(frame, 0, kPageSize);
+  EXPECT_GT(64, RoundTrip(frame, kPageSize));
+  memset(frame, 0x5A, kPageSize);
+  EXPECT_GT(64, RoundTrip(frame, kPageSize));
+
+  // Repeating multi-byte pattern
+  for (Addr i = 0; i < kPageSize; ++i) frame[i] = i % 13;
+  EXPECT_GT(kPageSize / 8, RoundTrip(frame, kPageSize));
+
+  // Random data doesn't compress, but still round-trips
+  std::mt19937 gen(42);
+  for (Addr i = 0; i < kPageSize; ++i) frame[i] = gen() & 0xFF;
+  EXPECT_LT(kPageSize, RoundTrip(frame, kPageSize));
+
+  // Half random, half zero
+  memset(frame + kPageSize / 2, 0, kPageSize / 2);
+  EXPECT_GT(kPageSize * 3 / 4, RoundTrip(frame, kPageSize));
+}
+
+TEST_F(FrameCodecTests, ShortInputs) {
+  // Inputs shorter than the minimum match and around length nibble limits
+  uint8_t buf[300];
+  for (Addr i = 0; i < sizeof(buf); ++i) buf[i] = (i * 7) & 0xFF;
+  for (Addr len = 0; len < sizeof(buf); ++len) {
+    RoundTrip(buf, len);
+  }
+}
+
+TEST_F(FrameCodecTests, Malformed) {
+  uint8_t frame[kPageSize];
+  memset(frame, 0x11, kPageSize);
+  std::vector<uint8_t> compressed;
+  CompressFrame(frame, kPageSize, compressed);
+
+  // Wrong output length is detected
+  uint8_t out[kPageSize + 16];
+  EXPECT_FALSE(DecompressFrame(compressed.data(), compressed.size(),
+                               out, kPageSize - 1));
+  EXPECT_FALSE(DecompressFrame(compressed.data(), compressed.size(),
+                               out, kPageSize + 16));
+
+  // Truncated input is detected
+  for (size_t len = 0; len + 1 < compressed.size(); ++len) {
+    EXPECT_FALSE(DecompressFrame(compressed.data(), len, out, kPageSize));
+  }
+
+  // Offset pointing before start of output is detected
+  const uint8_t bad[] = { 0x10, 'x', 0x05, 0x00 };
+  EXPECT_FALSE(DecompressFrame(bad, sizeof(bad), out, 5));
+}
@@ -8,6 +8,8 @@
 
 #include <gtest/gtest.h>
 #include <cstring>
+#include <thread>
+#include <vector>
 
 using namespace mem;
 
@@ -107,6 +109,46 @@ protected:
     mem::PMCB last_pmcb;
   };
   
+  /**
+   * RecordingWatchHandler - watchpoint handler which saves each event, and
+   *   reads the watched memory through the MMU to check that the handler
+   *   may use the MMU
+   */
+  class RecordingWatchHandler : public mem::WatchHandler {
+  public:
+    RecordingWatchHandler(MMU &vm_) : vm(vm_) {}
+    
+    virtual void Run(const mem::WatchEvent &event) {
+      events.push_back(event);
+      vm.get_bytes(&last_value, event.address, sizeof(last_value));
+    }
+    
+    std::vector<mem::WatchEvent> events;
+    uint8_t last_value;
+  private:
+    MMU &vm;
+  };
+  
+  /**
+   * ListFrameAllocator - frame allocator for testing, which hands out 
+   *   frames from a list
+   */
+  class ListFrameAllocator : public mem::FrameAllocator {
+  public:
+    ListFrameAllocator(const std::vector<Addr> &frames_) : frames(frames_) {}
+    
+    virtual bool Allocate(Addr &frame_address) {
+      if (frames.empty()) return false;
+      frame_address = frames.back();
+      frames.pop_back();
+      return true;
+    }
+    
+    virtual void Free(Addr frame_address) { frames.push_back(frame_address); }
+    
+    std::vector<Addr> frames;  // free frames
+  };
+  
   /**
    * BuildKernelPageTable - build a page table that can access all of physical
    * memory 1:1 with virtual memory, as would be used by the OS in kernel mode.
@@ -658,6 +700,17 @@ TEST_F(MMUTests, SinglePageTLB) {
   ASSERT_NE(0, stats.total_max_size);
 }
 
+TEST_F(MMUTests, SinglePageSparse) {
+  const Addr kPageCount = 32;  // number of physical memory pages
+  // Run tests with sparse physical memory
+  MMU vm(kPageCount, kPageCount/4, PhysicalMemory::Backing::kSparse);
+  ASSERT_EQ(0, vm.get_materialized_frame_count());
+  VMSinglePageTests(vm);
+  
+  // Only the page tables and the user page should have been allocated
+  ASSERT_EQ(3, vm.get_materialized_frame_count());
+}
+
 // Test with three pages scattered in physical memory
 TEST_F(MMUTests, MultiPage) {
   const Addr kPageCount = 32;  // number of physical memory pages
@@ -679,3 +732,534 @@ TEST_F(MMUTests, MultiPageTLB) {
   ASSERT_NE(0, stats.total_misses);
   ASSERT_NE(0, stats.total_max_size);
 }
+
+TEST_F(MMUTests, MultiPageSparse) {
+  const Addr kPageCount = 32;  // number of physical memory pages
+  // Run tests with TLB disabled and sparse physical memory
+  MMU vm(kPageCount, PhysicalMemory::Backing::kSparse);
+  VMMultiPageTests(vm);
+  ASSERT_EQ(5, vm.get_materialized_frame_count());
+}
+
+// Atomic operations in physical mode, including concurrent updates
+TEST_F(MMUTests, Atomics) {
+  const Addr kPageCount = 8;  // number of physical memory pages
+  MMU vm(kPageCount);
+  
+  uint32_t old32;
+  uint64_t old64;
+  ASSERT_TRUE(vm.atomic_exchange32(0x100, 5, old32));
+  ASSERT_EQ(0, old32);
+  ASSERT_TRUE(vm.atomic_cas32(0x100, 4, 9, old32));  // fails, no change
+  ASSERT_EQ(5, old32);
+  ASSERT_TRUE(vm.atomic_cas32(0x100, 5, 9, old32));  // succeeds
+  ASSERT_EQ(5, old32);
+  ASSERT_TRUE(vm.atomic_fetch_add32(0x100, 0xFFFFFFFF, old32));  // wraps
+  ASSERT_EQ(9, old32);
+  ASSERT_TRUE(vm.atomic_fetch_add64(0x200, 0x100000000ULL, old64));
+  ASSERT_TRUE(vm.atomic_cas64(0x200, 0x100000000ULL, 7, old64));
+  ASSERT_EQ(0x100000000ULL, old64);
+  ASSERT_TRUE(vm.atomic_exchange64(0x200, 1, old64));
+  ASSERT_EQ(7, old64);
+  
+  uint32_t word;
+  vm.get_bytes(&word, 0x100, sizeof(word));
+  ASSERT_EQ(8, word);
+  
+  // Misaligned addresses are rejected
+  ASSERT_THROW(vm.atomic_fetch_add32(0x102, 1, old32),
+               InvalidMMUOperationException);
+  ASSERT_THROW(vm.atomic_cas64(0x204, 0, 1, old64),
+               InvalidMMUOperationException);
+  
+  // Concurrent updates from several threads: one counter updated with 
+  // fetch_add, one with a compare-and-swap loop
+  const int kThreads = 4;
+  const int kIncrements = 20000;
+  const Addr kAddCounter = 3 * kPageSize;
+  const Addr kCasCounter = 5 * kPageSize + 8;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&vm, kAddCounter, kCasCounter, kIncrements]() {
+      for (int i = 0; i < kIncrements; ++i) {
+        uint32_t old;
+        vm.atomic_fetch_add32(kAddCounter, 1, old);
+        uint64_t expected = 0, seen;
+        for (;;) {
+          vm.atomic_cas64(kCasCounter, expected, expected + 1, seen);
+          if (seen == expected) break;
+          expected = seen;
+        }
+      }
+    });
+  }
+  for (auto &t : threads) t.join();
+  vm.get_bytes(&word, kAddCounter, sizeof(word));
+  ASSERT_EQ(kThreads * kIncrements, word);
+  uint64_t count64;
+  vm.get_bytes(&count64, kCasCounter, sizeof(count64));
+  ASSERT_EQ(kThreads * kIncrements, count64);
+}
+
+// Atomic operations in virtual mode set the modified bit and observe write
+// protection
+TEST_F(MMUTests, AtomicsVirtual) {
+  const Addr kPageCount = 32;  // number of physical memory pages
+  MMU vm(kPageCount, kPageCount/4, PhysicalMemory::Backing::kSparse);
+  const Addr kKernelPageTableBase = 1 * kPageSize;
+  const Addr kPageTableBase = 2 * kPageSize;
+  const Addr kVAddr = 0x40 * kPageSize;
+  const Addr kPhys = 10 * kPageSize;
+  
+  BuildKernelPageTable(vm, kKernelPageTableBase);
+  PMCB kernel_pmcb(kKernelPageTableBase);
+  vm.enter_virtual_mode(kernel_pmcb);
+  
+  PageTable page_table;
+  Addr pt_index = kVAddr >> kPageSizeBits;
+  page_table.at(pt_index) = kPhys | kPTE_PresentMask;  // read only
+  page_table.at(pt_index + 1) = (kPhys + kPageSize) | kPTE_PresentMask
+          | kPTE_WritableMask;
+  vm.put_bytes(kPageTableBase, kPageTableSizeBytes, &page_table);
+  PMCB vm_pmcb(kPageTableBase);
+  vm.set_user_PMCB(vm_pmcb);
+  vm.FlushTLB();
+  
+  std::shared_ptr<WritePermissionFaultTestHandler> wpf_handler(
+        std::make_shared<WritePermissionFaultTestHandler>());
+  vm.SetWritePermissionFaultHandler(wpf_handler);
+  
+  // Atomic on read-only page faults, even if the compare would fail
+  uint32_t old32;
+  ASSERT_FALSE(vm.atomic_cas32(kVAddr, 1, 2, old32));
+  ASSERT_EQ(1, wpf_handler->get_fault_count());
+  
+  // Atomic on writable page sets modified bit
+  uint64_t old64;
+  ASSERT_TRUE(vm.atomic_fetch_add64(kVAddr + kPageSize + 8, 3, old64));
+  ASSERT_TRUE(vm.atomic_fetch_add64(kVAddr + kPageSize + 8, 3, old64));
+  ASSERT_EQ(3, old64);
+  vm.set_kernel_PMCB();
+  vm.FlushTLB();
+  vm.get_bytes(&page_table, kPageTableBase, kPageTableSizeBytes);
+  ASSERT_EQ(0, page_table[pt_index] & kPTE_ModifiedMask);
+  ASSERT_NE(0, page_table[pt_index + 1] & kPTE_ModifiedMask);
+  vm.get_bytes(&old64, kPhys + kPageSize + 8, sizeof(old64));
+  ASSERT_EQ(6, old64);
+}
+
+// Virtual watchpoints
+TEST_F(MMUTests, Watchpoints) {
+  const Addr kPageCount = 32;  // number of physical memory pages
+  MMU vm(kPageCount, kPageCount/4);
+  const Addr kKernelPageTableBase = 1 * kPageSize;
+  const Addr kPageTableBase = 2 * kPageSize;
+  const Addr kVAddr = 0x40 * kPageSize;
+  
+  BuildKernelPageTable(vm, kKernelPageTableBase);
+  PMCB kernel_pmcb(kKernelPageTableBase);
+  vm.enter_virtual_mode(kernel_pmcb);
+  
+  PageTable page_table;
+  Addr pt_index = kVAddr >> kPageSizeBits;
+  for (Addr i = 0; i < 3; ++i) {
+    page_table.at(pt_index + i) = ((10 + i) * kPageSize) | kPTE_PresentMask 
+            | kPTE_WritableMask;
+  }
+  vm.put_bytes(kPageTableBase, kPageTableSizeBytes, &page_table);
+  PMCB vm_pmcb(kPageTableBase);
+  vm.set_user_PMCB(vm_pmcb);
+  vm.FlushTLB();
+  
+  // Touch pages so they're cached in the TLB before adding the watchpoint
+  uint8_t buf[3 * kPageSize];
+  RandBuf(buf, sizeof(buf));
+  vm.put_bytes(kVAddr, sizeof(buf), buf);
+  
+  EXPECT_THROW(vm.AddWatchpoint(kVirtAddrSpaceSize - 4, 8, kWatchWrite, nullptr),
+               InvalidMMUOperationException);
+  auto handler = std::make_shared<RecordingWatchHandler>(vm);
+  int id = vm.AddWatchpoint(kVAddr + kPageSize + 16, 1, kWatchWrite, handler);
+  
+  // Multi-page write: only the page containing the watched byte triggers,
+  // and the rest of the write completes normally
+  RandBuf(buf, sizeof(buf));
+  ASSERT_TRUE(vm.put_bytes(kVAddr, sizeof(buf), buf));
+  ASSERT_EQ(1, handler->events.size());
+  EXPECT_EQ(id, handler->events[0].id);
+  EXPECT_EQ(kVAddr + kPageSize, handler->events[0].address);
+  EXPECT_EQ(kPageSize, handler->events[0].count);
+  EXPECT_EQ(buf[kPageSize], handler->last_value);
+  uint8_t read_back[sizeof(buf)];
+  ASSERT_TRUE(vm.get_bytes(read_back, kVAddr, sizeof(buf)));
+  ASSERT_EQ(0, memcmp(buf, read_back, sizeof(buf)));
+  EXPECT_EQ(1, handler->events.size());  // reads not watched
+  
+  // Byte writes: repeated writes all trigger, even with TLB enabled
+  uint8_t value = 0x5A;
+  for (int i = 0; i < 3; ++i) {
+    vm.put_byte(kVAddr + kPageSize + 16, &value);
+  }
+  vm.put_byte(kVAddr + kPageSize + 17, &value);  // not watched
+  EXPECT_EQ(4, handler->events.size());
+  EXPECT_EQ(0x5A, handler->last_value);
+  
+  // Atomic operations trigger
+  uint32_t old;
+  vm.atomic_fetch_add32(kVAddr + kPageSize + 16, 1, old);
+  EXPECT_EQ(5, handler->events.size());
+  
+  ASSERT_TRUE(vm.RemoveWatchpoint(id));
+  vm.put_byte(kVAddr + kPageSize + 16, &value);
+  EXPECT_EQ(5, handler->events.size());
+}
+
+// Demand-zero anonymous regions
+TEST_F(MMUTests, MapAnonymous) {
+  const Addr kPageCount = 32;  // number of physical memory pages
+  MMU vm(kPageCount, kPageCount/4, PhysicalMemory::Backing::kSparse);
+  const Addr kKernelPageTableBase = 1 * kPageSize;
+  const Addr kPageTableBase = 2 * kPageSize;
+  const Addr kVAddr = 0x40 * kPageSize;
+  
+  // Fill the frames which will be allocated with garbage
+  uint8_t buf[kPageSize];
+  memset(buf, 0xA5, sizeof(buf));
+  for (Addr frame = 10; frame < 13; ++frame) {
+    vm.put_bytes(frame * kPageSize, kPageSize, buf);
+  }
+  
+  EXPECT_THROW(vm.MapAnonymous(kVAddr, kPageSize, true),
+               InvalidMMUOperationException);
+  BuildKernelPageTable(vm, kKernelPageTableBase);
+  PMCB kernel_pmcb(kKernelPageTableBase);
+  vm.enter_virtual_mode(kernel_pmcb);
+  PageTable page_table;
+  vm.put_bytes(kPageTableBase, kPageTableSizeBytes, &page_table);
+  PMCB vm_pmcb(kPageTableBase);
+  vm.set_user_PMCB(vm_pmcb);
+  vm.FlushTLB();
+  
+  auto allocator = std::make_shared<ListFrameAllocator>(
+        std::vector<Addr>{ 12 * kPageSize, 11 * kPageSize, 10 * kPageSize });
+  vm.SetFrameAllocator(allocator);
+  std::shared_ptr<PageFaultTestHandler> pf_handler(
+        std::make_shared<PageFaultTestHandler>());
+  vm.SetPageFaultHandler(pf_handler);
+  std::shared_ptr<WritePermissionFaultTestHandler> wpf_handler(
+        std::make_shared<WritePermissionFaultTestHandler>());
+  vm.SetWritePermissionFaultHandler(wpf_handler);
+  
+  // Four writable pages and one read-only page; no frames used yet
+  vm.MapAnonymous(kVAddr, 4 * kPageSize - 100, true);
+  vm.MapAnonymous(kVAddr + 4 * kPageSize, kPageSize, false);
+  EXPECT_THROW(vm.MapAnonymous(kVAddr + 3 * kPageSize, kPageSize, true),
+               InvalidMMUOperationException);
+  EXPECT_THROW(vm.MapAnonymous(kVAddr + 1, kPageSize, true),
+               InvalidMMUOperationException);
+  EXPECT_EQ(3, allocator->frames.size());
+  
+  // First touch maps a zeroed frame without calling the fault handler
+  vm.get_bytes(buf, kVAddr, kPageSize);
+  for (Addr i = 0; i < kPageSize; ++i) ASSERT_EQ(0, buf[i]);
+  EXPECT_EQ(2, allocator->frames.size());
+  EXPECT_EQ(1, vm.get_demand_zero_fault_count());
+  
+  // Write across two pages, read back
+  memset(buf, 0x3C, sizeof(buf));
+  ASSERT_TRUE(vm.put_bytes(kVAddr + kPageSize / 2, kPageSize, buf));
+  uint8_t read_back[kPageSize];
+  ASSERT_TRUE(vm.get_bytes(read_back, kVAddr + kPageSize / 2, kPageSize));
+  ASSERT_EQ(0, memcmp(buf, read_back, kPageSize));
+  EXPECT_EQ(2, vm.get_demand_zero_fault_count());
+  
+  // Read-only page is mapped, but writes still fault
+  uint8_t byte = 1;
+  ASSERT_TRUE(vm.get_byte(&byte, kVAddr + 4 * kPageSize));
+  EXPECT_EQ(0, byte);
+  EXPECT_FALSE(vm.put_byte(kVAddr + 4 * kPageSize, &byte));
+  EXPECT_EQ(1, wpf_handler->get_fault_count());
+  EXPECT_TRUE(allocator->frames.empty());
+  EXPECT_EQ(0, pf_handler->get_fault_count());
+  
+  // Out of frames: the page fault handler is called
+  EXPECT_FALSE(vm.get_byte(&byte, kVAddr + 3 * kPageSize));
+  EXPECT_EQ(1, pf_handler->get_fault_count());
+  
+  // Check page table entries
+  vm.set_kernel_PMCB();
+  vm.FlushTLB();
+  vm.get_bytes(&page_table, kPageTableBase, kPageTableSizeBytes);
+  Addr pt_index = kVAddr >> kPageSizeBits;
+  EXPECT_EQ(10 * kPageSize | kPTE_PresentMask | kPTE_WritableMask 
+            | kPTE_AccessedMask | kPTE_ModifiedMask, page_table[pt_index]);
+  EXPECT_EQ(kPTE_DemandZeroMask | kPTE_WritableMask, page_table[pt_index + 3]);
+  EXPECT_EQ(12 * kPageSize | kPTE_PresentMask | kPTE_AccessedMask, 
+            page_table[pt_index + 4]);
+  
+  // A frame beyond physical memory goes back to the allocator
+  allocator->frames.push_back(kPageCount * kPageSize);
+  vm.set_user_PMCB(vm_pmcb);
+  vm.FlushTLB();
+  EXPECT_THROW(vm.get_byte(&byte, kVAddr + 3 * kPageSize),
+               PhysicalMemoryBoundsException);
+  EXPECT_EQ(1, allocator->frames.size());
+}
+
+// Copy-on-write fork
+TEST_F(MMUTests, ForkCopyOnWrite) {
+  const Addr kPageCount = 32;  // number of physical memory pages
+  MMU vm(kPageCount, kPageCount/4);
+  const Addr kKernelPageTableBase = 1 * kPageSize;
+  const Addr kParentPageTableBase = 2 * kPageSize;
+  const Addr kChildPageTableBase = 3 * kPageSize;
+  const Addr kVAddr = 0x40 * kPageSize;
+  
+  BuildKernelPageTable(vm, kKernelPageTableBase);
+  PMCB kernel_pmcb(kKernelPageTableBase);
+  vm.enter_virtual_mode(kernel_pmcb);
+  auto allocator = std::make_shared<ListFrameAllocator>(
+        std::vector<Addr>{ 21 * kPageSize, 20 * kPageSize });
+  vm.SetFrameAllocator(allocator);
+  std::shared_ptr<WritePermissionFaultTestHandler> wpf_handler(
+        std::make_shared<WritePermissionFaultTestHandler>());
+  vm.SetWritePermissionFaultHandler(wpf_handler);
+  
+  // Parent has a writable page, a read-only page and a shared page
+  PageTable page_table;
+  Addr pt_index = kVAddr >> kPageSizeBits;
+  page_table[pt_index] = 10 * kPageSize | kPTE_PresentMask | kPTE_WritableMask;
+  page_table[pt_index + 1] = 11 * kPageSize | kPTE_PresentMask;
+  page_table[pt_index + 2] = 12 * kPageSize | kPTE_PresentMask 
+          | kPTE_WritableMask | kPTE_SharedMask;
+  vm.put_bytes(kParentPageTableBase, kPageTableSizeBytes, &page_table);
+  uint32_t value = 0x11111111;
+  vm.put_bytes(10 * kPageSize + 8, sizeof(value), &value);
+  vm.put_bytes(11 * kPageSize + 8, sizeof(value), &value);
+  
+  EXPECT_THROW(vm.ForkPageTable(kParentPageTableBase, kParentPageTableBase),
+               InvalidMMUOperationException);
+  vm.ForkPageTable(kParentPageTableBase, kChildPageTableBase);
+  vm.get_bytes(&page_table, kChildPageTableBase, kPageTableSizeBytes);
+  EXPECT_EQ(10 * kPageSize | kPTE_PresentMask | kPTE_CopyOnWriteMask, 
+            page_table[pt_index]);
+  EXPECT_EQ(11 * kPageSize | kPTE_PresentMask, page_table[pt_index + 1]);
+  EXPECT_EQ(12 * kPageSize | kPTE_PresentMask | kPTE_WritableMask 
+            | kPTE_SharedMask, page_table[pt_index + 2]);
+  EXPECT_FALSE(vm.isSharedFrame(12 * kPageSize));
+  
+  // Child write copies the frame; the parent still sees the old data
+  PMCB parent_pmcb(kParentPageTableBase);
+  PMCB child_pmcb(kChildPageTableBase);
+  vm.set_user_PMCB(child_pmcb);
+  vm.FlushTLB();
+  uint32_t read_back = 0;
+  ASSERT_TRUE(vm.get_bytes(&read_back, kVAddr + 8, sizeof(read_back)));
+  EXPECT_EQ(0x11111111, read_back);
+  value = 0x22222222;
+  ASSERT_TRUE(vm.put_bytes(kVAddr + 8, sizeof(value), &value));
+  EXPECT_EQ(1, allocator->frames.size());
+  vm.set_user_PMCB(parent_pmcb);
+  vm.FlushTLB();
+  ASSERT_TRUE(vm.get_bytes(&read_back, kVAddr + 8, sizeof(read_back)));
+  EXPECT_EQ(0x11111111, read_back);
+  
+  // Parent is the last sharer, so its write reuses the frame
+  value = 0x33333333;
+  ASSERT_TRUE(vm.put_bytes(kVAddr + 8, sizeof(value), &value));
+  vm.set_user_PMCB(child_pmcb);
+  vm.FlushTLB();
+  ASSERT_TRUE(vm.get_bytes(&read_back, kVAddr + 8, sizeof(read_back)));
+  EXPECT_EQ(0x22222222, read_back);
+  MMU::CopyOnWriteStats stats;
+  vm.get_CopyOnWriteStats(stats);
+  EXPECT_EQ(1, stats.frames_copied);
+  EXPECT_EQ(1, stats.frames_reused);
+  
+  // Read-only pages still call the write permission fault handler
+  EXPECT_FALSE(vm.put_bytes(kVAddr + kPageSize, sizeof(value), &value));
+  EXPECT_EQ(1, wpf_handler->get_fault_count());
+  
+  // Check page table entries
+  vm.set_kernel_PMCB();
+  vm.FlushTLB();
+  vm.get_bytes(&page_table, kChildPageTableBase, kPageTableSizeBytes);
+  EXPECT_EQ(20 * kPageSize | kPTE_PresentMask | kPTE_WritableMask 
+            | kPTE_AccessedMask | kPTE_ModifiedMask, page_table[pt_index]);
+  vm.get_bytes(&page_table, kParentPageTableBase, kPageTableSizeBytes);
+  EXPECT_EQ(10 * kPageSize | kPTE_PresentMask | kPTE_WritableMask 
+            | kPTE_AccessedMask | kPTE_ModifiedMask, page_table[pt_index]);
+  
+  // A read-only page made writable in the child is still copied on write
+  vm.set_user_PMCB(child_pmcb);
+  vm.FlushTLB();
+  vm.Protect(kVAddr + kPageSize, 1, true);
+  value = 0x44444444;
+  ASSERT_TRUE(vm.put_bytes(kVAddr + kPageSize + 8, sizeof(value), &value));
+  EXPECT_TRUE(allocator->frames.empty());
+  vm.set_user_PMCB(parent_pmcb);
+  vm.FlushTLB();
+  ASSERT_TRUE(vm.get_bytes(&read_back, kVAddr + kPageSize + 8, sizeof(read_back)));
+  EXPECT_EQ(0x11111111, read_back);
+  vm.get_CopyOnWriteStats(stats);
+  EXPECT_EQ(2, stats.frames_copied);
+}
+
+// Releasing the pages of a forked page table
+TEST_F(MMUTests, ReleasePageTable) {
+  const Addr kPageCount = 32;  // number of physical memory pages
+  MMU vm(kPageCount, kPageCount/4);
+  const Addr kKernelPageTableBase = 1 * kPageSize;
+  const Addr kParentPageTableBase = 2 * kPageSize;
+  const Addr kChildPageTableBase = 3 * kPageSize;
+  const Addr kGrandchildPageTableBase = 4 * kPageSize;
+  const Addr kVAddr = 0x40 * kPageSize;
+  
+  BuildKernelPageTable(vm, kKernelPageTableBase);
+  PMCB kernel_pmcb(kKernelPageTableBase);
+  vm.enter_virtual_mode(kernel_pmcb);
+  auto allocator = std::make_shared<ListFrameAllocator>(
+        std::vector<Addr>{ 20 * kPageSize });
+  vm.SetFrameAllocator(allocator);
+  
+  // Two writable pages, shared by three page tables
+  PageTable page_table;
+  Addr pt_index = kVAddr >> kPageSizeBits;
+  page_table[pt_index] = 10 * kPageSize | kPTE_PresentMask | kPTE_WritableMask;
+  page_table[pt_index + 1] = 11 * kPageSize | kPTE_PresentMask | kPTE_WritableMask;
+  vm.put_bytes(kParentPageTableBase, kPageTableSizeBytes, &page_table);
+  vm.ForkPageTable(kParentPageTableBase, kChildPageTableBase);
+  vm.ForkPageTable(kChildPageTableBase, kGrandchildPageTableBase);
+  EXPECT_TRUE(vm.isSharedFrame(10 * kPageSize));
+  EXPECT_TRUE(vm.isSharedFrame(11 * kPageSize));
+  EXPECT_THROW(vm.ReleasePages(kChildPageTableBase, kVAddr + 1, 1),
+               InvalidMMUOperationException);
+  EXPECT_THROW(vm.ReleasePages(kChildPageTableBase, kVAddr, kPageTableEntries),
+               InvalidMMUOperationException);
+  
+  // The first page is unmapped from the child, and the grandchild discarded
+  vm.ReleasePages(kChildPageTableBase, kVAddr, 1);
+  EXPECT_TRUE(vm.isSharedFrame(10 * kPageSize));
+  vm.ReleasePageTable(kGrandchildPageTableBase);
+  EXPECT_FALSE(vm.isSharedFrame(10 * kPageSize));
+  EXPECT_TRUE(vm.isSharedFrame(11 * kPageSize));
+  
+  // The parent is the last sharer of the first page, so a write reuses it
+  PMCB parent_pmcb(kParentPageTableBase);
+  vm.set_user_PMCB(parent_pmcb);
+  vm.FlushTLB();
+  uint32_t value = 0x11111111;
+  ASSERT_TRUE(vm.put_bytes(kVAddr, sizeof(value), &value));
+  MMU::CopyOnWriteStats stats;
+  vm.get_CopyOnWriteStats(stats);
+  EXPECT_EQ(0, stats.frames_copied);
+  EXPECT_EQ(1, stats.frames_reused);
+  EXPECT_EQ(1, allocator->frames.size());
+  
+  // The second page is still shared with the child, so it is copied
+  ASSERT_TRUE(vm.put_bytes(kVAddr + kPageSize, sizeof(value), &value));
+  vm.get_CopyOnWriteStats(stats);
+  EXPECT_EQ(1, stats.frames_copied);
+  EXPECT_FALSE(vm.isSharedFrame(11 * kPageSize));
+}
+
+// Range protection
+TEST_F(MMUTests, Protect) {
+  const Addr kPageCount = 32;  // number of physical memory pages
+  MMU vm(kPageCount, kPageCount/4);
+  const Addr kKernelPageTableBase = 1 * kPageSize;
+  const Addr kPageTableBase = 2 * kPageSize;
+  const Addr kVAddr = 0x40 * kPageSize;
+  
+  EXPECT_THROW(vm.Protect(kVAddr, 1, false), InvalidMMUOperationException);
+  BuildKernelPageTable(vm, kKernelPageTableBase);
+  PMCB kernel_pmcb(kKernelPageTableBase);
+  vm.enter_virtual_mode(kernel_pmcb);
+  std::shared_ptr<WritePermissionFaultTestHandler> wpf_handler(
+        std::make_shared<WritePermissionFaultTestHandler>());
+  vm.SetWritePermissionFaultHandler(wpf_handler);
+  
+  // Three writable pages, then an unmapped page
+  PageTable page_table;
+  Addr pt_index = kVAddr >> kPageSizeBits;
+  for (Addr i = 0; i < 3; ++i) {
+    page_table[pt_index + i] = (10 + i) * kPageSize | kPTE_PresentMask 
+            | kPTE_WritableMask;
+  }
+  vm.put_bytes(kPageTableBase, kPageTableSizeBytes, &page_table);
+  PMCB vm_pmcb(kPageTableBase);
+  vm.set_user_PMCB(vm_pmcb);
+  vm.FlushTLB();
+  
+  // Load all three pages into the TLB, then protect two of them
+  uint8_t byte = 0x5A;
+  for (Addr i = 0; i < 3; ++i) {
+    ASSERT_TRUE(vm.put_byte(kVAddr + i * kPageSize, &byte));
+  }
+  EXPECT_THROW(vm.Protect(kVAddr + 1, 1, false), InvalidMMUOperationException);
+  EXPECT_THROW(vm.Protect(kVAddr, kPageTableEntries, false), 
+               InvalidMMUOperationException);
+  vm.Protect(kVAddr + kPageSize, 3, false);
+  EXPECT_TRUE(vm.put_byte(kVAddr, &byte));
+  EXPECT_FALSE(vm.put_byte(kVAddr + kPageSize, &byte));
+  EXPECT_FALSE(vm.put_byte(kVAddr + 2 * kPageSize, &byte));
+  EXPECT_EQ(2, wpf_handler->get_fault_count());
+  EXPECT_TRUE(vm.get_byte(&byte, kVAddr + 2 * kPageSize));
+  EXPECT_EQ(0x5A, byte);
+  
+  vm.Protect(kVAddr, 3, true);
+  EXPECT_TRUE(vm.put_byte(kVAddr + 2 * kPageSize, &byte));
+  EXPECT_EQ(2, wpf_handler->get_fault_count());
+  
+  // The unmapped page is unchanged
+  vm.set_kernel_PMCB();
+  vm.FlushTLB();
+  vm.get_bytes(&page_table, kPageTableBase, kPageTableSizeBytes);
+  EXPECT_EQ(0, page_table[pt_index + 3]);
+  EXPECT_EQ(11 * kPageSize | kPTE_PresentMask | kPTE_WritableMask 
+            | kPTE_AccessedMask | kPTE_ModifiedMask, page_table[pt_index + 1]);
+}
+
+// Dirty frame tracking
+TEST_F(MMUTests, DirtyFrames) {
+  const Addr kPageCount = 160;  // more than two bitmap words
+  MMU vm(kPageCount, kPageCount/4);
+  const Addr kKernelPageTableBase = 1 * kPageSize;
+  const Addr kPageTableBase = 2 * kPageSize;
+  const Addr kVAddr = 0x40 * kPageSize;
+  std::vector<Addr> frames;
+  
+  // Physical mode writes
+  uint8_t byte = 0x5A;
+  vm.put_byte(70 * kPageSize + 5, &byte);
+  vm.put_bytes(kPageSize - 1, 2, &byte);  // frames 0 and 1
+  vm.get_byte(&byte, 150 * kPageSize);
+  EXPECT_TRUE(vm.isDirtyFrame(70 * kPageSize));
+  vm.CollectAndClearDirty(frames);
+  EXPECT_EQ(std::vector<Addr>({ 0, kPageSize, 70 * kPageSize }), frames);
+  frames.clear();
+  vm.CollectAndClearDirty(frames);
+  EXPECT_TRUE(frames.empty());
+  
+  // Virtual mode: TLB hits and the page table written by the MMU
+  BuildKernelPageTable(vm, kKernelPageTableBase);
+  PMCB kernel_pmcb(kKernelPageTableBase);
+  vm.enter_virtual_mode(kernel_pmcb);
+  PageTable page_table;
+  page_table[kVAddr >> kPageSizeBits] = 
+          130 * kPageSize | kPTE_PresentMask | kPTE_WritableMask;
+  vm.put_bytes(kPageTableBase, kPageTableSizeBytes, &page_table);
+  vm.CollectAndClearDirty(frames);
+  frames.clear();
+  PMCB vm_pmcb(kPageTableBase);
+  vm.set_user_PMCB(vm_pmcb);
+  vm.FlushTLB();
+  ASSERT_TRUE(vm.put_byte(kVAddr, &byte));
+  vm.CollectAndClearDirty(frames);
+  EXPECT_EQ(std::vector<Addr>({ kPageTableBase, 130 * kPageSize }), frames);
+  frames.clear();
+  ASSERT_TRUE(vm.put_byte(kVAddr + 1, &byte));  // TLB hit
+  ASSERT_TRUE(vm.get_byte(&byte, kVAddr + 2));
+  vm.CollectAndClearDirty(frames);
+  EXPECT_EQ(std::vector<Addr>({ 130 * kPageSize }), frames);
+}
@@ -34,6 +34,17 @@ namespace { // unnamed namespace for local functions
 
 class PhysicalMemoryTests : public testing::Test {
 protected:
+  /**
+   * RecordingWatchHandler - watchpoint handler which saves each event
+   */
+  class RecordingWatchHandler : public mem::WatchHandler {
+  public:
+    virtual void Run(const mem::WatchEvent &event) {
+      events.push_back(event);
+    }
+    
+    std::vector<mem::WatchEvent> events;
+  };
 };
 
 TEST_F(PhysicalMemoryTests, ConstructorAndSize) {
@@ -229,4 +240,407 @@ TEST_F(PhysicalMemoryTests, AddressCheck) {
   }
 
   ASSERT_EQ(0, pm.get_byte_count()); // no reads/writes should succeed
-}
\ No newline at end of file
+}
+
+/**
+ * Test sparse backing: frames are allocated only when written
+ */
+TEST_F(PhysicalMemoryTests, SparseBacking) {
+  // 2 GiB of simulated memory, almost none of which is touched
+  const Addr kSize = 0x80000000;
+  PhysicalMemory pm(kSize, PhysicalMemory::Backing::kSparse);
+  ASSERT_EQ(kSize, pm.size());
+  ASSERT_EQ(PhysicalMemory::Backing::kSparse, pm.get_backing());
+  ASSERT_EQ(0, pm.get_materialized_frame_count());
+
+  // Reads of untouched memory return zero without allocating frames
+  uint8_t get_buf[3 * mem::kPageSize];
+  memset(get_buf, 0xAA, sizeof(get_buf));
+  pm.get_bytes(get_buf, kSize - sizeof(get_buf), sizeof(get_buf));
+  for (Addr i = 0; i < sizeof(get_buf); ++i) {
+    ASSERT_EQ(0, get_buf[i]);
+  }
+  ASSERT_EQ(0, pm.get_materialized_frame_count());
+
+  // A write spanning a frame boundary materializes both frames
+  uint8_t put_buf[16];
+  RandBuf(put_buf, sizeof(put_buf));
+  const Addr kSpanAddr = 0x12345 * mem::kPageSize - 8;
+  pm.put_bytes(kSpanAddr, sizeof(put_buf), put_buf);
+  ASSERT_EQ(2, pm.get_materialized_frame_count());
+  pm.get_bytes(get_buf, kSpanAddr - 8, sizeof(put_buf) + 16);
+  for (Addr i = 0; i < 8; ++i) {
+    ASSERT_EQ(0, get_buf[i]);
+    ASSERT_EQ(0, get_buf[i + 8 + sizeof(put_buf)]);
+  }
+  ASSERT_EQ(0, memcmp(put_buf, get_buf + 8, sizeof(put_buf)));
+
+  // Single byte access to the last byte of memory
+  uint8_t x55 = 0x55, data_byte = 0;
+  pm.put_byte(kSize - 1, &x55);
+  pm.get_byte(&data_byte, kSize - 1);
+  ASSERT_EQ(0x55, data_byte);
+  ASSERT_EQ(3, pm.get_materialized_frame_count());
+
+  // Rewriting a materialized frame doesn't allocate again
+  pm.put_bytes(kSpanAddr, sizeof(put_buf), put_buf);
+  ASSERT_EQ(3, pm.get_materialized_frame_count());
+
+  // Bounds are checked the same as dense memory
+  EXPECT_THROW(pm.get_byte(&data_byte, kSize), PhysicalMemoryBoundsException);
+  EXPECT_THROW(pm.put_bytes(kSize - 4, 8, put_buf), 
+               PhysicalMemoryBoundsException);
+  ASSERT_EQ(3, pm.get_materialized_frame_count());
+}
+
+/**
+ * Test deduplication of zero and identical frames
+ */
+TEST_F(PhysicalMemoryTests, DeduplicateFrames) {
+  const Addr kFrames = 64;
+  PhysicalMemory pm(kFrames * mem::kPageSize, PhysicalMemory::Backing::kSparse);
+  
+  // Fill frames 0-9 with one pattern, 10-14 with another, and write zeros 
+  // to 20-23 (which materializes them)
+  uint8_t pattern_a[mem::kPageSize], pattern_b[mem::kPageSize];
+  uint8_t zeros[mem::kPageSize] = { 0 };
+  RandBuf(pattern_a, mem::kPageSize);
+  RandBuf(pattern_b, mem::kPageSize);
+  for (Addr f = 0; f < 10; ++f) {
+    pm.put_bytes(f * mem::kPageSize, mem::kPageSize, pattern_a);
+  }
+  for (Addr f = 10; f < 15; ++f) {
+    pm.put_bytes(f * mem::kPageSize, mem::kPageSize, pattern_b);
+  }
+  for (Addr f = 20; f < 24; ++f) {
+    pm.put_bytes(f * mem::kPageSize, mem::kPageSize, zeros);
+  }
+  ASSERT_EQ(19, pm.get_materialized_frame_count());
+  uint64_t byte_count = pm.get_byte_count();
+  
+  PhysicalMemory::DedupStats stats;
+  pm.DeduplicateFrames(stats);
+  EXPECT_EQ(19, stats.frames_scanned);
+  EXPECT_EQ(4, stats.zero_frames_released);
+  EXPECT_EQ(13, stats.frames_merged);
+  EXPECT_EQ(17 * mem::kPageSize, stats.bytes_saved);
+  EXPECT_EQ(2, pm.get_materialized_frame_count());
+  EXPECT_EQ(15, pm.get_shared_frame_count());
+  EXPECT_EQ(byte_count, pm.get_byte_count());  // not a memory access
+  
+  // A second pass finds nothing more to do
+  pm.DeduplicateFrames(stats);
+  EXPECT_EQ(0, stats.bytes_saved);
+  EXPECT_EQ(2, pm.get_materialized_frame_count());
+  
+  // Writing a shared frame copies it; the other frames are unchanged
+  uint8_t x55 = 0x55;
+  pm.put_byte(3 * mem::kPageSize + 7, &x55);
+  EXPECT_EQ(3, pm.get_materialized_frame_count());
+  uint8_t get_buf[mem::kPageSize];
+  for (Addr f = 0; f < 10; ++f) {
+    pm.get_bytes(get_buf, f * mem::kPageSize, mem::kPageSize);
+    if (f == 3) {
+      ASSERT_EQ(0x55, get_buf[7]);
+      get_buf[7] = pattern_a[7];
+    }
+    ASSERT_EQ(0, memcmp(pattern_a, get_buf, mem::kPageSize));
+  }
+  for (Addr f = 20; f < 24; ++f) {
+    pm.get_bytes(get_buf, f * mem::kPageSize, mem::kPageSize);
+    ASSERT_EQ(0, memcmp(zeros, get_buf, mem::kPageSize));
+  }
+}
+
+/**
+ * Dense memory never shares frames
+ */
+TEST_F(PhysicalMemoryTests, DeduplicateDense) {
+  PhysicalMemory pm(4 * mem::kPageSize);
+  PhysicalMemory::DedupStats stats;
+  pm.DeduplicateFrames(stats);
+  EXPECT_EQ(0, stats.frames_scanned);
+  EXPECT_EQ(0, stats.bytes_saved);
+  EXPECT_EQ(4, pm.get_materialized_frame_count());
+}
+
+/**
+ * Test compression of cold frames
+ */
+TEST_F(PhysicalMemoryTests, CompressColdFrames) {
+  const Addr kFrames = 16;
+  PhysicalMemory pm(kFrames * mem::kPageSize, PhysicalMemory::Backing::kSparse);
+  
+  // Frames 0-7 get compressible contents, frame 8 random contents
+  uint8_t frame[mem::kPageSize];
+  for (Addr f = 0; f < 8; ++f) {
+    for (Addr i = 0; i < mem::kPageSize; ++i) frame[i] = (i / 64 + f) & 0xFF;
+    pm.put_bytes(f * mem::kPageSize, mem::kPageSize, frame);
+  }
+  uint8_t random_frame[mem::kPageSize];
+  RandBuf(random_frame, mem::kPageSize);
+  pm.put_bytes(8 * mem::kPageSize, mem::kPageSize, random_frame);
+  ASSERT_EQ(9, pm.get_materialized_frame_count());
+  
+  // Touch frame 0 so that it is more recent than the others
+  uint8_t data_byte;
+  pm.get_byte(&data_byte, 0);
+  
+  // Nothing is idle for this long
+  ASSERT_EQ(0, pm.CompressColdFrames(pm.get_byte_count() + 1));
+  
+  // Everything but frame 0 has been idle for at least 1 byte
+  ASSERT_EQ(7, pm.CompressColdFrames(1));
+  ASSERT_EQ(2, pm.get_materialized_frame_count());
+  PhysicalMemory::CompressionStats stats;
+  pm.get_compression_stats(stats);
+  EXPECT_EQ(7, stats.compressed_frames);
+  EXPECT_EQ(7, stats.compress_count);
+  EXPECT_EQ(0, stats.decompress_count);
+  EXPECT_EQ(1, stats.incompressible_count);
+  EXPECT_EQ(7 * mem::kPageSize, stats.uncompressed_bytes);
+  EXPECT_LT(4.0, stats.ratio());
+  uint64_t histogram_total = 0;
+  for (auto count : stats.compress_latency) histogram_total += count;
+  EXPECT_EQ(8, histogram_total);  // the incompressible frame is timed too
+  
+  // Reading a compressed frame brings it back; contents are unchanged
+  for (Addr f = 0; f < 8; ++f) {
+    uint8_t get_buf[mem::kPageSize];
+    pm.get_bytes(get_buf, f * mem::kPageSize, mem::kPageSize);
+    for (Addr i = 0; i < mem::kPageSize; ++i) {
+      ASSERT_EQ((i / 64 + f) & 0xFF, get_buf[i]);
+    }
+  }
+  pm.get_compression_stats(stats);
+  EXPECT_EQ(0, stats.compressed_frames);
+  EXPECT_EQ(7, stats.decompress_count);
+  EXPECT_EQ(0, stats.compressed_bytes);
+  EXPECT_EQ(9, pm.get_materialized_frame_count());
+  
+  // Writing to a compressed frame keeps the rest of its contents
+  ASSERT_EQ(7, pm.CompressColdFrames(1));
+  uint8_t x55 = 0x55;
+  pm.put_byte(3 * mem::kPageSize + 100, &x55);
+  pm.get_bytes(frame, 3 * mem::kPageSize, mem::kPageSize);
+  for (Addr i = 0; i < mem::kPageSize; ++i) {
+    ASSERT_EQ(i == 100 ? 0x55 : ((i / 64 + 3) & 0xFF), frame[i]);
+  }
+}
+
+/**
+ * Test automatic compression interval
+ */
+TEST_F(PhysicalMemoryTests, ColdFrameInterval) {
+  const Addr kFrames = 16;
+  PhysicalMemory pm(kFrames * mem::kPageSize, PhysicalMemory::Backing::kSparse);
+  uint8_t zeros[mem::kPageSize] = { 0 };
+  zeros[0] = 1;  // materialize frames with a mostly-zero pattern
+  for (Addr f = 0; f < kFrames; ++f) {
+    pm.put_bytes(f * mem::kPageSize, mem::kPageSize, zeros);
+  }
+  
+  // Keep accessing frame 0; the others go cold and get compressed
+  pm.set_cold_frame_interval(4 * mem::kPageSize);
+  uint8_t get_buf[mem::kPageSize];
+  for (int i = 0; i < 10; ++i) {
+    pm.get_bytes(get_buf, 0, mem::kPageSize);
+  }
+  PhysicalMemory::CompressionStats stats;
+  pm.get_compression_stats(stats);
+  EXPECT_EQ(kFrames - 1, stats.compressed_frames);
+  EXPECT_EQ(1, pm.get_materialized_frame_count());
+}
+
+/**
+ * Test typed loads and stores, checked and unchecked
+ */
+TEST_F(PhysicalMemoryTests, TypedAccess) {
+  const Addr kSize = 64;
+  PhysicalMemory pm(kSize);
+  
+  pm.put_64(8, 0x0123456789ABCDEFULL);
+  pm.put_32(20, 0xDEADBEEF);
+  ASSERT_EQ(12, pm.get_byte_count());
+  
+  uint64_t v64 = 0;
+  uint32_t v32 = 0;
+  uint16_t v16 = 0;
+  pm.get_64(&v64, 8);
+  EXPECT_EQ(0x0123456789ABCDEFULL, v64);
+  pm.get_32(&v32, 20);
+  EXPECT_EQ(0xDEADBEEF, v32);
+  pm.get_16(&v16, 8);
+  EXPECT_EQ(0xCDEF, v16);
+  EXPECT_EQ(26, pm.get_byte_count());
+  
+  // Unchecked versions see the same memory and count the same bytes
+  pm.put_64_unchecked(kSize - 8, 0xFEDCBA9876543210ULL);
+  pm.put_32_unchecked(0, 0x11223344);
+  pm.get_64_unchecked(&v64, kSize - 8);
+  EXPECT_EQ(0xFEDCBA9876543210ULL, v64);
+  pm.get_32_unchecked(&v32, 0);
+  EXPECT_EQ(0x11223344, v32);
+  pm.get_16_unchecked(&v16, 2);
+  EXPECT_EQ(0x1122, v16);
+  EXPECT_EQ(52, pm.get_byte_count());
+  
+  // Checked versions still reject bad addresses
+  EXPECT_THROW(pm.get_64(&v64, kSize - 4), PhysicalMemoryBoundsException);
+  EXPECT_THROW(pm.put_32(kSize - 2, 0), PhysicalMemoryBoundsException);
+  EXPECT_THROW(pm.get_16(&v16, kSize - 1), PhysicalMemoryBoundsException);
+  EXPECT_EQ(52, pm.get_byte_count());
+}
+
+TEST_F(PhysicalMemoryTests, FrameAccessCounts) {
+  const Addr kFrames = 8;
+  PhysicalMemory pm(kFrames * mem::kPageSize);
+  std::vector<PhysicalMemory::FrameAccessCounts> counts;
+  std::vector<Addr> hot;
+  
+  // Off by default
+  EXPECT_EQ(PhysicalMemory::AccessTracking::kOff, pm.get_access_tracking());
+  pm.put_32(0, 1);
+  pm.get_frame_access_counts(counts);
+  EXPECT_TRUE(counts.empty());
+  
+  // Exact counts, including an access spanning two frames
+  pm.set_access_tracking(PhysicalMemory::AccessTracking::kExact);
+  uint8_t buf[16] = { 0 };
+  pm.put_bytes(3 * mem::kPageSize - 4, sizeof(buf), buf);
+  for (int i = 0; i < 10; ++i) {
+    pm.get_bytes(buf, 5 * mem::kPageSize, 8);
+  }
+  pm.get_frame_access_counts(counts);
+  ASSERT_EQ(kFrames, counts.size());
+  EXPECT_EQ(1, counts[2].writes);
+  EXPECT_EQ(4, counts[2].write_bytes);
+  EXPECT_EQ(1, counts[3].writes);
+  EXPECT_EQ(12, counts[3].write_bytes);
+  EXPECT_EQ(10, counts[5].reads);
+  EXPECT_EQ(80, counts[5].read_bytes);
+  EXPECT_EQ(0, counts[0].total_bytes());
+  
+  pm.get_hot_frames(2, hot);
+  ASSERT_EQ(2, hot.size());
+  EXPECT_EQ(5, hot[0]);
+  EXPECT_EQ(3, hot[1]);
+  pm.get_hot_frames(10, hot);
+  EXPECT_EQ(3, hot.size());  // untouched frames omitted
+  
+  pm.ResetFrameAccessCounts();
+  pm.get_hot_frames(10, hot);
+  EXPECT_TRUE(hot.empty());
+  
+  // Sampled counts estimate the exact counts
+  const int kAccesses = 100000;
+  pm.set_access_tracking(PhysicalMemory::AccessTracking::kSampled, 16);
+  for (int i = 0; i < kAccesses; ++i) {
+    pm.get_bytes(buf, (i % 4) * mem::kPageSize, 4);  // frames 0-3 equally
+    if (i % 2 == 0) pm.put_32(7 * mem::kPageSize, i); // frame 7 half as often
+  }
+  pm.get_frame_access_counts(counts);
+  for (Addr frame = 0; frame < 4; ++frame) {
+    EXPECT_NEAR(kAccesses / 4, counts[frame].reads, kAccesses / 40);
+  }
+  EXPECT_NEAR(kAccesses / 2, counts[7].writes, kAccesses / 20);
+  EXPECT_NEAR(kAccesses * 2, counts[7].write_bytes, kAccesses / 5);
+  pm.get_hot_frames(1, hot);
+  EXPECT_EQ(7, hot[0]);
+}
+
+TEST_F(PhysicalMemoryTests, Banks) {
+  const Addr kFrames = 8;
+  PhysicalMemory pm(kFrames * mem::kPageSize);
+  PhysicalMemory::NodeStats stats;
+  
+  // Single node until banks configured
+  EXPECT_EQ(1, pm.get_node_count());
+  EXPECT_EQ(kFrames, pm.get_node_frame_count(0));
+  EXPECT_EQ(0, pm.get_frame_node(kFrames - 1));
+  EXPECT_THROW(pm.set_current_node(1), 
+               mem::PhysicalMemoryBankConfigurationException);
+  EXPECT_THROW(pm.set_banks({ PhysicalMemory::BankConfig(3, 1, 2),
+                              PhysicalMemory::BankConfig(4, 1, 2) }),
+               mem::PhysicalMemoryBankConfigurationException);
+  
+  // Node 0 has frames 0-1, node 1 has frames 2-7
+  pm.set_banks({ PhysicalMemory::BankConfig(2, 10, 30),
+                 PhysicalMemory::BankConfig(6, 20, 50) });
+  ASSERT_EQ(2, pm.get_node_count());
+  EXPECT_EQ(2, pm.get_node_first_frame(1));
+  EXPECT_EQ(6, pm.get_node_frame_count(1));
+  EXPECT_EQ(0, pm.get_frame_node(1));
+  EXPECT_EQ(1, pm.get_frame_node(2));
+  EXPECT_EQ(1, pm.get_frame_node(7));
+  
+  // From node 0: one local access, then one spanning frames 1 and 2
+  uint8_t buf[16] = { 0 };
+  pm.put_bytes(0, 4, buf);
+  pm.get_bytes(buf, 2 * mem::kPageSize - 8, 16);
+  pm.get_node_stats(0, stats);
+  EXPECT_EQ(2, stats.local_accesses);
+  EXPECT_EQ(1, stats.remote_accesses);
+  EXPECT_EQ(12, stats.local_bytes);
+  EXPECT_EQ(8, stats.remote_bytes);
+  EXPECT_EQ(10 + 10 + 50, stats.access_cost);
+  
+  // From node 1
+  pm.set_current_node(1);
+  pm.put_32(0, 1);
+  pm.put_32(5 * mem::kPageSize, 1);
+  pm.get_node_stats(1, stats);
+  EXPECT_EQ(1, stats.local_accesses);
+  EXPECT_EQ(1, stats.remote_accesses);
+  EXPECT_EQ(30 + 20, stats.access_cost);
+  
+  pm.ResetNodeStats();
+  pm.get_node_stats(0, stats);
+  EXPECT_EQ(0, stats.access_cost);
+  
+  // Removing banks returns to a single node
+  pm.set_banks({});
+  EXPECT_EQ(1, pm.get_node_count());
+}
+
+TEST_F(PhysicalMemoryTests, Watchpoints) {
+  const Addr kFrames = 4;
+  PhysicalMemory pm(kFrames * mem::kPageSize);
+  auto writes = std::make_shared<RecordingWatchHandler>();
+  auto all = std::make_shared<RecordingWatchHandler>();
+  
+  EXPECT_THROW(pm.AddWatchpoint(kFrames * mem::kPageSize - 2, 4, 
+                                mem::kWatchWrite, writes),
+               PhysicalMemoryBoundsException);
+  int write_id = pm.AddWatchpoint(0x100, 8, mem::kWatchWrite, writes);
+  int all_id = pm.AddWatchpoint(mem::kPageSize - 4, 8, mem::kWatchReadWrite, 
+                                all);
+  
+  // Accesses outside the ranges, or of the wrong kind, don't trigger
+  uint8_t buf[16] = { 1, 2, 3, 4 };
+  pm.put_bytes(0xF8, 8, buf);
+  pm.get_bytes(buf, 0x100, 8);
+  pm.put_32(2 * mem::kPageSize, 7);
+  EXPECT_TRUE(writes->events.empty());
+  EXPECT_TRUE(all->events.empty());
+  
+  // Overlapping write
+  pm.put_bytes(0xFC, 8, buf);
+  ASSERT_EQ(1, writes->events.size());
+  EXPECT_EQ(write_id, writes->events[0].id);
+  EXPECT_EQ(0xFC, writes->events[0].address);
+  EXPECT_EQ(8, writes->events[0].count);
+  EXPECT_TRUE(writes->events[0].write);
+  
+  // Read spanning two frames
+  pm.get_bytes(buf, mem::kPageSize - 8, 16);
+  ASSERT_EQ(1, all->events.size());
+  EXPECT_EQ(all_id, all->events[0].id);
+  EXPECT_FALSE(all->events[0].write);
+  
+  // Removed watchpoints no longer trigger
+  EXPECT_TRUE(pm.RemoveWatchpoint(write_id));
+  EXPECT_FALSE(pm.RemoveWatchpoint(write_id));
+  pm.put_bytes(0x100, 8, buf);
+  EXPECT_EQ(1, writes->events.size());
+}
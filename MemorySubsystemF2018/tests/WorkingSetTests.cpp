@@ -0,0 +1,72 @@
+/*
+ * File:   WorkingSetTests.cpp
+ */
+#include "../WorkingSet.h"
+#include "../MMU.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace mem;
+
+TEST(WorkingSetTests, IdleAges) {
+  const Addr kPageCount = 32;
+  MMU vm(kPageCount, 8);
+  const Addr kKernelPageTableBase = 1 * kPageSize;
+  const Addr kPageTableBase = 2 * kPageSize;
+  
+  // Kernel maps all of memory; user maps 6 pages at frames 10 to 15
+  PageTable page_table;
+  for (Addr i = 0; i < kPageCount; ++i) {
+    page_table[i] = (i << kPageSizeBits) | kPTE_PresentMask | kPTE_WritableMask;
+  }
+  vm.put_bytes(kKernelPageTableBase, kPageTableSizeBytes, &page_table);
+  vm.enter_virtual_mode(PMCB(kKernelPageTableBase));
+  page_table.fill(0);
+  for (Addr i = 0; i < 6; ++i) {
+    page_table[i] = ((10 + i) << kPageSizeBits) | kPTE_PresentMask 
+            | kPTE_WritableMask;
+  }
+  vm.put_bytes(kPageTableBase, kPageTableSizeBytes, &page_table);
+  vm.set_user_PMCB(PMCB(kPageTableBase));
+  vm.FlushTLB();
+  
+  WorkingSetEstimator estimator(vm, kPageTableBase);
+  uint8_t byte;
+  for (Addr i = 0; i < 6; ++i) vm.get_byte(&byte, i * kPageSize);
+  EXPECT_EQ(6, estimator.Scan());
+  
+  // Touch pages 0 and 1 every scan (the second touch of each is a TLB hit
+  // before the first scan clears the bit), and page 2 only in the first
+  for (int scan = 0; scan < 3; ++scan) {
+    vm.get_byte(&byte, 0);
+    vm.get_byte(&byte, kPageSize);
+    vm.get_byte(&byte, kPageSize + 1);
+    if (scan == 0) vm.get_byte(&byte, 2 * kPageSize);
+    estimator.Scan();
+  }
+  EXPECT_EQ(std::vector<Addr>({ 6, 3, 2, 2 }), estimator.get_wss_history());
+  EXPECT_EQ(4, estimator.get_scan_count());
+  EXPECT_EQ(0, estimator.get_idle_age(kPageSize));
+  EXPECT_EQ(2, estimator.get_idle_age(2 * kPageSize));
+  EXPECT_EQ(3, estimator.get_idle_age(5 * kPageSize));
+  EXPECT_EQ(2, estimator.get_working_set_size(1));
+  EXPECT_EQ(3, estimator.get_working_set_size(3));
+  EXPECT_EQ(6, estimator.get_working_set_size(4));
+  
+  std::vector<Addr> histogram;
+  estimator.get_idle_histogram(histogram);
+  ASSERT_EQ(WorkingSetEstimator::kMaxIdleAge + 1, histogram.size());
+  EXPECT_EQ(2, histogram[0]);
+  EXPECT_EQ(1, histogram[2]);
+  EXPECT_EQ(3, histogram[3]);
+  
+  // Accessed bits were cleared in the page table
+  vm.set_kernel_PMCB();
+  vm.FlushTLB();
+  vm.get_bytes(&page_table, kPageTableBase, kPageTableSizeBytes);
+  for (Addr i = 0; i < 6; ++i) {
+    EXPECT_EQ(0, page_table[i] & kPTE_AccessedMask);
+  }
+}
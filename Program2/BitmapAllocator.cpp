@@ -0,0 +1,188 @@
+//
+// BitmapAllocator - frame allocator using a two level bitmap of free frames
+//
+
+#include "BitmapAllocator.h"
+#include <algorithm>
+
+BitmapAllocator::BitmapAllocator(mem::MMU *memory_)
+: memory(memory_),
+  frame_count(memory_->get_frame_count()) {
+    bitmap_words = (frame_count + 63) / 64;
+    summary_words = (bitmap_words + 63) / 64;
+    header_frames = (bitmap_offset + (bitmap_words + summary_words) * sizeof(uint64_t)
+                     + page_frame_size - 1) / page_frame_size;
+    if(header_frames >= frame_count){
+        throw std::runtime_error("Not enough frames for bitmap allocator header\n");
+    }
+
+    //build both levels on the host, then write each with one transfer
+    std::vector<uint64_t> bitmap(bitmap_words, 0);
+    std::vector<uint64_t> summary(summary_words, 0);
+    for(uint32_t frame = header_frames; frame < frame_count; frame++){
+        bitmap[frame / 64] |= uint64_t(1) << (frame % 64);
+    }
+    for(uint32_t word = 0; word < bitmap_words; word++){
+        if(bitmap[word] != 0){
+            summary[word / 64] |= uint64_t(1) << (word % 64);
+        }
+    }
+    mem::PhysicalMemory &phys_mem = memory->get_physical_memory();
+    phys_mem.put_bytes(bitmap_word_address(0), bitmap_words * sizeof(uint64_t),
+                       reinterpret_cast<const uint8_t*>(bitmap.data()));
+    phys_mem.put_bytes(summary_word_address(0), summary_words * sizeof(uint64_t),
+                       reinterpret_cast<const uint8_t*>(summary.data()));
+    store_word(page_frames_total, frame_count);
+    store_word(page_frames_free, frame_count - header_frames);
+    store_word(bitmap_words_offset, bitmap_words);
+    store_word(summary_words_offset, summary_words);
+}
+
+bool BitmapAllocator::AllocatePageFrames(uint32_t count, std::vector<uint32_t> &page_frames,
+                                         uint32_t near_frame) {
+    if(get_page_frames_free() < count){
+        //not enough page frames to allocate
+        return false;
+    }
+    if(near_frame >= frame_count){
+        near_frame = 0;
+    }
+    uint32_t start_word = near_frame / 64;
+    uint32_t taken = scan(start_word, bitmap_words, count, near_frame % 64, page_frames);
+    if(taken < count){
+        //wrap around; includes the frames of start_word below near_frame
+        taken += scan(0, start_word + 1, count - taken, 0, page_frames);
+    }
+    store_word(page_frames_free, get_page_frames_free() - count);
+    return true;
+}
+
+bool BitmapAllocator::FreePageFrames(uint32_t count, std::vector<uint32_t> &page_frames) {
+    if(count > page_frames.size()){
+        return false;
+    }
+    //check every frame before changing any
+    for(auto it = page_frames.end() - count; it != page_frames.end(); ++it){
+        uint32_t frame = *it / page_frame_size;
+        if(*it % page_frame_size != 0 || frame < header_frames || frame >= frame_count
+           || is_frame_free(*it)){
+            throw std::runtime_error("Freed frame is not an allocated frame\n");
+        }
+    }
+    std::vector<uint32_t> sorted(page_frames.end() - count, page_frames.end());
+    std::sort(sorted.begin(), sorted.end());
+    if(std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()){
+        throw std::runtime_error("Frame freed twice\n");
+    }
+    for(uint32_t i = 0; i < count; i++){
+        uint32_t frame = page_frames.back() / page_frame_size;
+        uint32_t word = frame / 64;
+        uint64_t bits = read_word64(bitmap_word_address(word));
+        uint64_t bit = uint64_t(1) << (frame % 64);
+        if(bits == 0){
+            uint32_t summary_address = summary_word_address(word / 64);
+            store_word64(summary_address, read_word64(summary_address)
+                                          | uint64_t(1) << (word % 64));
+        }
+        store_word64(bitmap_word_address(word), bits | bit);
+        page_frames.pop_back();
+    }
+    store_word(page_frames_free, get_page_frames_free() + count);
+    return true;
+}
+
+bool BitmapAllocator::is_frame_free(uint32_t frame) const {
+    uint32_t frame_number = frame / page_frame_size;
+    if(frame_number >= frame_count){
+        return false;
+    }
+    return (read_word64(bitmap_word_address(frame_number / 64))
+            >> (frame_number % 64) & 1) != 0;
+}
+
+uint32_t BitmapAllocator::take_from_word(uint32_t word, uint32_t first_bit, uint32_t count,
+                                         std::vector<uint32_t> &page_frames, bool &emptied) {
+    uint32_t address = bitmap_word_address(word);
+    uint64_t bits = read_word64(address);
+    uint64_t available = bits & (~uint64_t(0) << first_bit);
+    uint32_t taken = 0;
+    while(available != 0 && taken < count){
+        uint32_t bit = __builtin_ctzll(available);
+        available &= available - 1;
+        bits &= ~(uint64_t(1) << bit);
+        page_frames.push_back((word * 64 + bit) * page_frame_size);
+        taken++;
+    }
+    store_word64(address, bits);
+    emptied = bits == 0;
+    return taken;
+}
+
+uint32_t BitmapAllocator::scan(uint32_t start_word, uint32_t end_word, uint32_t count,
+                               uint32_t first_bit, std::vector<uint32_t> &page_frames) {
+    mem::PhysicalMemory &phys_mem = memory->get_physical_memory();
+    uint32_t taken = 0;
+    uint32_t summary_word = start_word / 64;
+    while(taken < count && summary_word * 64 < end_word){
+        //read a cache line of summary words at once
+        uint64_t chunk[summary_chunk];
+        uint32_t chunk_words = std::min(uint32_t(summary_chunk), summary_words - summary_word);
+        phys_mem.get_bytes(reinterpret_cast<uint8_t*>(chunk),
+                           summary_word_address(summary_word),
+                           chunk_words * sizeof(uint64_t));
+        bool changed = false;
+        for(uint32_t i = 0; i < chunk_words && taken < count; i++){
+            uint32_t base = (summary_word + i) * 64;
+            if(base >= end_word){
+                break;
+            }
+            uint64_t bits = chunk[i];
+            if(base < start_word){
+                bits &= ~uint64_t(0) << (start_word - base);
+            }
+            if(end_word - base < 64){
+                bits &= (uint64_t(1) << (end_word - base)) - 1;
+            }
+            while(bits != 0 && taken < count){
+                uint32_t word = base + __builtin_ctzll(bits);
+                bits &= bits - 1;
+                bool emptied;
+                taken += take_from_word(word, word == start_word ? first_bit : 0,
+                                        count - taken, page_frames, emptied);
+                if(emptied){
+                    chunk[i] &= ~(uint64_t(1) << (word - base));
+                    changed = true;
+                }
+            }
+        }
+        if(changed){
+            phys_mem.put_bytes(summary_word_address(summary_word),
+                               chunk_words * sizeof(uint64_t),
+                               reinterpret_cast<const uint8_t*>(chunk));
+        }
+        summary_word += chunk_words;
+    }
+    return taken;
+}
+
+uint32_t BitmapAllocator::read_word(uint32_t address) const {
+    uint32_t v32;
+    memory->get_physical_memory().get_32(&v32, address);
+    return v32;
+}
+
+void BitmapAllocator::store_word(uint32_t address, uint32_t data) {
+    memory->get_physical_memory().put_32(address, data);
+}
+
+uint64_t BitmapAllocator::read_word64(uint32_t address) const {
+    uint64_t v64;
+    memory->get_physical_memory().get_bytes(reinterpret_cast<uint8_t*>(&v64),
+                                            address, sizeof(v64));
+    return v64;
+}
+
+void BitmapAllocator::store_word64(uint32_t address, uint64_t data) {
+    memory->get_physical_memory().put_bytes(address, sizeof(data),
+                                            reinterpret_cast<const uint8_t*>(&data));
+}
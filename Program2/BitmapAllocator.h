@@ -0,0 +1,146 @@
+//
+// BitmapAllocator - frame allocator using a two level bitmap of free frames
+//
+
+#ifndef LAB03_BITMAPALLOCATOR_H
+#define LAB03_BITMAPALLOCATOR_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+#include <MMU.h>
+
+/**
+ * BitmapAllocator - alternative to MemoryAllocator which keeps one bit per
+ * frame (1 = free) instead of a free list, with the same AllocatePageFrames
+ * and FreePageFrames calls.
+ *
+ * A summary level has one bit per 64-bit bitmap word, set when the word has
+ * any free frame, so a search skips 4096 allocated frames per summary word
+ * and reads summary words a cache line (8 words) at a time. Within a word,
+ * free frames are found with count-trailing-zeros, and all the frames an
+ * allocation needs from one word are taken with a single read and write.
+ *
+ * All state lives in the simulated memory, starting in frame 0:
+ *   total frames, free frames, bitmap word count, summary word count, then
+ *   (from offset 64) the bitmap, then the summary. The frames holding this
+ *   header are never allocated.
+ */
+class BitmapAllocator {
+public:
+    /**
+     * Constructor - mark all frames after the header free
+     *
+     * @param memory_ MMU whose physical memory is managed
+     */
+    BitmapAllocator(mem::MMU *memory_);
+    ~BitmapAllocator(){};
+    BitmapAllocator(BitmapAllocator& orig) = delete;
+    BitmapAllocator(BitmapAllocator&& orig)= delete;
+    BitmapAllocator& operator=(BitmapAllocator& right) = delete;
+    BitmapAllocator& operator=(BitmapAllocator&& right)=delete;
+
+    /**
+     * pushes 'count' free frames into the process vector, searching upward
+     * from near_frame and wrapping around. Either all count frames are
+     * allocated or none are.
+     *
+     * @param count the number of frames to allocate
+     * @param page_frames vector of frames allocated to the calling process
+     * @param near_frame frame number to start searching at
+     * @return true if frames were allocated
+     */
+    bool AllocatePageFrames(uint32_t count, std::vector<uint32_t> &page_frames,
+                            uint32_t near_frame = 0);
+
+    /**
+     * frees the last 'count' frames of the process vector
+     *
+     * @param count the number of frames to free
+     * @param page_frames vector of frames freed from the calling process
+     * @return true if frames were freed
+     * @throws std::runtime_error if a frame is already free, appears twice,
+     *         or is not a frame managed by the allocator; nothing is freed
+     */
+    bool FreePageFrames(uint32_t count, std::vector<uint32_t> &page_frames);
+
+    /**
+     *
+     * @return number of free page frames
+     */
+    uint32_t get_page_frames_free() const { return read_word(page_frames_free); }
+
+    /**
+     *
+     * @param frame physical address of a frame
+     * @return true if the frame is free
+     */
+    bool is_frame_free(uint32_t frame) const;
+
+    /**
+     *
+     * @return number of frames holding the bitmap header
+     */
+    uint32_t get_header_frames() const { return header_frames; }
+
+private:
+    mem::MMU *memory;
+    uint32_t frame_count;
+    uint32_t bitmap_words;
+    uint32_t summary_words;
+    uint32_t header_frames;
+
+    static const uint32_t page_frame_size = 0x2000;
+    //offsets in frame 0
+    static const uint32_t page_frames_total = 0;
+    static const uint32_t page_frames_free = sizeof(uint32_t);
+    static const uint32_t bitmap_words_offset = 2 * sizeof(uint32_t);
+    static const uint32_t summary_words_offset = 3 * sizeof(uint32_t);
+    static const uint32_t bitmap_offset = 64;
+    //summary words read at once
+    static const uint32_t summary_chunk = 8;
+
+    uint32_t bitmap_word_address(uint32_t word) const {
+        return bitmap_offset + word * sizeof(uint64_t);
+    }
+    uint32_t summary_word_address(uint32_t word) const {
+        return bitmap_word_address(bitmap_words) + word * sizeof(uint64_t);
+    }
+
+    uint32_t read_word(uint32_t address) const;
+    void store_word(uint32_t address, uint32_t data);
+    uint64_t read_word64(uint32_t address) const;
+    void store_word64(uint32_t address, uint64_t data);
+
+    /**
+     * takes up to 'count' free frames from a bitmap word
+     *
+     * @param word bitmap word number
+     * @param first_bit lowest bit to take
+     * @param count maximum number of frames to take
+     * @param page_frames frames taken are appended
+     * @param emptied set true if the word has no free frames left
+     * @return number of frames taken
+     */
+    uint32_t take_from_word(uint32_t word, uint32_t first_bit, uint32_t count,
+                            std::vector<uint32_t> &page_frames, bool &emptied);
+
+    /**
+     * takes free frames from bitmap words start_word to end_word - 1,
+     * visiting only the words whose summary bits are set
+     *
+     * @param start_word first bitmap word
+     * @param end_word bitmap word after the last
+     * @param count maximum number of frames to take
+     * @param first_bit lowest bit to take from start_word
+     * @param page_frames frames taken are appended
+     * @return number of frames taken
+     */
+    uint32_t scan(uint32_t start_word, uint32_t end_word, uint32_t count,
+                  uint32_t first_bit, std::vector<uint32_t> &page_frames);
+};
+
+
+#endif //LAB03_BITMAPALLOCATOR_H
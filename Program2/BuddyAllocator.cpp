@@ -0,0 +1,214 @@
+//
+// BuddyAllocator - buddy system allocator for physically contiguous blocks
+//
+
+#include "BuddyAllocator.h"
+#include <sstream>
+
+BuddyAllocator::BuddyAllocator(mem::MMU *memory_, uint32_t first_frame_, uint32_t frame_count)
+: memory(memory_),
+  header(first_frame_ * page_frame_size) {
+    if(first_frame_ > memory->get_frame_count()
+       || frame_count > memory->get_frame_count() - first_frame_){
+        throw std::runtime_error("Buddy allocator range exceeds physical memory\n");
+    }
+    uint32_t header_frames = (state_table + frame_count + page_frame_size - 1) / page_frame_size;
+    if(frame_count <= header_frames){
+        throw std::runtime_error("Buddy allocator range too small\n");
+    }
+    first_block = header + header_frames * page_frame_size;
+    block_frames = frame_count - header_frames;
+    //blocks are aligned to their size in physical memory, so the largest
+    //order is the largest aligned block which fits in the range
+    uint64_t first_index = first_block / page_frame_size;
+    uint64_t end_index = first_index + block_frames;
+    max_order = 0;
+    while(max_order < order_limit){
+        uint64_t size = 2ull << max_order;
+        if(((first_index + size - 1) & ~(size - 1)) + size > end_index){
+            break;
+        }
+        max_order++;
+    }
+
+    store_word(header + frames_total, block_frames);
+    store_word(header + frames_free, 0);
+    store_word(header + max_order_offset, max_order);
+    for(uint32_t order = 0; order <= order_limit; order++){
+        store_word(free_count_address(order), 0);
+        store_word(free_head_address(order), end_of_list);
+    }
+    std::vector<uint8_t> states(block_frames, uint8_t(state_none));
+    memory->get_physical_memory().put_bytes(header + state_table, block_frames, states.data());
+
+    //carve the range into the largest aligned blocks which fit
+    uint64_t index = first_index;
+    while(index < end_index){
+        uint32_t order = max_order;
+        while((index & ((1u << order) - 1)) != 0 || index + (1u << order) > end_index){
+            order--;
+        }
+        push_free_block(uint32_t(index * page_frame_size), order);
+        index += 1u << order;
+    }
+    store_word(header + frames_free, block_frames);
+}
+
+bool BuddyAllocator::AllocateBlock(uint32_t order, uint32_t &block) {
+    if(order > max_order){
+        throw std::runtime_error("Block order exceeds max order\n");
+    }
+    //find the smallest free block at least as large as requested
+    uint32_t found = order;
+    while(found <= max_order && get_free_block_count(found) == 0){
+        found++;
+    }
+    if(found > max_order){
+        buddy_stats.failed_allocations++;
+        return false;
+    }
+    block = read_word(free_head_address(found));
+    remove_free_block(block, found);
+
+    //split, returning the upper halves to the free lists
+    while(found > order){
+        found--;
+        push_free_block(block + (page_frame_size << found), found);
+        buddy_stats.splits++;
+    }
+    store_state(block, state_allocated | order);
+    store_word(header + frames_free, get_page_frames_free() - (1u << order));
+    buddy_stats.allocations++;
+    return true;
+}
+
+bool BuddyAllocator::AllocateFrames(uint32_t count, uint32_t &block) {
+    if(count > (1u << max_order)){
+        buddy_stats.failed_allocations++;
+        return false;
+    }
+    return AllocateBlock(order_for(count), block);
+}
+
+void BuddyAllocator::FreeBlock(uint32_t block) {
+    if(block < first_block || (block - first_block) % page_frame_size != 0
+       || (block - first_block) / page_frame_size >= block_frames
+       || (read_state(block) & ~state_order_mask) != state_allocated){
+        throw std::runtime_error("Freed address is not an allocated block\n");
+    }
+    uint32_t order = read_state(block) & state_order_mask;
+    store_word(header + frames_free, get_page_frames_free() + (1u << order));
+
+    //merge with the buddy while it is a free block of the same order
+    uint32_t first_index = first_block / page_frame_size;
+    uint32_t index = block / page_frame_size;
+    while(order < max_order){
+        uint32_t buddy_index = index ^ (1u << order);
+        if(buddy_index < first_index
+           || buddy_index + (1u << order) > first_index + block_frames){
+            break;
+        }
+        uint32_t buddy = buddy_index * page_frame_size;
+        if(read_state(buddy) != (state_free | order)){
+            break;
+        }
+        remove_free_block(buddy, order);
+        store_state(index * page_frame_size, state_none);
+        index &= buddy_index;
+        order++;
+        buddy_stats.merges++;
+    }
+    push_free_block(index * page_frame_size, order);
+    buddy_stats.frees++;
+}
+
+uint32_t BuddyAllocator::order_for(uint32_t count) {
+    if(count == 0){
+        throw std::runtime_error("Block must have at least one frame\n");
+    }
+    if(count > (1u << 31)){
+        throw std::runtime_error("Block must have at most 2^31 frames\n");
+    }
+    uint32_t order = 0;
+    while((1u << order) < count){
+        order++;
+    }
+    return order;
+}
+
+void BuddyAllocator::get_fragmentation_stats(FragmentationStats &stats) const {
+    stats = FragmentationStats();
+    stats.free_frames = get_page_frames_free();
+    for(uint32_t order = 0; order <= max_order; order++){
+        uint32_t count = get_free_block_count(order);
+        stats.free_blocks += count;
+        if(count > 0){
+            stats.largest_free_order = order;
+        }
+    }
+    if(stats.free_frames > 0){
+        stats.external_fragmentation =
+            1.0 - double(1u << stats.largest_free_order) / stats.free_frames;
+    }
+}
+
+std::string BuddyAllocator::get_free_list_string() const {
+    std::stringstream free_list;
+    for(uint32_t order = 0; order <= max_order; order++){
+        free_list<<std::dec<<order<<":";
+        uint32_t next_block = read_word(free_head_address(order));
+        while(next_block != end_of_list){
+            free_list<<" "<<std::hex<<next_block;
+            next_block = read_word(next_block + next_offset);
+        }
+        free_list<<"\n";
+    }
+    return free_list.str();
+}
+
+uint8_t BuddyAllocator::read_state(uint32_t block) const {
+    uint8_t state;
+    memory->get_physical_memory().get_byte(&state, state_address(block));
+    return state;
+}
+
+void BuddyAllocator::store_state(uint32_t block, uint8_t state) {
+    memory->get_physical_memory().put_byte(state_address(block), &state);
+}
+
+uint32_t BuddyAllocator::read_word(uint32_t address) const {
+    uint32_t v32;
+    memory->get_physical_memory().get_32(&v32, address);
+    return v32;
+}
+
+void BuddyAllocator::store_word(uint32_t address, uint32_t data) {
+    memory->get_physical_memory().put_32(address, data);
+}
+
+void BuddyAllocator::push_free_block(uint32_t block, uint32_t order) {
+    uint32_t head = read_word(free_head_address(order));
+    store_word(block + next_offset, head);
+    store_word(block + prev_offset, end_of_list);
+    if(head != end_of_list){
+        store_word(head + prev_offset, block);
+    }
+    store_word(free_head_address(order), block);
+    store_word(free_count_address(order), get_free_block_count(order) + 1);
+    store_state(block, state_free | order);
+}
+
+void BuddyAllocator::remove_free_block(uint32_t block, uint32_t order) {
+    uint32_t next = read_word(block + next_offset);
+    uint32_t prev = read_word(block + prev_offset);
+    if(prev == end_of_list){
+        store_word(free_head_address(order), next);
+    } else {
+        store_word(prev + next_offset, next);
+    }
+    if(next != end_of_list){
+        store_word(next + prev_offset, prev);
+    }
+    store_word(free_count_address(order), get_free_block_count(order) - 1);
+    store_state(block, state_none);
+}
@@ -0,0 +1,218 @@
+//
+// BuddyAllocator - buddy system allocator for physically contiguous blocks
+//
+
+#ifndef LAB03_BUDDYALLOCATOR_H
+#define LAB03_BUDDYALLOCATOR_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+#include <MMU.h>
+
+/**
+ * BuddyAllocator - hands out blocks of 2^order physically contiguous frames
+ * from a range of frames, splitting larger blocks as needed and merging a
+ * freed block with its buddy whenever the buddy is free too. Allocation and
+ * free each cost O(max order) memory accesses.
+ *
+ * Like MemoryAllocator, all allocator state lives in the simulated memory.
+ * The first frames of the range hold a header:
+ *   total frames, free frames, max order, then for each order the free
+ *   block count and the head of a doubly linked free list, then one state
+ *   byte per frame (free block head, allocated block head, or neither).
+ * The free lists are threaded through the free blocks (next pointer at
+ * offset 0, previous pointer at offset 4 of the block's first frame).
+ *
+ * Block addresses are physical addresses. Blocks are aligned to their size
+ * in physical memory, so frames at the start and end of the range which do
+ * not fill an aligned block form smaller blocks.
+ */
+class BuddyAllocator {
+public:
+    /**
+     * FragmentationStats - current state of the free blocks
+     */
+    class FragmentationStats {
+    public:
+        FragmentationStats() : free_frames(0), free_blocks(0),
+            largest_free_order(0), external_fragmentation(0.0) {}
+
+        uint32_t free_frames;     // frames in free blocks
+        uint32_t free_blocks;     // number of free blocks of any order
+        uint32_t largest_free_order;  // order of largest free block
+        // 1 - (largest free block / free frames): 0 when all free frames
+        // form one block, approaching 1 when they are scattered
+        double external_fragmentation;
+    };
+
+    /**
+     * BuddyStats - counts of allocator operations
+     */
+    class BuddyStats {
+    public:
+        BuddyStats() : allocations(0), failed_allocations(0), frees(0),
+                       splits(0), merges(0) {}
+
+        uint64_t allocations;         // blocks allocated
+        uint64_t failed_allocations;  // requests with no block large enough
+        uint64_t frees;               // blocks freed
+        uint64_t splits;              // blocks split in two
+        uint64_t merges;              // buddy pairs merged
+    };
+
+    /**
+     * Constructor - build the free lists for a range of frames. The range
+     * must not be managed by any other allocator.
+     *
+     * @param memory_ MMU whose physical memory is managed
+     * @param first_frame_ frame number of first frame in range
+     * @param frame_count number of frames in range, including the header
+     * @throws std::runtime_error if the range is outside physical memory or
+     *         too small to hold the header and one block
+     */
+    BuddyAllocator(mem::MMU *memory_, uint32_t first_frame_, uint32_t frame_count);
+    ~BuddyAllocator(){};
+    BuddyAllocator(BuddyAllocator& orig) = delete;
+    BuddyAllocator(BuddyAllocator&& orig)= delete;
+    BuddyAllocator& operator=(BuddyAllocator& right) = delete;
+    BuddyAllocator& operator=(BuddyAllocator&& right)=delete;
+
+    /**
+     * allocates a block of 2^order contiguous frames
+     *
+     * @param order log2 of the number of frames
+     * @param block set to the physical address of the first frame
+     * @return true if allocated, false if no free block is large enough
+     * @throws std::runtime_error if order exceeds the max order
+     */
+    bool AllocateBlock(uint32_t order, uint32_t &block);
+
+    /**
+     * allocates the smallest block holding count contiguous frames
+     *
+     * @param count number of frames (> 0)
+     * @param block set to the physical address of the first frame
+     * @return true if allocated, false if no free block is large enough
+     */
+    bool AllocateFrames(uint32_t count, uint32_t &block);
+
+    /**
+     * frees a block, merging it with its buddy while the buddy is free
+     *
+     * @param block physical address returned by AllocateBlock
+     * @throws std::runtime_error if block is not an allocated block
+     */
+    void FreeBlock(uint32_t block);
+
+    /**
+     *
+     * @param count number of frames (> 0)
+     * @return smallest order whose blocks hold count frames
+     * @throws std::runtime_error if count is 0 or more than 2^31
+     */
+    static uint32_t order_for(uint32_t count);
+
+    /**
+     *
+     * @return largest order of block which can be allocated
+     */
+    uint32_t get_max_order() const { return max_order; }
+
+    /**
+     *
+     * @return number of free page frames
+     */
+    uint32_t get_page_frames_free() const { return read_word(header + frames_free); }
+
+    /**
+     *
+     * @param order block order
+     * @return number of free blocks of the order
+     */
+    uint32_t get_free_block_count(uint32_t order) const {
+        return read_word(free_count_address(order));
+    }
+
+    /**
+     *
+     * @param stats set to the current state of the free blocks
+     */
+    void get_fragmentation_stats(FragmentationStats &stats) const;
+
+    /**
+     *
+     * @param stats set to a copy of the operation counts
+     */
+    void get_stats(BuddyStats &stats) const { stats = buddy_stats; }
+
+    /**
+     *
+     * @return string representation of the free lists, one line per order
+     */
+    std::string get_free_list_string() const;
+
+private:
+    mem::MMU *memory;
+    uint32_t header;       // physical address of header
+    uint32_t first_block;  // physical address of first frame after header
+    uint32_t block_frames; // frames after the header
+    uint32_t max_order;
+    BuddyStats buddy_stats;
+
+    static const uint32_t page_frame_size = 0x2000;
+    static const uint32_t end_of_list = 0xffffffff;
+    //maximum order supported by the header layout
+    static const uint32_t order_limit = 24;
+    //offsets in header
+    static const uint32_t frames_total = 0;
+    static const uint32_t frames_free = sizeof(uint32_t);
+    static const uint32_t max_order_offset = 2 * sizeof(uint32_t);
+    static const uint32_t order_table = 3 * sizeof(uint32_t);
+    //frame state table follows the order table
+    static const uint32_t state_table = order_table + (order_limit + 1) * 2 * sizeof(uint32_t);
+    //frame states
+    static const uint8_t state_none = 0;
+    static const uint8_t state_free = 0x80;       // | order
+    static const uint8_t state_allocated = 0x40;  // | order
+    static const uint8_t state_order_mask = 0x3f;
+    //offsets of free list pointers in a free block
+    static const uint32_t next_offset = 0;
+    static const uint32_t prev_offset = sizeof(uint32_t);
+
+    uint32_t free_count_address(uint32_t order) const {
+        return header + order_table + order * 2 * sizeof(uint32_t);
+    }
+    uint32_t free_head_address(uint32_t order) const {
+        return free_count_address(order) + sizeof(uint32_t);
+    }
+
+    /**
+     *
+     * @param block physical address of a frame after the header
+     * @return address of the frame's state byte
+     */
+    uint32_t state_address(uint32_t block) const {
+        return header + state_table + (block - first_block) / page_frame_size;
+    }
+
+    uint8_t read_state(uint32_t block) const;
+    void store_state(uint32_t block, uint8_t state);
+    uint32_t read_word(uint32_t address) const;
+    void store_word(uint32_t address, uint32_t data);
+
+    /**
+     * adds a free block to the head of the free list of its order
+     */
+    void push_free_block(uint32_t block, uint32_t order);
+
+    /**
+     * removes a free block from the free list of its order
+     */
+    void remove_free_block(uint32_t block, uint32_t order);
+};
+
+
+#endif //LAB03_BUDDYALLOCATOR_H
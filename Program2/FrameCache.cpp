@@ -0,0 +1,228 @@
+//
+// FrameCache - thread-safe front end to MemoryAllocator with per-thread
+// magazines of free frames
+//
+
+#include "FrameCache.h"
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+//source of FrameCache instance ids (never reused, unlike addresses)
+std::atomic<uint64_t> next_instance_id(1);
+
+}
+
+FrameCache::FrameCache(MemoryAllocator *allocator_, uint32_t magazine_size_,
+                       const MemoryAllocator::PlacementPolicy &policy_)
+: allocator(allocator_),
+  magazine_size(magazine_size_),
+  policy(policy_),
+  instance_id(next_instance_id++) {
+    if(magazine_size == 0){
+        throw std::runtime_error("Magazine size must be at least 1\n");
+    }
+}
+
+FrameCache::~FrameCache() {
+    for(auto &cache : thread_caches){
+        drain(*cache, cache->loaded);
+        drain(*cache, cache->previous);
+    }
+    for(auto &magazine : depot){
+        allocator->FreePageFrames(magazine.size(), magazine);
+    }
+}
+
+bool FrameCache::AllocatePageFrames(uint32_t count, std::vector<uint32_t> &page_frames) {
+    ThreadCache &cache = get_thread_cache();
+    if(count > magazine_size){
+        std::lock_guard<std::mutex> lock(allocator_mutex);
+        if(!allocator->AllocatePageFrames(count, page_frames, policy)){
+            //the depot may hold the frames needed
+            if(depot.empty()){
+                return false;
+            }
+            for(auto &magazine : depot){
+                allocator->FreePageFrames(magazine.size(), magazine);
+                cache.drains.fetch_add(1, std::memory_order_relaxed);
+            }
+            depot.clear();
+            if(!allocator->AllocatePageFrames(count, page_frames, policy)){
+                return false;
+            }
+        }
+        cache.misses.fetch_add(count, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    uint32_t taken = 0;
+    while(taken < count){
+        if(cache.loaded.empty()){
+            if(!cache.previous.empty()){
+                cache.loaded.swap(cache.previous);
+            } else if(!refill(cache, cache.loaded)){
+                //give back what was taken, so nothing is allocated
+                for(uint32_t i = 0; i < taken; i++){
+                    cache.loaded.push_back(page_frames.back());
+                    page_frames.pop_back();
+                }
+                return false;
+            }
+        }
+        page_frames.push_back(cache.loaded.back());
+        cache.loaded.pop_back();
+        taken++;
+    }
+    cache.hits.fetch_add(count, std::memory_order_relaxed);
+    return true;
+}
+
+bool FrameCache::FreePageFrames(uint32_t count, std::vector<uint32_t> &page_frames) {
+    if(count > page_frames.size()){
+        return false;
+    }
+    ThreadCache &cache = get_thread_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    for(uint32_t i = 0; i < count; i++){
+        if(cache.loaded.size() == magazine_size){
+            if(!cache.previous.empty()){
+                put_full(cache, cache.previous);
+            }
+            cache.loaded.swap(cache.previous);
+        }
+        cache.loaded.push_back(page_frames.back());
+        page_frames.pop_back();
+    }
+    cache.hits.fetch_add(count, std::memory_order_relaxed);
+    return true;
+}
+
+void FrameCache::Flush() {
+    ThreadCache &cache = get_thread_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    drain(cache, cache.loaded);
+    drain(cache, cache.previous);
+}
+
+void FrameCache::get_stats(CacheStats &stats) const {
+    stats = CacheStats();
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    for(auto &cache : thread_caches){
+        stats.hits += cache->hits.load(std::memory_order_relaxed);
+        stats.misses += cache->misses.load(std::memory_order_relaxed);
+        stats.refills += cache->refills.load(std::memory_order_relaxed);
+        stats.drains += cache->drains.load(std::memory_order_relaxed);
+        stats.depot_gets += cache->depot_gets.load(std::memory_order_relaxed);
+        stats.depot_puts += cache->depot_puts.load(std::memory_order_relaxed);
+        stats.steals += cache->steals.load(std::memory_order_relaxed);
+    }
+}
+
+FrameCache::ThreadCache &FrameCache::get_thread_cache() {
+    //most threads use one cache, so check the last one used first
+    thread_local uint64_t last_id = 0;
+    thread_local ThreadCache *last_cache = nullptr;
+    thread_local std::unordered_map<uint64_t, std::weak_ptr<ThreadCache>> caches;
+    if(last_id == instance_id){
+        return *last_cache;
+    }
+    auto found = caches.find(instance_id);
+    ThreadCache *cache = found == caches.end() ? nullptr : found->second.lock().get();
+    if(cache == nullptr){
+        //drop the entries of FrameCaches which have been destroyed
+        for(auto it = caches.begin(); it != caches.end();){
+            if(it->second.expired()){
+                it = caches.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        std::lock_guard<std::mutex> lock(threads_mutex);
+        thread_caches.emplace_back(new ThreadCache());
+        cache = thread_caches.back().get();
+        cache->loaded.reserve(magazine_size);
+        cache->previous.reserve(magazine_size);
+        caches[instance_id] = thread_caches.back();
+    }
+    last_id = instance_id;
+    last_cache = cache;
+    return *cache;
+}
+
+bool FrameCache::refill(ThreadCache &cache, std::vector<uint32_t> &magazine) {
+    {
+        std::lock_guard<std::mutex> lock(allocator_mutex);
+        if(!depot.empty()){
+            magazine.swap(depot.back());
+            depot.pop_back();
+            cache.depot_gets.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        bool filled = allocator->AllocatePageFrames(magazine_size, magazine, policy);
+        if(!filled){
+            //take whatever is left rather than fail while frames remain; a
+            //bound cache can only use its home node's frames
+            uint32_t remaining = policy.placement == MemoryAllocator::Placement::kBind
+                                 ? allocator->get_node_page_frames_free(policy.home_node)
+                                 : allocator->get_page_frames_free();
+            filled = remaining > 0
+                     && allocator->AllocatePageFrames(remaining, magazine, policy);
+        }
+        if(filled){
+            cache.refills.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return steal(cache, magazine);
+}
+
+bool FrameCache::steal(ThreadCache &cache, std::vector<uint32_t> &magazine) {
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    for(auto &other : thread_caches){
+        //a thread holding its own lock may be stealing too, so waiting for
+        //it could deadlock
+        if(other.get() == &cache || !other->mutex.try_lock()){
+            continue;
+        }
+        std::lock_guard<std::mutex> other_lock(other->mutex, std::adopt_lock);
+        for(std::vector<uint32_t> *source : {&other->previous, &other->loaded}){
+            while(!source->empty() && magazine.size() < magazine_size){
+                magazine.push_back(source->back());
+                source->pop_back();
+            }
+        }
+        if(magazine.size() == magazine_size){
+            break;
+        }
+    }
+    if(magazine.empty()){
+        return false;
+    }
+    cache.steals.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void FrameCache::put_full(ThreadCache &cache, std::vector<uint32_t> &magazine) {
+    std::lock_guard<std::mutex> lock(allocator_mutex);
+    if(depot.size() == depot_limit){
+        allocator->FreePageFrames(magazine.size(), magazine);
+        cache.drains.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    depot.emplace_back();
+    depot.back().swap(magazine);
+    magazine.reserve(magazine_size);
+    cache.depot_puts.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FrameCache::drain(ThreadCache &cache, std::vector<uint32_t> &magazine) {
+    if(magazine.empty()){
+        return;
+    }
+    std::lock_guard<std::mutex> lock(allocator_mutex);
+    allocator->FreePageFrames(magazine.size(), magazine);
+    cache.drains.fetch_add(1, std::memory_order_relaxed);
+}
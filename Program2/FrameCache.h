@@ -0,0 +1,180 @@
+//
+// FrameCache - thread-safe front end to MemoryAllocator with per-thread
+// magazines of free frames
+//
+
+#ifndef LAB03_FRAMECACHE_H
+#define LAB03_FRAMECACHE_H
+
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include "MemoryAllocator.h"
+
+/**
+ * FrameCache - lets several host threads allocate and free frames from one
+ * MemoryAllocator. Each thread has two magazines (arrays of up to
+ * magazine_size free frames). Most calls are served from the calling
+ * thread's magazines under the thread's own lock, which other threads take
+ * only to steal frames. When both magazines are empty (or both full), a
+ * whole magazine is exchanged with a shared depot of full magazines, or
+ * refilled from (or drained to) the allocator, under a single lock, so the
+ * allocator's free lists in frame 0 are touched once per magazine instead
+ * of once per frame.
+ *
+ * A thread whose magazines are empty takes a full magazine from the depot
+ * first, then frames from the allocator; only when both are exhausted does
+ * it steal the frames in other threads' magazines, so an allocation fails
+ * only when no free frame is left anywhere.
+ *
+ * While a FrameCache is in use, the allocator must not be called directly
+ * by other threads. Frames in magazines and in the depot count as allocated
+ * by the allocator; Flush returns the calling thread's frames, and the
+ * destructor returns all of them.
+ */
+class FrameCache {
+public:
+    /**
+     * CacheStats - counts summed over all threads
+     */
+    class CacheStats {
+    public:
+        CacheStats() : hits(0), misses(0), refills(0), drains(0),
+                       depot_gets(0), depot_puts(0), steals(0) {}
+
+        uint64_t hits;     // frames allocated or freed in a thread's magazines
+        uint64_t misses;   // frames allocated or freed directly by the allocator
+        uint64_t refills;  // magazines filled from the allocator
+        uint64_t drains;   // magazines returned to the allocator
+        uint64_t depot_gets;  // full magazines taken from the depot
+        uint64_t depot_puts;  // full magazines put in the depot
+        uint64_t steals;   // magazines filled from other threads' magazines
+    };
+
+    /**
+     *
+     * @param allocator_ allocator supplying frames
+     * @param magazine_size_ frames per magazine (> 0)
+     * @param policy_ home node and placement of frames taken to refill
+     */
+    FrameCache(MemoryAllocator *allocator_, uint32_t magazine_size_ = 64,
+               const MemoryAllocator::PlacementPolicy &policy_
+                   = MemoryAllocator::PlacementPolicy());
+    ~FrameCache();
+    FrameCache(FrameCache& orig) = delete;
+    FrameCache(FrameCache&& orig)= delete;
+    FrameCache& operator=(FrameCache& right) = delete;
+    FrameCache& operator=(FrameCache&& right)=delete;
+
+    /**
+     * pushes 'count' free frames into page_frames. Either all count frames
+     * are allocated or none are. Requests larger than a magazine go to the
+     * allocator directly, after the depot is returned to the allocator if
+     * the allocator is short of frames.
+     *
+     * @param count the number of frames to allocate
+     * @param page_frames vector of frames allocated to the calling thread
+     * @return true if frames were allocated
+     */
+    bool AllocatePageFrames(uint32_t count, std::vector<uint32_t> &page_frames);
+
+    /**
+     * frees the last 'count' frames of page_frames into the calling
+     * thread's magazines
+     *
+     * @param count the number of frames to free
+     * @param page_frames vector of frames freed by the calling thread
+     * @return true if frames were freed
+     */
+    bool FreePageFrames(uint32_t count, std::vector<uint32_t> &page_frames);
+
+    /**
+     * returns the frames in the calling thread's magazines to the allocator
+     */
+    void Flush();
+
+    /**
+     *
+     * @param stats set to counts summed over all threads
+     */
+    void get_stats(CacheStats &stats) const;
+
+private:
+    /**
+     * ThreadCache - magazines and counts of one thread
+     */
+    class ThreadCache {
+    public:
+        ThreadCache() : hits(0), misses(0), refills(0), drains(0),
+                        depot_gets(0), depot_puts(0), steals(0) {}
+
+        //held by the owning thread while it uses the magazines, and by a
+        //thread stealing from them
+        std::mutex mutex;
+        std::vector<uint32_t> loaded;    // frames allocated from here first
+        std::vector<uint32_t> previous;  // swapped with loaded when it runs out
+        std::atomic<uint64_t> hits;
+        std::atomic<uint64_t> misses;
+        std::atomic<uint64_t> refills;
+        std::atomic<uint64_t> drains;
+        std::atomic<uint64_t> depot_gets;
+        std::atomic<uint64_t> depot_puts;
+        std::atomic<uint64_t> steals;
+    };
+
+    MemoryAllocator *allocator;
+    uint32_t magazine_size;
+    MemoryAllocator::PlacementPolicy policy;
+    uint64_t instance_id;   // distinguishes caches in thread-local lookup
+
+    //maximum number of full magazines in the depot
+    static const uint32_t depot_limit = 8;
+
+    //serializes calls to the allocator and access to the depot
+    std::mutex allocator_mutex;
+    std::vector<std::vector<uint32_t>> depot;
+
+    //caches of all threads which have used this FrameCache; threads look
+    //their cache up through weak pointers, which expire when it is destroyed
+    mutable std::mutex threads_mutex;
+    std::vector<std::shared_ptr<ThreadCache>> thread_caches;
+
+    /**
+     *
+     * @return cache of the calling thread, created on first use
+     */
+    ThreadCache &get_thread_cache();
+
+    /**
+     * fills an empty magazine from the depot, else from the allocator, else
+     * from other threads' magazines. The caller holds cache.mutex.
+     *
+     * @return true if any frames were put in the magazine
+     */
+    bool refill(ThreadCache &cache, std::vector<uint32_t> &magazine);
+
+    /**
+     * moves frames from other threads' magazines into an empty magazine.
+     * Caches whose lock is held are skipped. The caller holds cache.mutex.
+     *
+     * @return true if any frames were put in the magazine
+     */
+    bool steal(ThreadCache &cache, std::vector<uint32_t> &magazine);
+
+    /**
+     * moves a full magazine to the depot, or returns its frames to the
+     * allocator if the depot is full
+     */
+    void put_full(ThreadCache &cache, std::vector<uint32_t> &magazine);
+
+    /**
+     * returns all frames of a magazine to the allocator
+     */
+    void drain(ThreadCache &cache, std::vector<uint32_t> &magazine);
+};
+
+
+#endif //LAB03_FRAMECACHE_H
@@ -3,33 +3,50 @@
 //
 
 #include "MemoryAllocator.h"
+#include <algorithm>
+#include <functional>
 #include <cstring>
 #include <sstream>
 #include <iomanip>
 
-MemoryAllocator::MemoryAllocator(uint32_t page_frame_count) {
-    memory.resize(page_frame_count*page_frame_size);
-    processes.resize(4);
-    store_word(page_frames_total, page_frame_count);
-    store_word(page_frames_free,  page_frame_count -1);
-    initialize_free_list(page_frame_count);
+MemoryAllocator::MemoryAllocator(mem::MMU *memory_, MetadataMode mode_)
+: memory(memory_),
+  mode(mode_),
+  node_count(memory_->get_physical_memory().get_node_count()) {
+    uint32_t page_frame_count = memory->get_frame_count();
+    uint32_t header_size = node_table + node_count * 2 * sizeof(uint32_t);
+    if (mode == MetadataMode::kHost) {
+        host_header.resize(header_size / sizeof(uint32_t), 0);
+        host_links.resize(page_frame_count, uint32_t(end_of_list));
+    } else if (header_size > page_frame_size) {
+        throw std::runtime_error("Too many nodes for allocator header\n");
+    }
+    frame_positions.resize(page_frame_count, uint32_t(not_owned));
+    take_scratch.resize(node_count);
+    run_scratch.resize(node_count);
+    store_header(page_frames_total, page_frame_count);
+    store_header(page_frames_free,
+                 page_frame_count - (mode == MetadataMode::kHost ? 0 : 1));
+    initialize_free_list();
 }
 
-bool MemoryAllocator::AllocatePageFrames(uint32_t count, std::vector<uint32_t> &page_frames) {
-    if(get_page_frames_free()<count){
-        //not enouogh page frames to allocate
-        return false;
+bool MemoryAllocator::AllocatePageFrames(uint32_t count, std::vector<uint32_t> &page_frames,
+                                         const PlacementPolicy &policy) {
+    if(policy.home_node >= node_count){
+        throw std::runtime_error("Home node out of bounds for current node count\n");
     }
-    else {
-        uint32_t next_free = get_free_list_head();
-        for (int i = 0; i < count; i++) {
-            page_frames.push_back(next_free);
-            next_free = read_word(next_free);
-        }
-        store_word(free_list_head, next_free);
-        store_word(page_frames_free, get_page_frames_free()-count);
-        return true;
+    size_t first = page_frames.size();
+    page_frames.resize(first + count);
+    if(!allocate(count, page_frames.data() + first, policy, nullptr)){
+        page_frames.resize(first);
+        return false;
     }
+    return true;
+}
+
+bool MemoryAllocator::AllocatePageFrames(uint32_t count, uint32_t *page_frames,
+                                         const PlacementPolicy &policy) {
+    return allocate(count, page_frames, policy, nullptr);
 }
 
 bool MemoryAllocator::FreePageFrames(uint32_t count, std::vector<uint32_t> &page_frames) {
@@ -37,37 +54,160 @@ bool MemoryAllocator::FreePageFrames(uint32_t count, std::vector<uint32_t> &page
         return false;
     }
     else{
-        for(int i=0;i<count;i++){
-            uint32_t next_free = page_frames.back();
-            page_frames.pop_back();
-            uint32_t temp_address = get_free_list_head();
-            store_word(free_list_head, next_free);
-            store_word(next_free, temp_address);
-        }
-        store_word(page_frames_free, get_page_frames_free() + count);
+        FreePageFrames(count, page_frames.data() + page_frames.size() - count);
+        page_frames.resize(page_frames.size() - count);
         return true;
     }
 }
 
+void MemoryAllocator::FreePageFrames(uint32_t count, const uint32_t *page_frames) {
+    //chain the frames of each node together, in order, then splice each
+    //chain onto the head of its node's free list
+    std::vector<uint32_t> first(node_count, uint32_t(end_of_list));
+    std::vector<uint32_t> last(node_count, uint32_t(end_of_list));
+    std::vector<uint32_t> freed(node_count, 0);
+    for(uint32_t i = 0; i < count; i++){
+        uint32_t frame = page_frames[i];
+        uint32_t node = memory->get_physical_memory().get_frame_node(frame / page_frame_size);
+        if(freed[node] == 0){
+            first[node] = frame;
+        } else {
+            store_link(last[node], frame);
+        }
+        last[node] = frame;
+        freed[node]++;
+    }
+    for(uint32_t node = 0; node < node_count; node++){
+        if(freed[node] > 0){
+            splice_free_frames(FrameRun(node, first[node], last[node], freed[node]));
+        }
+    }
+    store_header(page_frames_free, get_page_frames_free() + count);
+}
+
+int MemoryAllocator::CreateProcess(const PlacementPolicy &policy) {
+    if(policy.home_node >= node_count){
+        throw std::runtime_error("Home node out of bounds for current node count\n");
+    }
+    int process_id;
+    if(free_process_ids.empty()){
+        process_id = processes.size();
+        processes.emplace_back();
+    } else {
+        std::pop_heap(free_process_ids.begin(), free_process_ids.end(), std::greater<int>());
+        process_id = free_process_ids.back();
+        free_process_ids.pop_back();
+    }
+    ProcessEntry &process = processes.at(process_id);
+    process.live = true;
+    process.policy = policy;
+    process.runs_valid = true;
+    return process_id;
+}
+
+void MemoryAllocator::DestroyProcess(int process_id) {
+    ProcessEntry &process = get_process(process_id);
+    FreeAllProcessPageFrames(process_id);
+    process.live = false;
+    process.frames.shrink_to_fit();
+    free_process_ids.push_back(process_id);
+    std::push_heap(free_process_ids.begin(), free_process_ids.end(), std::greater<int>());
+}
+
+bool MemoryAllocator::AllocateProcessPageFrames(int process_id, uint32_t count) {
+    ProcessEntry &process = get_process(process_id);
+    uint32_t first = process.frames.size();
+    process.frames.resize(first + count);
+    if(!allocate(count, process.frames.data() + first, process.policy,
+                 process.runs_valid ? &process.runs : nullptr)){
+        process.frames.resize(first);
+        return false;
+    }
+    for(uint32_t i = first; i < process.frames.size(); i++){
+        frame_positions.at(process.frames[i] / page_frame_size) = i;
+    }
+    return true;
+}
+
+bool MemoryAllocator::FreeProcessPageFrames(int process_id, uint32_t count) {
+    ProcessEntry &process = get_process(process_id);
+    if(count > process.frames.size()){
+        return false;
+    }
+    for(auto it = process.frames.end() - count; it != process.frames.end(); ++it){
+        frame_positions.at(*it / page_frame_size) = not_owned;
+    }
+    //the remaining frames no longer match the recorded runs
+    process.runs.clear();
+    process.runs_valid = process.frames.size() == count;
+    return FreePageFrames(count, process.frames);
+}
+
+void MemoryAllocator::FreeAllProcessPageFrames(int process_id) {
+    ProcessEntry &process = get_process(process_id);
+    if(mode == MetadataMode::kHost && process.runs_valid){
+        //each run is still chained through the host links as it was when
+        //allocated, so it goes back with one link and one head update
+        for(const FrameRun &run : process.runs){
+            splice_free_frames(run);
+        }
+        store_header(page_frames_free, get_page_frames_free() + process.frames.size());
+    } else {
+        FreePageFrames(process.frames.size(), process.frames.data());
+    }
+    //frame_positions entries are left stale; FreeProcessPageFrame checks
+    //that the frame is at the recorded position before using it
+    process.frames.clear();
+    process.runs.clear();
+    process.runs_valid = true;
+}
+
+void MemoryAllocator::FreeProcessPageFrame(int process_id, uint32_t frame) {
+    ProcessEntry &process = get_process(process_id);
+    uint32_t position = frame / page_frame_size < frame_positions.size()
+                        ? frame_positions[frame / page_frame_size] : not_owned;
+    if(position >= process.frames.size() || process.frames[position] != frame){
+        throw std::runtime_error("Frame does not belong to process\n");
+    }
+    //move the last frame into the freed frame's place
+    uint32_t last = process.frames.back();
+    process.frames[position] = last;
+    frame_positions[last / page_frame_size] = position;
+    process.frames.back() = frame;
+    FreeProcessPageFrames(process_id, 1);
+}
 
+void MemoryAllocator::set_process_policy(int process_id, const PlacementPolicy &policy) {
+    if(policy.home_node >= node_count){
+        throw std::runtime_error("Home node out of bounds for current node count\n");
+    }
+    get_process(process_id).policy = policy;
+}
+
+const MemoryAllocator::PlacementPolicy &MemoryAllocator::get_process_policy(int process_id) const {
+    return get_process(process_id).policy;
+}
 
 std::string MemoryAllocator::get_free_list_string() const {
     std::stringstream free_list;
-    uint32_t next_frame = get_free_list_head();
-    while(next_frame!= 0xffffffff){
-        free_list<<" "<<std::hex<<next_frame;
-        next_frame = read_word(next_frame);
+    for (uint32_t node = 0; node < node_count; node++) {
+        uint32_t next_frame = read_header(node_free_list_head(node));
+        while(next_frame!= end_of_list){
+            free_list<<" "<<std::hex<<next_frame;
+            next_frame = read_link(next_frame);
+        }
     }
     return std::string(free_list.str());
 }
 
-int MemoryAllocator::memory_index(uint32_t page_number, uint32_t offset) const {
-    return (page_number/get_page_frames_total()) + offset;
+uint32_t MemoryAllocator::memory_index(uint32_t page_number, uint32_t offset) const {
+    return page_number * page_frame_size + offset;
 }
 
 uint32_t MemoryAllocator::read_word(uint32_t address) const {
     uint32_t v32;
-    memcpy(&v32, &memory[address], sizeof(uint32_t));  // v32 contains the 32-bit value from memory}
+    memory->get_physical_memory().get_32(&v32, address);
+    return v32;
 }
 
 uint32_t MemoryAllocator::read_word(uint32_t page_number, uint32_t offset) const {
@@ -75,7 +215,7 @@ uint32_t MemoryAllocator::read_word(uint32_t page_number, uint32_t offset) const
 }
 
 void MemoryAllocator::store_word(uint32_t address, uint32_t data) {
-    memcpy(&memory[address], &data, sizeof(uint32_t));
+    memory->get_physical_memory().put_32(address, data);
 }
 
 void MemoryAllocator::store_word(uint32_t page_number, uint32_t offset, uint32_t data) {
@@ -83,32 +223,147 @@ void MemoryAllocator::store_word(uint32_t page_number, uint32_t offset, uint32_t
 }
 
 uint32_t MemoryAllocator::get_page_address(uint32_t page_number) {
-    if(page_number>=read_word(page_frames_total)){
+    if(page_number>=get_page_frames_total()){
         throw std::runtime_error("Requested Page Number greater than total page count\n");
     }
-    return page_number * 0x2000;
+    return page_number * page_frame_size;
+}
+
+void MemoryAllocator::initialize_free_list() {
+    const mem::PhysicalMemory &phys_mem = memory->get_physical_memory();
+    for (uint32_t node = 0; node < node_count; node++) {
+        //link frames of node in order; frame 0 holds the header in memory
+        uint32_t first = std::max<uint32_t>(phys_mem.get_node_first_frame(node),
+                                            mode == MetadataMode::kHost ? 0 : 1);
+        uint32_t end = phys_mem.get_node_first_frame(node)
+                       + phys_mem.get_node_frame_count(node);
+        uint32_t head = end_of_list;
+        for (uint32_t i = end; i > first; i--) {
+            store_link(get_page_address(i - 1), head);
+            head = get_page_address(i - 1);
+        }
+        store_header(node_free_list_head(node), head);
+        store_header(node_frames_free(node), end > first ? end - first : 0);
+    }
 }
 
-void MemoryAllocator::initialize_free_list(uint32_t page_frame_count) {
-    if(page_frame_count == 1){
-        store_word(free_list_head, 0xffffffff);
+bool MemoryAllocator::allocate(uint32_t count, uint32_t *page_frames,
+                               const PlacementPolicy &policy,
+                               std::vector<FrameRun> *runs) {
+    uint32_t home = policy.home_node;
+    if(home >= node_count){
+        throw std::runtime_error("Home node out of bounds for current node count\n");
     }
-    else if(page_frame_count == 2){
-        store_word(free_list_head, get_page_address(1));
-        store_word(get_page_address(1), 0xffffffff);
+    if(get_page_frames_free()<count){
+        //not enouogh page frames to allocate
+        return false;
     }
-    else{
-        store_word(free_list_head, get_page_address(1));
-        for (int i = 1; i < page_frame_count-1; i++) {
-            store_word(get_page_address(i), get_page_address(i+1));
+
+    //decide how many frames to take from each node before taking any, so
+    //that a failed allocation leaves the free lists unchanged
+    std::vector<uint32_t> &take = take_scratch;
+    std::fill(take.begin(), take.end(), 0);
+    uint32_t remaining = count;
+    if (policy.placement == Placement::kBind) {
+        if (get_node_page_frames_free(home) < count) {
+            return false;
+        }
+        take[home] = count;
+    } else if (policy.placement == Placement::kLocalFirst) {
+        for (uint32_t i = 0; i < node_count && remaining > 0; i++) {
+            uint32_t node = (home + i) % node_count;
+            take[node] = std::min(remaining, get_node_page_frames_free(node));
+            remaining -= take[node];
         }
-        store_word(get_page_address(page_frame_count-1), 0xffffffff);
+    } else {  //interleave; total free >= count, so this terminates
+        for (uint32_t node = home; remaining > 0; node = (node + 1) % node_count) {
+            if (take[node] < get_node_page_frames_free(node)) {
+                take[node]++;
+                remaining--;
+            }
+        }
+    }
+
+    //walk each node's list from its head, then cut the taken segment off
+    //with one head and one count update per node
+    std::vector<FrameRun> &taken = run_scratch;
+    std::fill(taken.begin(), taken.end(), FrameRun());
+    uint32_t *next = page_frames;
+    auto take_frame = [&](uint32_t node) {
+        FrameRun &run = taken[node];
+        uint32_t frame;
+        if (run.count == 0) {
+            frame = read_header(node_free_list_head(node));
+            run.node = node;
+            run.first = frame;
+        } else {
+            frame = read_link(run.last);
+        }
+        run.last = frame;
+        run.count++;
+        *next++ = frame;
+    };
+    if (policy.placement == Placement::kInterleave) {
+        //take frames round robin so consecutive pages alternate nodes
+        remaining = count;
+        for (uint32_t node = home; remaining > 0; node = (node + 1) % node_count) {
+            if (take[node] > 0) {
+                take_frame(node);
+                take[node]--;
+                remaining--;
+            }
+        }
+    } else {
+        for (uint32_t i = 0; i < node_count; i++) {
+            uint32_t node = (home + i) % node_count;
+            for (uint32_t j = 0; j < take[node]; j++) {
+                take_frame(node);
+            }
+        }
+    }
+    for (uint32_t node = 0; node < node_count; node++) {
+        if (taken[node].count == 0) {
+            continue;
+        }
+        store_header(node_free_list_head(node), read_link(taken[node].last));
+        store_header(node_frames_free(node),
+                     get_node_page_frames_free(node) - taken[node].count);
+        if (runs != nullptr) {
+            runs->push_back(taken[node]);
+        }
+    }
+
+    //count frames placed on the home node as local
+    uint32_t local = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (memory->get_physical_memory().get_frame_node(page_frames[i] / page_frame_size) == home) {
+            local++;
+        }
+    }
+    alloc_stats.local_frames += local;
+    alloc_stats.remote_frames += count - local;
+    store_header(page_frames_free, get_page_frames_free()-count);
+    return true;
+}
+
+void MemoryAllocator::splice_free_frames(const FrameRun &run) {
+    store_link(run.last, read_header(node_free_list_head(run.node)));
+    store_header(node_free_list_head(run.node), run.first);
+    store_header(node_frames_free(run.node), get_node_page_frames_free(run.node) + run.count);
+}
+
+MemoryAllocator::ProcessEntry &MemoryAllocator::get_process(int process_id) {
+    if(process_id < 0 || size_t(process_id) >= processes.size()
+       || !processes[process_id].live){
+        throw std::runtime_error("Process ID not in process table\n");
     }
+    return processes[process_id];
 }
 
-std::vector<uint32_t> &MemoryAllocator::get_process_vector(int process_id) {
-    if(process_id>3||process_id<0){
-        throw std::runtime_error("Process ID out of bounds for current process count\n");
+const MemoryAllocator::ProcessEntry &MemoryAllocator::get_process(int process_id) const {
+    if(process_id < 0 || size_t(process_id) >= processes.size()
+       || !processes[process_id].live){
+        throw std::runtime_error("Process ID not in process table\n");
     }
-    return processes.at(process_id);
+    return processes[process_id];
 }
@@ -14,7 +14,65 @@
 
 class MemoryAllocator {
 public:
-    MemoryAllocator(uint32_t page_frame_count);
+    /**
+     * Placement - where frames for an allocation come from, relative to the
+     * home node of the allocation
+     *
+     *   kLocalFirst - home node first, then the other nodes in turn
+     *                 (home+1, home+2, ...) once the home node is exhausted
+     *   kInterleave - one frame from each node in turn, starting at home
+     *   kBind       - home node only; fails if the home node is exhausted
+     */
+    enum class Placement { kLocalFirst, kInterleave, kBind };
+
+    /**
+     * MetadataMode - where the allocator keeps its header and free lists
+     *
+     *   kInMemory - in the simulated memory: the header in frame 0 and each
+     *               free list link in the first word of a free frame. Every
+     *               operation goes through the memory model, and frame 0 is
+     *               never allocated.
+     *   kHost     - in host arrays (header words, and one link per frame),
+     *               with the same layout and allocation order. No simulated
+     *               memory is read or written, and frame 0 is allocatable.
+     */
+    enum class MetadataMode { kInMemory, kHost };
+
+    /**
+     * PlacementPolicy - home node and placement for an allocation
+     */
+    class PlacementPolicy {
+    public:
+        PlacementPolicy(uint32_t home_node_ = 0,
+                        Placement placement_ = Placement::kLocalFirst)
+        : home_node(home_node_), placement(placement_) {}
+
+        uint32_t home_node;
+        Placement placement;
+    };
+
+    /**
+     * AllocationStats - where allocated frames were placed
+     */
+    class AllocationStats {
+    public:
+        AllocationStats() : local_frames(0), remote_frames(0) {}
+
+        uint64_t local_frames;   // frames allocated on the home node
+        uint64_t remote_frames;  // frames allocated on another node
+    };
+
+    /**
+     * Constructor - build the free lists in the memory of an MMU. Frame 0
+     * holds the allocator's header and is never allocated. If the physical
+     * memory is divided into banks (PhysicalMemory::set_banks), the banks
+     * must be configured before the allocator is created; each node then
+     * has its own free list.
+     *
+     * @param memory_ MMU whose physical memory is managed
+     * @param mode_ where the header and free lists are kept
+     */
+    MemoryAllocator(mem::MMU *memory_, MetadataMode mode_ = MetadataMode::kInMemory);
     ~MemoryAllocator(){};
     MemoryAllocator(MemoryAllocator& orig) = delete;
     MemoryAllocator(MemoryAllocator&& orig)= delete;
@@ -22,15 +80,21 @@ public:
     MemoryAllocator& operator=(MemoryAllocator&& right)=delete;
 
     /**
-     * pushes the first 'count' frames into the process vector
+     * pushes 'count' free frames into the process vector, placed according
+     * to policy. Either all count frames are allocated or none are.
      *
      * @param count the number of frames to allocate
      * @param page_frames vector of frames allocaetd to the calling process
+     * @param policy home node and placement of the frames
      * @return true if frames were allocated
+     * @throws std::runtime_error if the home node does not exist
      */
-    bool AllocatePageFrames(uint32_t count, std::vector<uint32_t> &page_frames);
+    bool AllocatePageFrames(uint32_t count, std::vector<uint32_t> &page_frames,
+                            const PlacementPolicy &policy = PlacementPolicy());
 
     /**
+     * frees the last 'count' frames of the process vector, returning each
+     * to the free list of the node holding it
      *
      * @param count the number of frames to free
      * @param page_frames vector of frames freed from the calling process
@@ -38,6 +102,107 @@ public:
      */
     bool FreePageFrames(uint32_t count, std::vector<uint32_t> &page_frames);
 
+    /**
+     * allocates 'count' frames into a caller array, placed according to
+     * policy. Each node's free list is walked once and the taken segment
+     * cut off with one update of its head and count. Either all count
+     * frames are allocated or none are.
+     *
+     * @param count the number of frames to allocate
+     * @param page_frames array of at least count entries, set to the frames
+     * @param policy home node and placement of the frames
+     * @return true if frames were allocated
+     * @throws std::runtime_error if the home node does not exist
+     */
+    bool AllocatePageFrames(uint32_t count, uint32_t *page_frames,
+                            const PlacementPolicy &policy = PlacementPolicy());
+
+    /**
+     * frees the frames in a caller array. The frames of each node are
+     * chained together and spliced onto the node's free list in one
+     * update, so page_frames[0] is the next frame allocated.
+     *
+     * @param count the number of frames to free
+     * @param page_frames array of count frames
+     */
+    void FreePageFrames(uint32_t count, const uint32_t *page_frames);
+
+    /**
+     * adds a process to the process table, reusing the lowest free id if
+     * any process has been destroyed
+     *
+     * @param policy home node and placement used for the process's frames
+     * @return id of the new process
+     * @throws std::runtime_error if the home node does not exist
+     */
+    int CreateProcess(const PlacementPolicy &policy = PlacementPolicy());
+
+    /**
+     * frees all frames of a process and removes it from the process table
+     *
+     * @param process_id id of the process
+     */
+    void DestroyProcess(int process_id);
+
+    /**
+     *
+     * @return number of processes in the process table
+     */
+    uint32_t get_process_count() const { return processes.size() - free_process_ids.size(); }
+
+    /**
+     * allocates frames to a process using the process's placement policy
+     *
+     * @param process_id id of the process
+     * @param count the number of frames to allocate
+     * @return true if frames were allocated
+     */
+    bool AllocateProcessPageFrames(int process_id, uint32_t count);
+
+    /**
+     * frees the last 'count' frames allocated to a process
+     *
+     * @param process_id id of the process
+     * @param count the number of frames to free
+     * @return true if frames were freed
+     */
+    bool FreeProcessPageFrames(int process_id, uint32_t count);
+
+    /**
+     * frees all frames of a process. With kHost metadata, if the process
+     * has only allocated frames (or freed all of them) since it was
+     * created, each allocation's frames are still chained through the host
+     * links, and are spliced back in O(runs): one run per node per
+     * allocation. Otherwise the frames are freed as with FreePageFrames.
+     *
+     * @param process_id id of the process
+     */
+    void FreeAllProcessPageFrames(int process_id);
+
+    /**
+     * frees one frame of a process, wherever it is in the process's frames,
+     * in O(1); the process's last frame takes its place
+     *
+     * @param process_id id of the process
+     * @param frame address of the frame
+     * @throws std::runtime_error if the frame does not belong to the process
+     */
+    void FreeProcessPageFrame(int process_id, uint32_t frame);
+
+    /**
+     *
+     * @param process_id id of the process
+     * @param policy home node and placement used for the process's frames
+     */
+    void set_process_policy(int process_id, const PlacementPolicy &policy);
+
+    /**
+     *
+     * @param process_id id of the process
+     * @return placement policy of the process
+     */
+    const PlacementPolicy &get_process_policy(int process_id) const;
+
     /**
      *
      * @return string representation of the free list
@@ -48,41 +213,130 @@ public:
      * @param process_id id of the process
      * @return the vector of frames allocated to the process with process_id
      */
-    std::vector<uint32_t>& get_process_vector(int process_id);
+    const std::vector<uint32_t>& get_process_vector(int process_id) const {
+        return get_process(process_id).frames;
+    }
     /**
      *
      * @return number of free page frames
      */
-    uint32_t get_page_frames_free() const { return read_word(page_frames_free);};
+    uint32_t get_page_frames_free() const { return read_header(page_frames_free);};
+
+    /**
+     *
+     * @return number of nodes (1 if physical memory has no banks)
+     */
+    uint32_t get_node_count() const { return node_count; }
+
+    /**
+     *
+     * @param node node number
+     * @return number of free page frames in node
+     */
+    uint32_t get_node_page_frames_free(uint32_t node) const {
+        return read_header(node_frames_free(node));
+    }
+
+    /**
+     *
+     * @return where the header and free lists are kept
+     */
+    MetadataMode get_metadata_mode() const { return mode; }
+
+    /**
+     *
+     * @param stats set to a copy of the placement statistics
+     */
+    void get_stats(AllocationStats &stats) const { stats = alloc_stats; }
 private:
-    //std::vector<uint8_t> memory;
+    /**
+     * FrameRun - frames taken from one node's free list in one allocation,
+     * chained first to last through their free list links
+     */
+    class FrameRun {
+    public:
+        FrameRun(uint32_t node_ = 0, uint32_t first_ = end_of_list,
+                 uint32_t last_ = end_of_list, uint32_t count_ = 0)
+        : node(node_), first(first_), last(last_), count(count_) {}
+
+        uint32_t node;
+        uint32_t first;
+        uint32_t last;
+        uint32_t count;
+    };
+
+    /**
+     * ProcessEntry - process table entry
+     */
+    class ProcessEntry {
+    public:
+        bool live;
+        PlacementPolicy policy;
+        std::vector<uint32_t> frames;
+        //runs of the frames, in allocation order; valid while the process
+        //has freed no frames singly or in part
+        std::vector<FrameRun> runs;
+        bool runs_valid;
+    };
+
     mem::MMU *memory;
-    std::vector<std::vector<uint32_t>> processes;
+    MetadataMode mode;
+    //kHost metadata: header words (indexed by offset / 4), and the free
+    //list link of each frame (indexed by frame number)
+    std::vector<uint32_t> host_header;
+    std::vector<uint32_t> host_links;
+    //indexed by process id; ids of destroyed processes are kept in a heap
+    //so the lowest is reused first
+    std::vector<ProcessEntry> processes;
+    std::vector<int> free_process_ids;
+    //position of each allocated frame in its process's frames, indexed by
+    //frame number (frames not owned by a process are not_owned)
+    std::vector<uint32_t> frame_positions;
+    uint32_t node_count;
+    AllocationStats alloc_stats;
+    //per node work space of allocate, kept to avoid allocating each call
+    std::vector<uint32_t> take_scratch;
+    std::vector<FrameRun> run_scratch;
 
     static const uint32_t page_frame_size = 0x2000;
+    static const uint32_t end_of_list = 0xffffffff;
+    static const uint32_t not_owned = 0xffffffff;
     //offsets to these values in page frame 0, stored immediately after head pointer
     static const uint32_t page_frames_total=sizeof(uint32_t);
     static const uint32_t page_frames_free = 2* sizeof(uint32_t);
-    static const uint32_t free_list_head = 3* sizeof(uint32_t);
+    //per node free count and free list head follow, 2 words per node
+    static const uint32_t node_table = 4* sizeof(uint32_t);
 
     /**
      *
-     * @param page_number the page to find the address within
-     * @param offset the offset desired within page_number
-     * @return the absolute memory address of that address
+     * @param node node number
+     * @return offset in page frame 0 of the free frame count of node
      */
-    int memory_index(uint32_t page_number, uint32_t offset) const;
+    static uint32_t node_frames_free(uint32_t node) {
+        return node_table + node * 2 * sizeof(uint32_t);
+    }
+
     /**
      *
-     * @return total page frames
+     * @param node node number
+     * @return offset in page frame 0 of the free list head of node
      */
-    uint32_t get_page_frames_total() const {return read_word(page_frames_total);};
+    static uint32_t node_free_list_head(uint32_t node) {
+        return node_frames_free(node) + sizeof(uint32_t);
+    }
 
     /**
      *
-     * @return page frame address of the first frame in the free list
+     * @param page_number the page to find the address within
+     * @param offset the offset desired within page_number
+     * @return the absolute memory address of that address
+     */
+    uint32_t memory_index(uint32_t page_number, uint32_t offset) const;
+    /**
+     *
+     * @return total page frames
      */
-    uint32_t get_free_list_head() const { return read_word(free_list_head);};
+    uint32_t get_page_frames_total() const {return read_header(page_frames_total);};
 
     /**
      *
@@ -113,6 +367,52 @@ private:
      */
     void store_word(uint32_t page_number, uint32_t offset, uint32_t data);
 
+    /**
+     *
+     * @param offset offset of a header word
+     * @return the header word, from frame 0 or the host header
+     */
+    uint32_t read_header(uint32_t offset) const {
+        return mode == MetadataMode::kHost ? host_header[offset / sizeof(uint32_t)]
+                                           : read_word(offset);
+    }
+
+    /**
+     *
+     * @param offset offset of a header word
+     * @param data value to store in frame 0 or the host header
+     */
+    void store_header(uint32_t offset, uint32_t data) {
+        if (mode == MetadataMode::kHost) {
+            host_header[offset / sizeof(uint32_t)] = data;
+        } else {
+            store_word(offset, data);
+        }
+    }
+
+    /**
+     *
+     * @param frame address of a free frame
+     * @return address of the next frame in its free list
+     */
+    uint32_t read_link(uint32_t frame) const {
+        return mode == MetadataMode::kHost ? host_links[frame / page_frame_size]
+                                           : read_word(frame);
+    }
+
+    /**
+     *
+     * @param frame address of a free frame
+     * @param next address of the next frame in its free list
+     */
+    void store_link(uint32_t frame, uint32_t next) {
+        if (mode == MetadataMode::kHost) {
+            host_links[frame / page_frame_size] = next;
+        } else {
+            store_word(frame, next);
+        }
+    }
+
     /**
      *
      * @param page_number
@@ -122,9 +422,38 @@ private:
 
     /**
      *
-     * @param page_frame_count number of page frames
+     * @param process_id id of the process
+     * @return process table entry
+     * @throws std::runtime_error if there is no such process
+     */
+    ProcessEntry &get_process(int process_id);
+    const ProcessEntry &get_process(int process_id) const;
+
+    /**
+     * builds the free list of each node from all frames (except frame 0 if
+     * it holds the header)
+     */
+    void initialize_free_list();
+
+    /**
+     * allocates frames into an array, recording the chain segment taken
+     * from each node's free list
+     *
+     * @param count the number of frames to allocate
+     * @param page_frames array of at least count entries
+     * @param policy home node and placement of the frames
+     * @param runs if not null, one run is appended per node used
+     * @return true if frames were allocated
+     */
+    bool allocate(uint32_t count, uint32_t *page_frames,
+                  const PlacementPolicy &policy, std::vector<FrameRun> *runs);
+
+    /**
+     * puts a chain of frames at the head of its node's free list
+     *
+     * @param run frames linked from first to last, all on run.node
      */
-    void initialize_free_list(uint32_t page_frame_count);
+    void splice_free_frames(const FrameRun &run);
 };
 
 
@@ -0,0 +1,347 @@
+//
+// Pager - demand paging with page replacement and a swap file
+//
+
+#include "Pager.h"
+#include <algorithm>
+
+Pager::Pager(mem::MMU *memory_, MemoryAllocator *allocator_,
+             const std::string &swap_file_name,
+             ReplacementPolicy policy_, uint32_t max_frames_,
+             uint32_t swap_workers, bool durable_swap)
+: memory(memory_),
+  allocator(allocator_),
+  swap(swap_file_name, page_frame_size, swap_workers, 256, durable_swap),
+  policy(policy_),
+  max_frames(max_frames_),
+  frames(memory_->get_frame_count()),
+  owned_count(0),
+  resident_count(0),
+  load_sequence(0),
+  tick(0),
+  clock_hand(0),
+  page_buffer(page_frame_size) {
+}
+
+void Pager::MapPages(uint32_t page_table_base, uint32_t vaddr, uint32_t count,
+                     bool writable) {
+    check_range(vaddr, count);
+    if(std::find(page_tables.begin(), page_tables.end(), page_table_base) == page_tables.end()){
+        page_tables.push_back(page_table_base);
+    }
+    uint32_t mapped = mem::kPTE_PresentMask | mem::kPTE_DemandZeroMask
+                      | pte_zero_fill | pte_swapped;
+    for(uint32_t i = 0; i < count; i++){
+        uint32_t page = vaddr + i * page_frame_size;
+        if((read_pte(page_table_base, page) & mapped) == 0){
+            store_pte(page_table_base, page,
+                      pte_zero_fill | (writable ? mem::kPTE_WritableMask : 0));
+        }
+    }
+}
+
+void Pager::UnmapPages(uint32_t page_table_base, uint32_t vaddr, uint32_t count) {
+    check_range(vaddr, count);
+    for(uint32_t i = 0; i < count; i++){
+        uint32_t page = vaddr + i * page_frame_size;
+        uint32_t pt_entry = read_pte(page_table_base, page);
+        if((pt_entry & mem::kPTE_PresentMask) != 0){
+            uint32_t frame = (pt_entry & mem::kPTE_FrameMask) / page_frame_size;
+            ResidentPage &resident = frames.at(frame);
+            if(!resident.resident || resident.page_table_base != page_table_base
+               || resident.vaddr != page){
+                continue;  // not a pageable page
+            }
+            memory->ReleasePages(page_table_base, page, 1);
+            release(frame);
+        } else if((pt_entry & pte_swapped) != 0){
+            swap.FreeSlot(pt_entry / page_frame_size);
+        } else if((pt_entry & pte_zero_fill) == 0){
+            continue;
+        }
+        store_pte(page_table_base, page, 0);
+    }
+    memory->FlushTLB();
+}
+
+void Pager::ForkPageTable(uint32_t parent_page_table, uint32_t child_page_table) {
+    memory->ForkPageTable(parent_page_table, child_page_table);
+    if(std::find(page_tables.begin(), page_tables.end(), parent_page_table) == page_tables.end()){
+        return;
+    }
+    if(std::find(page_tables.begin(), page_tables.end(), child_page_table) == page_tables.end()){
+        page_tables.push_back(child_page_table);
+    }
+    for(uint32_t i = 0; i < mem::kPageTableEntries; i++){
+        uint32_t page = i * page_frame_size;
+        uint32_t pt_entry = read_pte(child_page_table, page);
+        if((pt_entry & mem::kPTE_PresentMask) != 0){
+            uint32_t frame = (pt_entry & mem::kPTE_FrameMask) / page_frame_size;
+            const ResidentPage &resident = frames.at(frame);
+            if(!resident.resident || resident.page_table_base != parent_page_table
+               || resident.vaddr != page){
+                continue;  // not a pageable page
+            }
+            memory->get_physical_memory().get_bytes(page_buffer.data(),
+                                                    frame * page_frame_size, page_frame_size);
+            //the child no longer shares the frame, so the parent's page
+            //need not be copy-on-write
+            memory->ReleasePages(child_page_table, page, 1);
+            if((pt_entry & mem::kPTE_CopyOnWriteMask) != 0){
+                store_pte(parent_page_table, page,
+                          (pt_entry & ~mem::kPTE_CopyOnWriteMask) | mem::kPTE_WritableMask);
+            }
+        } else if((pt_entry & pte_swapped) != 0){
+            swap.ReadSlot(pt_entry / page_frame_size, page_buffer.data());
+            pager_stats.bytes_read += page_frame_size;
+        } else {
+            continue;  // zero fill and unmapped entries are copied as they are
+        }
+        uint32_t slot = allocate_slot();
+        swap.WriteSlot(slot, page_buffer.data());
+        pager_stats.swap_outs++;
+        pager_stats.bytes_written += page_frame_size;
+        bool writable = (pt_entry & (mem::kPTE_WritableMask | mem::kPTE_CopyOnWriteMask)) != 0;
+        store_pte(child_page_table, page, pte_swapped | slot * page_frame_size
+                  | (writable ? mem::kPTE_WritableMask : 0));
+    }
+    memory->FlushTLB();
+}
+
+void Pager::RemovePageTable(uint32_t page_table_base) {
+    auto it = std::find(page_tables.begin(), page_tables.end(), page_table_base);
+    if(it != page_tables.end()){
+        UnmapPages(page_table_base, 0, mem::kPageTableEntries);
+        page_tables.erase(it);
+    }
+    memory->ReleasePageTable(page_table_base);
+}
+
+void Pager::Sample() {
+    if(policy == ReplacementPolicy::kLRU || policy == ReplacementPolicy::kAging){
+        update_references(true);
+    } else {
+        //clock and FIFO use no history; the clock reads the accessed bits
+        //when it looks for a victim
+        tick++;
+    }
+}
+
+bool Pager::Run(const mem::PMCB &pmcb) {
+    uint32_t page = pmcb.next_vaddress & ~(page_frame_size - 1);
+    uint32_t pt_entry = read_pte(pmcb.page_table_base, page);
+    if((pt_entry & (pte_zero_fill | pte_swapped)) == 0){
+        return false;
+    }
+    pager_stats.faults++;
+
+    uint32_t frame;
+    if(!get_frame(frame)){
+        throw std::runtime_error("No frame available for page\n");
+    }
+    ResidentPage &resident = frames[frame / page_frame_size];
+    if((pt_entry & pte_swapped) != 0){
+        resident.swap_slot = pt_entry / page_frame_size;
+        swap.ReadSlot(resident.swap_slot, page_buffer.data());
+        memory->get_physical_memory().put_bytes(frame, page_frame_size, page_buffer.data());
+        memory->MarkDirty(frame);
+        pager_stats.swap_ins++;
+        pager_stats.bytes_read += page_frame_size;
+    } else {
+        resident.swap_slot = no_slot;
+        memory->get_physical_memory().ZeroFrame(frame);
+        memory->MarkDirty(frame);
+        pager_stats.zero_fills++;
+    }
+    resident.resident = true;
+    resident.page_table_base = pmcb.page_table_base;
+    resident.vaddr = page;
+    resident.load_sequence = ++load_sequence;
+    resident.last_use = tick;
+    resident.age = 0x80;
+    resident_count++;
+    if(policy == ReplacementPolicy::kFIFO){
+        fifo.push_back(std::make_pair(frame / page_frame_size, load_sequence));
+    }
+    store_pte(pmcb.page_table_base, page,
+              frame | mem::kPTE_PresentMask | (pt_entry & mem::kPTE_WritableMask));
+    return true;
+}
+
+uint32_t Pager::read_pte(uint32_t page_table_base, uint32_t vaddr) const {
+    uint32_t v32;
+    memory->get_physical_memory().get_32(&v32, page_table_base
+        + (vaddr / page_frame_size) * sizeof(mem::PageTableEntry));
+    return v32;
+}
+
+void Pager::store_pte(uint32_t page_table_base, uint32_t vaddr, uint32_t pt_entry) {
+    memory->get_physical_memory().put_32(page_table_base
+        + (vaddr / page_frame_size) * sizeof(mem::PageTableEntry), pt_entry);
+    memory->MarkDirty(page_table_base);
+}
+
+void Pager::check_range(uint32_t vaddr, uint32_t count) const {
+    if(vaddr % page_frame_size != 0
+       || uint64_t(vaddr) + uint64_t(count) * page_frame_size > mem::kVirtAddrSpaceSize){
+        throw std::runtime_error("Invalid pageable range\n");
+    }
+}
+
+bool Pager::get_frame(uint32_t &frame) {
+    if(max_frames == 0 || owned_count < max_frames){
+        std::vector<uint32_t> frame_list;
+        if(allocator->AllocatePageFrames(1, frame_list)){
+            owned_count++;
+            frame = frame_list[0];
+            return true;
+        }
+    }
+    if(resident_count == 0){
+        return false;
+    }
+    uint32_t victim = select_victim();
+    evict(victim);
+    frame = victim * page_frame_size;
+    return true;
+}
+
+uint32_t Pager::select_victim() {
+    uint32_t frame_count = frames.size();
+    switch(policy){
+    case ReplacementPolicy::kFIFO:
+        while(true){
+            std::pair<uint32_t, uint64_t> oldest = fifo.front();
+            fifo.pop_front();
+            //skip pages removed since they were loaded
+            if(frames[oldest.first].resident
+               && frames[oldest.first].load_sequence == oldest.second){
+                return oldest.first;
+            }
+        }
+    case ReplacementPolicy::kClock:
+        while(true){
+            clock_hand = (clock_hand + 1) % frame_count;
+            ResidentPage &resident = frames[clock_hand];
+            if(!resident.resident){
+                continue;
+            }
+            uint32_t pt_entry = read_pte(resident.page_table_base, resident.vaddr);
+            if((pt_entry & mem::kPTE_AccessedMask) == 0){
+                return clock_hand;
+            }
+            //second chance; the TLB is flushed by evict
+            store_pte(resident.page_table_base, resident.vaddr,
+                      pt_entry & ~mem::kPTE_AccessedMask);
+        }
+    default:
+        break;
+    }
+
+    //LRU and aging: the oldest of the least recently used pages
+    update_references(false);
+    uint32_t victim = 0;
+    bool found = false;
+    for(uint32_t i = 0; i < frame_count; i++){
+        const ResidentPage &resident = frames[i];
+        if(!resident.resident){
+            continue;
+        }
+        const ResidentPage &best = frames[victim];
+        bool better;
+        if(policy == ReplacementPolicy::kLRU){
+            better = resident.last_use < best.last_use
+                     || (resident.last_use == best.last_use
+                         && resident.load_sequence < best.load_sequence);
+        } else {
+            better = resident.age < best.age
+                     || (resident.age == best.age
+                         && resident.load_sequence < best.load_sequence);
+        }
+        if(!found || better){
+            victim = i;
+            found = true;
+        }
+    }
+    return victim;
+}
+
+void Pager::evict(uint32_t frame) {
+    ResidentPage &resident = frames[frame];
+    uint32_t pt_entry = read_pte(resident.page_table_base, resident.vaddr);
+    uint32_t swapped_entry = pt_entry & mem::kPTE_WritableMask;
+    if((pt_entry & mem::kPTE_ModifiedMask) != 0){
+        if(resident.swap_slot == no_slot){
+            resident.swap_slot = allocate_slot();
+        }
+        memory->get_physical_memory().get_bytes(page_buffer.data(),
+                                                frame * page_frame_size, page_frame_size);
+        swap.WriteSlot(resident.swap_slot, page_buffer.data());
+        pager_stats.swap_outs++;
+        pager_stats.bytes_written += page_frame_size;
+    }
+    if(resident.swap_slot != no_slot){
+        //the swap copy is current
+        swapped_entry |= pte_swapped | resident.swap_slot * page_frame_size;
+    } else {
+        //never modified since it was zero filled
+        swapped_entry |= pte_zero_fill;
+    }
+    memory->ReleasePages(resident.page_table_base, resident.vaddr, 1);
+    store_pte(resident.page_table_base, resident.vaddr, swapped_entry);
+    resident.resident = false;
+    resident_count--;
+    pager_stats.evictions++;
+    memory->FlushTLB();
+}
+
+uint32_t Pager::allocate_slot() {
+    uint32_t slot = swap.AllocateSlot();
+    if(slot >= mem::kPTE_FrameMask / page_frame_size){
+        swap.FreeSlot(slot);
+        throw std::runtime_error("Swap file full\n");
+    }
+    return slot;
+}
+
+void Pager::release(uint32_t frame) {
+    ResidentPage &resident = frames[frame];
+    if(resident.swap_slot != no_slot){
+        swap.FreeSlot(resident.swap_slot);
+    }
+    resident.resident = false;
+    resident_count--;
+    std::vector<uint32_t> frame_list(1, frame * page_frame_size);
+    allocator->FreePageFrames(1, frame_list);
+    owned_count--;
+}
+
+void Pager::update_references(bool advance) {
+    if(advance){
+        tick++;
+        if(policy == ReplacementPolicy::kAging){
+            for(ResidentPage &resident : frames){
+                resident.age >>= 1;
+            }
+        }
+    }
+    mem::PageTable entries;
+    for(uint32_t page_table_base : page_tables){
+        if(memory->HarvestAccessedBits(page_table_base, entries) == 0){
+            continue;
+        }
+        for(uint32_t i = 0; i < mem::kPageTableEntries; i++){
+            uint32_t pt_entry = entries[i];
+            if((pt_entry & mem::kPTE_PresentMask) == 0
+               || (pt_entry & mem::kPTE_AccessedMask) == 0){
+                continue;
+            }
+            ResidentPage &resident = frames.at((pt_entry & mem::kPTE_FrameMask) / page_frame_size);
+            if(resident.resident && resident.page_table_base == page_table_base
+               && resident.vaddr == i * page_frame_size){
+                resident.last_use = tick;
+                resident.age |= 0x80;
+            }
+        }
+    }
+}
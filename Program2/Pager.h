@@ -0,0 +1,261 @@
+//
+// Pager - demand paging with page replacement and a swap file
+//
+
+#ifndef LAB03_PAGER_H
+#define LAB03_PAGER_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+#include <MMU.h>
+
+#include "MemoryAllocator.h"
+#include "SwapFile.h"
+
+/**
+ * Pager - page fault handler for pageable regions. Pages mapped with
+ * MapPages get a frame on first use. When no frame is available (the
+ * MemoryAllocator is exhausted, or the pager's frame limit is reached), a
+ * resident page is chosen by the replacement policy and evicted: if it was
+ * modified (kPTE_ModifiedMask) it is written to the swap file, then its
+ * present bit is cleared. A later access faults and the page is read back.
+ *
+ * A page which is not present keeps its writable bit, and uses bits the
+ * MMU does not interpret:
+ *   pte_zero_fill - the page has no contents yet; it is zeroed on use
+ *   pte_swapped   - the page is in the swap file, at the slot stored in
+ *                   the frame number field
+ *
+ * Replacement policies:
+ *   kClock - second chance, using the accessed bit (kPTE_AccessedMask)
+ *   kLRU   - least recently used, at the resolution of Sample calls
+ *   kFIFO  - oldest loaded page
+ *   kAging - 8 bit aging counters shifted at each Sample call
+ * The LRU and aging policies see the accessed bits gathered by Sample,
+ * which should be called periodically (a clock tick), and at each eviction.
+ *
+ * With swap workers, a modified page being evicted is copied and written
+ * in the background, so the fault which evicted it goes on at once; a page
+ * faulted back in before its write finishes is copied from the pending
+ * write (see SwapFile).
+ *
+ * Each frame and swap slot belongs to one page of one page table. Page
+ * tables with pageable pages must be forked with ForkPageTable, which gives
+ * the child its own swap copy of each pageable page, rather than with
+ * MMU::ForkPageTable.
+ */
+class Pager : public mem::MMU::FaultHandler {
+public:
+    enum class ReplacementPolicy { kClock, kLRU, kFIFO, kAging };
+
+    /**
+     * PagerStats - paging activity
+     */
+    class PagerStats {
+    public:
+        PagerStats() : faults(0), zero_fills(0), swap_ins(0), swap_outs(0),
+            evictions(0), bytes_read(0), bytes_written(0) {}
+
+        uint64_t faults;         // page faults handled
+        uint64_t zero_fills;     // faults satisfied with a zeroed frame
+        uint64_t swap_ins;       // pages read from the swap file
+        uint64_t swap_outs;      // pages written to the swap file
+        uint64_t evictions;      // pages removed from memory
+        uint64_t bytes_read;     // swap file bytes read
+        uint64_t bytes_written;  // swap file bytes written
+    };
+
+    /**
+     *
+     * @param memory_ MMU whose page faults are handled; install the pager
+     *        with memory_->SetPageFaultHandler
+     * @param allocator_ source of frames
+     * @param swap_file_name host file for swapped pages (truncated)
+     * @param policy_ replacement policy
+     * @param max_frames_ most frames the pager holds at once, 0 for no
+     *        limit other than the allocator's free frames
+     * @param swap_workers background threads writing evicted pages to the
+     *        swap file, 0 to write them before the fault returns
+     * @param durable_swap true if swap writes must reach the device before
+     *        they complete (see SwapFile)
+     */
+    Pager(mem::MMU *memory_, MemoryAllocator *allocator_,
+          const std::string &swap_file_name,
+          ReplacementPolicy policy_ = ReplacementPolicy::kClock,
+          uint32_t max_frames_ = 0, uint32_t swap_workers = 0,
+          bool durable_swap = false);
+    ~Pager(){};
+    Pager(Pager& orig) = delete;
+    Pager(Pager&& orig)= delete;
+    Pager& operator=(Pager& right) = delete;
+    Pager& operator=(Pager&& right)=delete;
+
+    /**
+     * makes pages of a page table pageable. The pages are not present until
+     * first used. Pages which are already mapped are not changed.
+     *
+     * @param page_table_base physical address of page table
+     * @param vaddr first virtual address (a multiple of the page size)
+     * @param count number of pages
+     * @param writable true if the pages are writable
+     * @throws std::runtime_error if the range is invalid
+     */
+    void MapPages(uint32_t page_table_base, uint32_t vaddr, uint32_t count,
+                  bool writable);
+
+    /**
+     * removes pageable pages, freeing their frames and swap slots
+     *
+     * @param page_table_base physical address of page table
+     * @param vaddr first virtual address (a multiple of the page size)
+     * @param count number of pages
+     * @throws std::runtime_error if the range is invalid
+     */
+    void UnmapPages(uint32_t page_table_base, uint32_t vaddr, uint32_t count);
+
+    /**
+     * duplicates a page table with MMU::ForkPageTable. If the parent has
+     * pageable pages, each of the child's is given its own swap slot holding
+     * a copy of the page (zero fill pages stay zero fill), so no frame or
+     * slot is shared; the parent's resident pages keep their frames and
+     * stay writable.
+     *
+     * @param parent_page_table physical address of page table to duplicate
+     * @param child_page_table physical address of frame for the new page table
+     * @throws std::runtime_error if the swap file is full
+     */
+    void ForkPageTable(uint32_t parent_page_table, uint32_t child_page_table);
+
+    /**
+     * removes all pageable pages of a page table which is being discarded,
+     * and releases the frames it shares through MMU::ForkPageTable
+     *
+     * @param page_table_base physical address of page table
+     */
+    void RemovePageTable(uint32_t page_table_base);
+
+    /**
+     * gathers and clears the accessed bits of the pageable page tables,
+     * advancing the clock of the LRU and aging policies
+     */
+    void Sample();
+
+    /**
+     * page fault handler called by the MMU
+     *
+     * @param pmcb PMCB of the faulting access
+     * @return true if the page was made present, false if it is not a
+     *         pageable page
+     */
+    virtual bool Run(const mem::PMCB &pmcb);
+
+    /**
+     *
+     * @return number of pages in memory
+     */
+    uint32_t get_resident_count() const { return resident_count; }
+
+    /**
+     *
+     * @return number of pages with a copy in the swap file
+     */
+    uint32_t get_swapped_count() const { return swap.get_slots_used(); }
+
+    /**
+     *
+     * @param stats set to the paging activity so far
+     */
+    void get_stats(PagerStats &stats) const { stats = pager_stats; }
+
+    /**
+     *
+     * @param stats set to the swap file activity so far
+     */
+    void get_swap_stats(SwapFile::SwapStats &stats) { swap.get_stats(stats); }
+
+private:
+    mem::MMU *memory;
+    MemoryAllocator *allocator;
+    SwapFile swap;
+    ReplacementPolicy policy;
+    uint32_t max_frames;
+
+    static const uint32_t page_frame_size = 0x2000;
+    static const uint32_t no_slot = 0xffffffff;
+    static const uint32_t pte_zero_fill = 1 << 0;
+    static const uint32_t pte_swapped = 1 << 1;
+
+    /**
+     * ResidentPage - the page held in a frame, indexed by frame number
+     */
+    class ResidentPage {
+    public:
+        ResidentPage() : resident(false), page_table_base(0), vaddr(0),
+            swap_slot(no_slot), load_sequence(0), last_use(0), age(0) {}
+
+        bool resident;
+        uint32_t page_table_base;
+        uint32_t vaddr;
+        uint32_t swap_slot;       // slot holding a copy of the page, if any
+        uint64_t load_sequence;   // FIFO order
+        uint64_t last_use;        // Sample tick of last access (LRU)
+        uint8_t age;              // aging counter
+    };
+    std::vector<ResidentPage> frames;
+    uint32_t owned_count;                // frames from the allocator
+    uint32_t resident_count;
+
+    std::vector<uint32_t> page_tables;   // page tables with pageable pages
+    std::deque<std::pair<uint32_t, uint64_t>> fifo;  // frame, load_sequence
+    uint64_t load_sequence;
+    uint64_t tick;
+    uint32_t clock_hand;
+    std::vector<uint8_t> page_buffer;
+    PagerStats pager_stats;
+
+    uint32_t read_pte(uint32_t page_table_base, uint32_t vaddr) const;
+    void store_pte(uint32_t page_table_base, uint32_t vaddr, uint32_t pt_entry);
+    void check_range(uint32_t vaddr, uint32_t count) const;
+
+    /**
+     * gets a frame from the allocator, or by evicting a page
+     *
+     * @return true if a frame was found
+     */
+    bool get_frame(uint32_t &frame);
+
+    /**
+     * @return frame of the page chosen by the replacement policy
+     */
+    uint32_t select_victim();
+
+    /**
+     * writes a page to swap if needed and marks it not present
+     */
+    void evict(uint32_t frame);
+
+    /**
+     * @return a free swap slot whose number fits in a page table entry
+     * @throws std::runtime_error if the swap file is full
+     */
+    uint32_t allocate_slot();
+
+    /**
+     * removes a resident page and returns its frame to the allocator
+     */
+    void release(uint32_t frame);
+
+    /**
+     * folds the accessed bits into the LRU times and aging counters
+     *
+     * @param advance true to advance the clock (shift the aging counters)
+     */
+    void update_references(bool advance);
+};
+
+
+#endif //LAB03_PAGER_H
@@ -244,15 +244,19 @@ void Process::CmdDmp(const string &line,
 void Process::CmdCwp(const string &line,
                     const string &cmd,
                     const vector<uint32_t> &cmdArgs) {
-    mem::Addr vaddress = cmdArgs.at(0);
-    uint32_t pages = cmdArgs.at(1);
-    uint32_t status = cmdArgs.at(2);
-    
-    for(int i = vaddress; i < vaddress + pages; i++) {
-        if(status == 0){
-            //clear writable bit to 0
-        } else {
-            //set writable bit to 1 
-        }
-    }
+  if (cmdArgs.size() != 3) {
+    cerr << "ERROR: badly formatted cwp command\n";
+    exit(2);
+  }
+  // Change write permission of pages starting at specified address
+  mem::Addr vaddress = cmdArgs.at(0);
+  uint32_t pages = cmdArgs.at(1);
+  uint32_t status = cmdArgs.at(2);
+  try {
+    memory->Protect(vaddress, pages, status != 0);
+  } catch (mem::MemorySubsystemException &e) {
+    cerr << "ERROR: cwp failed at line " << std::dec << line_number 
+         << ": " << e.what() << "\n";
+    exit(2);
+  }
 }
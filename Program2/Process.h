@@ -56,6 +56,12 @@
  * 0fa700: 00 12 f3 aa 00 00 00 a0 ff 0f e7 37 21 08 6e 00
  * 0fa710: 55 05 9a 9b 9c ba fa f0
  * 
+ * Change Write Permission
+ * vaddr cwp count status
+ * Make count pages starting at vaddr (a multiple of the page size) writable 
+ * if status is non-zero, or read-only if status is 0. Only pages which are 
+ * mapped are changed. Requires the MMU to be in virtual mode.
+ * 
  * Comment
  * # comment text
  * The # character in the first column means the remainder of the line should be 
@@ -0,0 +1,590 @@
+//
+// ReplacementSim - offline comparison of page replacement policies
+//
+
+#include "ReplacementSim.h"
+
+#include <atomic>
+#include <list>
+#include <queue>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <tuple>
+
+namespace {
+
+const uint32_t page_frame_size = 0x2000;
+const uint32_t not_resident = 0xffffffff;
+const uint32_t never = 0xffffffff;
+
+/**
+ * Model - state of one policy; Reference returns true on a page fault
+ */
+class Model {
+public:
+    virtual ~Model() {}
+    virtual bool Reference(uint32_t page, bool write, uint32_t time) = 0;
+};
+
+class FIFOModel : public Model {
+public:
+    FIFOModel(uint32_t frames_, uint32_t pages)
+    : frames(frames_), resident(pages, false) {}
+    virtual bool Reference(uint32_t page, bool, uint32_t) {
+        if(resident[page]){
+            return false;
+        }
+        if(queue.size() == frames){
+            resident[queue.front()] = false;
+            queue.pop();
+        }
+        queue.push(page);
+        resident[page] = true;
+        return true;
+    }
+private:
+    uint32_t frames;
+    std::vector<bool> resident;
+    std::queue<uint32_t> queue;
+};
+
+/**
+ * LRUModel - doubly linked recency list through arrays indexed by page
+ */
+class LRUModel : public Model {
+public:
+    LRUModel(uint32_t frames_, uint32_t pages)
+    : frames(frames_), count(0), next(pages, not_resident),
+      prev(pages, not_resident), resident(pages, false),
+      head(not_resident), tail(not_resident) {}
+    virtual bool Reference(uint32_t page, bool, uint32_t) {
+        bool fault = !resident[page];
+        if(fault){
+            if(count == frames){
+                uint32_t victim = tail;
+                unlink(victim);
+                resident[victim] = false;
+                count--;
+            }
+            resident[page] = true;
+            count++;
+        } else {
+            unlink(page);
+        }
+        //most recent at head
+        prev[page] = not_resident;
+        next[page] = head;
+        if(head != not_resident){
+            prev[head] = page;
+        } else {
+            tail = page;
+        }
+        head = page;
+        return fault;
+    }
+private:
+    uint32_t frames;
+    uint32_t count;
+    std::vector<uint32_t> next;
+    std::vector<uint32_t> prev;
+    std::vector<bool> resident;
+    uint32_t head;
+    uint32_t tail;
+
+    void unlink(uint32_t page) {
+        if(prev[page] != not_resident) next[prev[page]] = next[page];
+        else head = next[page];
+        if(next[page] != not_resident) prev[next[page]] = prev[page];
+        else tail = prev[page];
+    }
+};
+
+class ClockModel : public Model {
+public:
+    ClockModel(uint32_t frames_, uint32_t pages)
+    : frames(frames_), frame_of(pages, not_resident), hand(0) {}
+    virtual bool Reference(uint32_t page, bool, uint32_t) {
+        if(frame_of[page] != not_resident){
+            referenced[frame_of[page]] = true;
+            return false;
+        }
+        uint32_t frame;
+        if(pages.size() < frames){
+            frame = pages.size();
+            pages.push_back(page);
+            referenced.push_back(true);
+        } else {
+            while(referenced[hand]){
+                referenced[hand] = false;
+                hand = (hand + 1) % frames;
+            }
+            frame = hand;
+            hand = (hand + 1) % frames;
+            frame_of[pages[frame]] = not_resident;
+            pages[frame] = page;
+            referenced[frame] = true;
+        }
+        frame_of[page] = frame;
+        return true;
+    }
+private:
+    uint32_t frames;
+    std::vector<uint32_t> frame_of;
+    std::vector<uint32_t> pages;
+    std::vector<bool> referenced;
+    uint32_t hand;
+};
+
+/**
+ * WSClockModel - clock over frames; a page not referenced within the
+ * window is replaced if clean, or cleaned (an assumed immediate write
+ * back) and skipped if modified. If a full sweep finds no victim, the
+ * least recently used page is replaced.
+ */
+class WSClockModel : public Model {
+public:
+    WSClockModel(uint32_t frames_, uint32_t pages, uint32_t window_)
+    : frames(frames_), window(window_), frame_of(pages, not_resident), hand(0) {}
+    virtual bool Reference(uint32_t page, bool write, uint32_t time) {
+        if(frame_of[page] != not_resident){
+            Frame &frame = table[frame_of[page]];
+            frame.referenced = true;
+            frame.modified |= write;
+            return false;
+        }
+        uint32_t victim;
+        if(table.size() < frames){
+            victim = table.size();
+            table.push_back(Frame());
+        } else {
+            victim = not_resident;
+            for(uint32_t step = 0; step < frames && victim == not_resident; step++){
+                Frame &frame = table[hand];
+                if(frame.referenced){
+                    frame.referenced = false;
+                    frame.last_use = time;
+                } else if(time - frame.last_use > window){
+                    if(frame.modified){
+                        frame.modified = false;  // write back
+                    } else {
+                        victim = hand;
+                    }
+                }
+                hand = (hand + 1) % frames;
+            }
+            if(victim == not_resident){
+                victim = 0;
+                for(uint32_t i = 1; i < frames; i++){
+                    if(table[i].last_use < table[victim].last_use){
+                        victim = i;
+                    }
+                }
+            }
+            frame_of[table[victim].page] = not_resident;
+        }
+        Frame &frame = table[victim];
+        frame.page = page;
+        frame.referenced = true;
+        frame.modified = write;
+        frame.last_use = time;
+        frame_of[page] = victim;
+        return true;
+    }
+private:
+    class Frame {
+    public:
+        uint32_t page;
+        uint32_t last_use;
+        bool referenced;
+        bool modified;
+    };
+    uint32_t frames;
+    uint32_t window;
+    std::vector<uint32_t> frame_of;
+    std::vector<Frame> table;
+    uint32_t hand;
+};
+
+/**
+ * AgingModel - every interval references each counter is shifted right
+ * and the reference bit moved into its top bit; the victim has the
+ * smallest counter, with its reference bit as the lowest order tie break
+ */
+class AgingModel : public Model {
+public:
+    AgingModel(uint32_t frames_, uint32_t pages, uint32_t interval_)
+    : frames(frames_), interval(interval_), frame_of(pages, not_resident) {}
+    virtual bool Reference(uint32_t page, bool, uint32_t time) {
+        if(time % interval == 0){
+            for(uint32_t i = 0; i < table.size(); i++){
+                age[i] = (age[i] >> 1) | (referenced[i] << 7);
+                referenced[i] = 0;
+            }
+        }
+        if(frame_of[page] != not_resident){
+            referenced[frame_of[page]] = 1;
+            return false;
+        }
+        uint32_t victim;
+        if(table.size() < frames){
+            victim = table.size();
+            table.push_back(page);
+            age.push_back(0);
+            referenced.push_back(0);
+        } else {
+            victim = 0;
+            for(uint32_t i = 1; i < frames; i++){
+                if((age[i] << 1 | referenced[i]) < (age[victim] << 1 | referenced[victim])){
+                    victim = i;
+                }
+            }
+            frame_of[table[victim]] = not_resident;
+            table[victim] = page;
+        }
+        age[victim] = 0;
+        referenced[victim] = 1;
+        frame_of[page] = victim;
+        return true;
+    }
+private:
+    uint32_t frames;
+    uint32_t interval;
+    std::vector<uint32_t> frame_of;
+    std::vector<uint32_t> table;
+    std::vector<uint8_t> age;
+    std::vector<uint8_t> referenced;
+};
+
+/**
+ * LFUModel - resident pages ordered by (use count, last use)
+ */
+class LFUModel : public Model {
+public:
+    LFUModel(uint32_t frames_, uint32_t pages)
+    : frames(frames_), uses(pages, 0), last_use(pages, 0), resident(pages, false) {}
+    virtual bool Reference(uint32_t page, bool, uint32_t time) {
+        bool fault = !resident[page];
+        if(fault){
+            if(order.size() == frames){
+                uint32_t victim = std::get<2>(*order.begin());
+                order.erase(order.begin());
+                resident[victim] = false;
+            }
+            resident[page] = true;
+            uses[page] = 0;
+        } else {
+            order.erase(std::make_tuple(uses[page], last_use[page], page));
+        }
+        uses[page]++;
+        last_use[page] = time;
+        order.insert(std::make_tuple(uses[page], last_use[page], page));
+        return fault;
+    }
+private:
+    uint32_t frames;
+    std::vector<uint32_t> uses;
+    std::vector<uint32_t> last_use;
+    std::vector<bool> resident;
+    std::set<std::tuple<uint32_t, uint32_t, uint32_t>> order;
+};
+
+/**
+ * ARCModel - T1/T2 hold resident pages seen once/more than once, B1/B2
+ * the ghost entries of pages evicted from them; p is the target size of T1
+ */
+class ARCModel : public Model {
+public:
+    ARCModel(uint32_t frames, uint32_t pages)
+    : c(frames), p(0), where(pages, kNone), position(pages) {}
+    virtual bool Reference(uint32_t page, bool, uint32_t) {
+        switch(where[page]){
+        case kT1:
+        case kT2:
+            move_to(page, kT2);
+            return false;
+        case kB1:
+            p = std::min<double>(c, p + std::max<double>(double(lists[kB2].size()) / lists[kB1].size(), 1));
+            replace(false);
+            move_to(page, kT2);
+            return true;
+        case kB2:
+            p = std::max<double>(0, p - std::max<double>(double(lists[kB1].size()) / lists[kB2].size(), 1));
+            replace(true);
+            move_to(page, kT2);
+            return true;
+        default:
+            break;
+        }
+        size_t l1 = lists[kT1].size() + lists[kB1].size();
+        size_t total = l1 + lists[kT2].size() + lists[kB2].size();
+        if(l1 == c){
+            if(lists[kT1].size() < c){
+                drop_lru(kB1);
+                replace(false);
+            } else {
+                drop_lru(kT1);
+            }
+        } else if(total >= c){
+            if(total == 2 * c){
+                drop_lru(kB2);
+            }
+            replace(false);
+        }
+        move_to(page, kT1);
+        return true;
+    }
+private:
+    enum { kT1, kT2, kB1, kB2, kNone };
+    uint32_t c;
+    double p;
+    std::list<uint32_t> lists[4];  // most recent at front
+    std::vector<uint8_t> where;
+    std::vector<std::list<uint32_t>::iterator> position;
+
+    void move_to(uint32_t page, uint8_t list) {
+        if(where[page] != kNone){
+            lists[where[page]].erase(position[page]);
+        }
+        lists[list].push_front(page);
+        position[page] = lists[list].begin();
+        where[page] = list;
+    }
+    void drop_lru(uint8_t list) {
+        uint32_t page = lists[list].back();
+        lists[list].pop_back();
+        where[page] = kNone;
+    }
+    void replace(bool in_b2) {
+        size_t t1 = lists[kT1].size();
+        if(t1 > 0 && ((in_b2 && t1 == p) || t1 > p)){
+            move_to(lists[kT1].back(), kB1);
+        } else {
+            move_to(lists[kT2].back(), kB2);
+        }
+    }
+};
+
+/**
+ * OPTModel - resident pages in a max heap by next use; entries made stale
+ * by a later reference are skipped when popped
+ */
+class OPTModel : public Model {
+public:
+    OPTModel(uint32_t frames_, uint32_t pages, const std::vector<uint32_t> &next_use_)
+    : frames(frames_), count(0), next_use(next_use_), current(pages, not_resident) {}
+    virtual bool Reference(uint32_t page, bool, uint32_t time) {
+        bool fault = current[page] == not_resident;
+        if(fault){
+            if(count == frames){
+                while(true){
+                    std::pair<uint32_t, uint32_t> top = heap.top();
+                    heap.pop();
+                    if(current[top.second] == top.first){
+                        current[top.second] = not_resident;
+                        break;
+                    }
+                }
+            } else {
+                count++;
+            }
+        }
+        current[page] = next_use[time];
+        heap.push(std::make_pair(next_use[time], page));
+        return fault;
+    }
+private:
+    uint32_t frames;
+    uint32_t count;
+    const std::vector<uint32_t> &next_use;
+    std::vector<uint32_t> current;  // next use of each resident page
+    std::priority_queue<std::pair<uint32_t, uint32_t>> heap;
+};
+
+}  // namespace
+
+std::vector<ReplacementSim::Policy> ReplacementSim::get_all_policies() {
+    return { Policy::kFIFO, Policy::kLRU, Policy::kClock, Policy::kWSClock,
+             Policy::kAging, Policy::kLFU, Policy::kARC, Policy::kOPT };
+}
+
+const char *ReplacementSim::get_policy_name(Policy policy) {
+    switch(policy){
+    case Policy::kFIFO: return "FIFO";
+    case Policy::kLRU: return "LRU";
+    case Policy::kClock: return "CLOCK";
+    case Policy::kWSClock: return "WSClock";
+    case Policy::kAging: return "Aging";
+    case Policy::kLFU: return "LFU";
+    case Policy::kARC: return "ARC";
+    case Policy::kOPT: return "OPT";
+    }
+    return "?";
+}
+
+ReplacementSim::ReplacementSim()
+: aging_interval(100),
+  wsclock_window(0) {
+}
+
+void ReplacementSim::AddTrace(std::istream &trace) {
+    std::string line;
+    long line_number = 0;
+    while(std::getline(trace, line)){
+        ++line_number;
+        if(line.size() == 0 || line[0] == '#'){
+            continue;
+        }
+        std::istringstream line_stream(line);
+        uint32_t addr;
+        std::string cmd;
+        if(!(line_stream >> std::hex >> addr)){
+            if(line_stream.eof()){
+                continue;  // blank line
+            }
+            throw std::runtime_error("Badly formed address at trace line "
+                                     + std::to_string(line_number) + "\n");
+        }
+        if(!(line_stream >> cmd)){
+            throw std::runtime_error("Missing command at trace line "
+                                     + std::to_string(line_number) + "\n");
+        }
+        std::vector<uint32_t> args;
+        uint32_t arg;
+        while(line_stream >> std::hex >> arg){
+            args.push_back(arg);
+        }
+        if(cmd == "cmp"){
+            add_range(addr, args.size(), false);
+        } else if(cmd == "sto"){
+            add_range(addr, args.size(), true);
+        } else if(cmd == "dmp" && args.size() >= 1){
+            add_range(addr, args[0], false);
+        } else if(cmd == "rep" && args.size() >= 1){
+            add_range(addr, args[0], true);
+        } else if(cmd == "cpy" && args.size() >= 2){
+            add_range(addr, args[0], false);
+            add_range(args[1], args[0], true);
+        }
+        //mem and cwp make no references
+    }
+}
+
+void ReplacementSim::AddReferences(std::istream &stream) {
+    std::string line;
+    long line_number = 0;
+    while(std::getline(stream, line)){
+        ++line_number;
+        std::istringstream line_stream(line);
+        uint32_t vaddr;
+        if(!(line_stream >> std::hex >> vaddr)){
+            if(line_stream.eof()){
+                continue;
+            }
+            throw std::runtime_error("Badly formed reference at line "
+                                     + std::to_string(line_number) + "\n");
+        }
+        std::string kind;
+        line_stream >> kind;
+        AddReference(vaddr, kind == "w");
+    }
+}
+
+void ReplacementSim::AddReference(uint32_t vaddr, bool write) {
+    uint32_t page = vaddr / page_frame_size;
+    auto id = page_ids.insert(std::make_pair(page, uint32_t(page_ids.size()))).first;
+    references.push_back(id->second << 1 | (write ? 1 : 0));
+}
+
+uint64_t ReplacementSim::CountFaults(Policy policy, uint32_t frames) {
+    build_next_use();
+    return simulate(policy, frames);
+}
+
+void ReplacementSim::Sweep(const std::vector<Policy> &policies,
+                           const std::vector<uint32_t> &frame_counts,
+                           uint32_t thread_count,
+                           std::vector<std::vector<uint64_t>> &faults) {
+    build_next_use();
+    faults.assign(policies.size(), std::vector<uint64_t>(frame_counts.size(), 0));
+    if(thread_count == 0){
+        thread_count = std::max<uint32_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    //each run is independent; threads take the next run until none are left
+    size_t run_count = policies.size() * frame_counts.size();
+    std::atomic<size_t> next_run(0);
+    auto worker = [&]() {
+        size_t run;
+        while((run = next_run++) < run_count){
+            size_t frame_index = run / policies.size();
+            size_t policy_index = run % policies.size();
+            faults[policy_index][frame_index] = simulate(policies[policy_index],
+                                                         frame_counts[frame_index]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for(uint32_t i = 1; i < std::min<size_t>(thread_count, run_count); i++){
+        threads.emplace_back(worker);
+    }
+    worker();
+    for(std::thread &t : threads){
+        t.join();
+    }
+}
+
+void ReplacementSim::add_range(uint32_t vaddr, uint32_t count, bool write) {
+    if(count == 0){
+        return;
+    }
+    uint64_t last = uint64_t(vaddr) + count - 1;
+    for(uint64_t page = vaddr / page_frame_size; page <= last / page_frame_size; page++){
+        AddReference(page * page_frame_size, write);
+    }
+}
+
+void ReplacementSim::build_next_use() {
+    if(next_use.size() == references.size()){
+        return;
+    }
+    next_use.assign(references.size(), never);
+    std::vector<uint32_t> seen(page_ids.size(), never);
+    for(size_t i = references.size(); i-- > 0; ){
+        uint32_t page = references[i] >> 1;
+        next_use[i] = seen[page];
+        seen[page] = i;
+    }
+}
+
+uint64_t ReplacementSim::simulate(Policy policy, uint32_t frames) const {
+    if(frames == 0){
+        throw std::runtime_error("Frame count must be at least 1\n");
+    }
+    uint32_t pages = page_ids.size();
+    std::unique_ptr<Model> model;
+    switch(policy){
+    case Policy::kFIFO: model.reset(new FIFOModel(frames, pages)); break;
+    case Policy::kLRU: model.reset(new LRUModel(frames, pages)); break;
+    case Policy::kClock: model.reset(new ClockModel(frames, pages)); break;
+    case Policy::kWSClock:
+        model.reset(new WSClockModel(frames, pages,
+                                     wsclock_window != 0 ? wsclock_window : 4 * frames));
+        break;
+    case Policy::kAging: model.reset(new AgingModel(frames, pages, aging_interval)); break;
+    case Policy::kLFU: model.reset(new LFUModel(frames, pages)); break;
+    case Policy::kARC: model.reset(new ARCModel(frames, pages)); break;
+    case Policy::kOPT: model.reset(new OPTModel(frames, pages, next_use)); break;
+    }
+    uint64_t faults = 0;
+    for(size_t i = 0; i < references.size(); i++){
+        faults += model->Reference(references[i] >> 1, references[i] & 1, i);
+    }
+    return faults;
+}
+
+void ReferenceRecorder::Run(const mem::WatchEvent &event) {
+    uint64_t last = uint64_t(event.address) + event.count - 1;
+    for(uint64_t page = event.address / page_frame_size; page <= last / page_frame_size; page++){
+        out << std::hex << page * page_frame_size << (event.write ? " w\n" : "\n");
+    }
+}
@@ -0,0 +1,171 @@
+//
+// ReplacementSim - offline comparison of page replacement policies
+//
+
+#ifndef LAB03_REPLACEMENTSIM_H
+#define LAB03_REPLACEMENTSIM_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <istream>
+#include <ostream>
+#include <unordered_map>
+
+#include <MMU.h>
+
+/**
+ * ReplacementSim - counts the page faults of replacement policies on a page
+ * reference stream, for any number of frames. The stream is read from
+ * Program2 trace files (each command references the pages of the bytes it
+ * reads or writes, once per page) or from a recorded stream (see
+ * ReferenceRecorder), or added one reference at a time.
+ *
+ * Policies:
+ *   kFIFO    - oldest loaded page
+ *   kLRU     - least recently used page
+ *   kClock   - second chance with a reference bit
+ *   kWSClock - clock over pages outside the working set window; a modified
+ *              page is cleaned (written back) and skipped
+ *   kAging   - 8 bit counters shifted every aging interval references
+ *   kLFU     - least frequently used since loaded, oldest use on ties
+ *   kARC     - adaptive replacement cache (Megiddo and Modha)
+ *   kOPT     - Belady's optimal: page whose next use is farthest away,
+ *              using a next use index built over the whole stream
+ * Time is measured in references.
+ */
+class ReplacementSim {
+public:
+    enum class Policy { kFIFO, kLRU, kClock, kWSClock, kAging, kLFU, kARC, kOPT };
+
+    /**
+     *
+     * @return all policies, in the order of the enum
+     */
+    static std::vector<Policy> get_all_policies();
+
+    /**
+     *
+     * @param policy a policy
+     * @return name of the policy
+     */
+    static const char *get_policy_name(Policy policy);
+
+    ReplacementSim();
+    ~ReplacementSim(){};
+
+    /**
+     * appends the references made by the commands of a Program2 trace file
+     *
+     * @param trace trace file contents
+     * @throws std::runtime_error on a badly formed line
+     */
+    void AddTrace(std::istream &trace);
+
+    /**
+     * appends a recorded reference stream: one reference per line, a hex
+     * virtual address, followed by "w" for a write
+     *
+     * @param stream stream contents
+     * @throws std::runtime_error on a badly formed line
+     */
+    void AddReferences(std::istream &stream);
+
+    /**
+     * appends one reference
+     *
+     * @param vaddr virtual address referenced
+     * @param write true for a write
+     */
+    void AddReference(uint32_t vaddr, bool write);
+
+    /**
+     * simulates one policy
+     *
+     * @param policy replacement policy
+     * @param frames number of frames (at least 1)
+     * @return number of page faults, including the first use of each page
+     */
+    uint64_t CountFaults(Policy policy, uint32_t frames);
+
+    /**
+     * simulates each policy at each frame count, spreading the runs over
+     * threads
+     *
+     * @param policies policies to simulate
+     * @param frame_counts frame counts to simulate (each at least 1)
+     * @param thread_count number of threads, 0 for one per core
+     * @param faults set to faults[policy index][frame count index]
+     */
+    void Sweep(const std::vector<Policy> &policies,
+               const std::vector<uint32_t> &frame_counts,
+               uint32_t thread_count,
+               std::vector<std::vector<uint64_t>> &faults);
+
+    /**
+     *
+     * @param interval references between shifts of the aging counters
+     */
+    void set_aging_interval(uint32_t interval) { aging_interval = std::max<uint32_t>(interval, 1); }
+
+    /**
+     *
+     * @param window WSClock working set window in references, or 0 for
+     *        four times the frame count
+     */
+    void set_wsclock_window(uint32_t window) { wsclock_window = window; }
+
+    /**
+     *
+     * @return number of references
+     */
+    uint64_t get_reference_count() const { return references.size(); }
+
+    /**
+     *
+     * @return number of distinct pages referenced
+     */
+    uint32_t get_page_count() const { return page_ids.size(); }
+
+private:
+    // page ids are dense (0 to page count - 1), in order of first use;
+    // each reference is page id << 1 | write
+    std::vector<uint32_t> references;
+    std::unordered_map<uint32_t, uint32_t> page_ids;
+    std::vector<uint32_t> next_use;  // position of next use of the same page
+    uint32_t aging_interval;
+    uint32_t wsclock_window;
+
+    void add_range(uint32_t vaddr, uint32_t count, bool write);
+
+    /**
+     * builds next_use if references were added since it was built
+     */
+    void build_next_use();
+
+    /**
+     * runs a policy; build_next_use must have been called
+     */
+    uint64_t simulate(Policy policy, uint32_t frames) const;
+};
+
+/**
+ * ReferenceRecorder - watchpoint handler writing a reference stream for
+ * ReplacementSim::AddReferences. Each access writes one line for each page
+ * it touches. To record every access of a process in virtual mode:
+ *
+ *   memory.AddWatchpoint(0, mem::kVirtAddrSpaceSize, mem::kWatchReadWrite,
+ *                        std::make_shared<ReferenceRecorder>(out));
+ */
+class ReferenceRecorder : public mem::WatchHandler {
+public:
+    ReferenceRecorder(std::ostream &out_) : out(out_) {}
+    virtual void Run(const mem::WatchEvent &event);
+private:
+    std::ostream &out;
+};
+
+
+#endif //LAB03_REPLACEMENTSIM_H
@@ -0,0 +1,138 @@
+//
+// SharedMemory - regions of page frames mapped into several page tables
+//
+
+#include "SharedMemory.h"
+
+#include <algorithm>
+
+SharedMemory::SharedMemory(mem::MMU *memory_, MemoryAllocator *allocator_)
+: memory(memory_),
+  allocator(allocator_),
+  frame_refcounts(memory_->get_frame_count(), 0) {
+}
+
+int SharedMemory::CreateRegion(uint32_t page_count,
+                               const MemoryAllocator::PlacementPolicy &policy) {
+    if(page_count == 0){
+        throw std::runtime_error("Shared region must have at least one page\n");
+    }
+    Region region;
+    region.live = true;
+    if(!allocator->AllocatePageFrames(page_count, region.frames, policy)){
+        return -1;
+    }
+    for(uint32_t frame : region.frames){
+        memory->get_physical_memory().ZeroFrame(frame);
+        memory->MarkDirty(frame);
+        frame_refcounts.at(frame / mem::kPageSize) = 1;
+    }
+    regions.push_back(region);
+    return regions.size() - 1;
+}
+
+void SharedMemory::DestroyRegion(int region_id) {
+    Region &region = get_region(region_id);
+    region.live = false;
+    release_frames(region.frames);
+}
+
+void SharedMemory::Map(int region_id, mem::Addr page_table_base,
+                       mem::Addr vaddress, bool writable) {
+    Region &region = get_region(region_id);
+    if((vaddress & mem::kPageOffsetMask) != 0
+       || vaddress >= mem::kVirtAddrSpaceSize
+       || region.frames.size() > (mem::kVirtAddrSpaceSize - vaddress) / mem::kPageSize){
+        throw std::runtime_error("Shared region not page aligned or exceeds address space\n");
+    }
+    mem::PhysicalMemory &phys_mem = memory->get_physical_memory();
+
+    //check every page before changing any
+    for(uint32_t i = 0; i < region.frames.size(); i++){
+        mem::PageTableEntry pt_entry;
+        phys_mem.get_32(&pt_entry, pt_entry_address(page_table_base, vaddress + i * mem::kPageSize));
+        if((pt_entry & (mem::kPTE_PresentMask | mem::kPTE_DemandZeroMask)) != 0){
+            throw std::runtime_error("Shared region overlaps a mapped page\n");
+        }
+    }
+    for(uint32_t i = 0; i < region.frames.size(); i++){
+        uint32_t frame = region.frames[i];
+        phys_mem.put_32(pt_entry_address(page_table_base, vaddress + i * mem::kPageSize),
+                        frame | mem::kPTE_PresentMask | mem::kPTE_SharedMask
+                              | (writable ? mem::kPTE_WritableMask : 0));
+        frame_refcounts.at(frame / mem::kPageSize)++;
+    }
+    memory->MarkDirty(page_table_base);
+    region.mappings.push_back(std::make_pair(page_table_base, vaddress));
+}
+
+void SharedMemory::Unmap(int region_id, mem::Addr page_table_base, mem::Addr vaddress) {
+    if(region_id < 0 || static_cast<size_t>(region_id) >= regions.size()){
+        throw std::runtime_error("Shared region does not exist\n");
+    }
+    //a destroyed region can still be unmapped, but only where Map put it
+    Region &region = regions.at(region_id);
+    auto mapping = std::find(region.mappings.begin(), region.mappings.end(),
+                             std::make_pair(page_table_base, vaddress));
+    if(mapping == region.mappings.end()){
+        throw std::runtime_error("Shared region is not mapped at this address\n");
+    }
+    const std::vector<uint32_t> &frames = region.frames;
+    mem::PhysicalMemory &phys_mem = memory->get_physical_memory();
+    for(uint32_t i = 0; i < frames.size(); i++){
+        mem::PageTableEntry pt_entry;
+        phys_mem.get_32(&pt_entry, pt_entry_address(page_table_base, vaddress + i * mem::kPageSize));
+        if((pt_entry & mem::kPTE_PresentMask) == 0
+           || (pt_entry & mem::kPTE_FrameMask) != frames[i]){
+            throw std::runtime_error("Shared region mapping was changed outside SharedMemory\n");
+        }
+    }
+    region.mappings.erase(mapping);
+    for(uint32_t i = 0; i < frames.size(); i++){
+        phys_mem.put_32(pt_entry_address(page_table_base, vaddress + i * mem::kPageSize), 0);
+    }
+    memory->MarkDirty(page_table_base);
+    memory->FlushTLB();
+    release_frames(frames);
+}
+
+void SharedMemory::ForkMappings(mem::Addr parent_page_table, mem::Addr child_page_table) {
+    for(Region &region : regions){
+        size_t mapping_count = region.mappings.size();
+        for(size_t i = 0; i < mapping_count; i++){
+            if(region.mappings[i].first != parent_page_table){
+                continue;
+            }
+            region.mappings.push_back(std::make_pair(child_page_table,
+                                                     region.mappings[i].second));
+            for(uint32_t frame : region.frames){
+                frame_refcounts.at(frame / mem::kPageSize)++;
+            }
+        }
+    }
+}
+
+const std::vector<uint32_t> &SharedMemory::get_region_frames(int region_id) const {
+    if(region_id < 0 || static_cast<size_t>(region_id) >= regions.size()){
+        throw std::runtime_error("Shared region does not exist\n");
+    }
+    return regions.at(region_id).frames;
+}
+
+SharedMemory::Region &SharedMemory::get_region(int region_id) {
+    if(region_id < 0 || static_cast<size_t>(region_id) >= regions.size()
+       || !regions.at(region_id).live){
+        throw std::runtime_error("Shared region does not exist\n");
+    }
+    return regions.at(region_id);
+}
+
+void SharedMemory::release_frames(const std::vector<uint32_t> &frames) {
+    std::vector<uint32_t> freed;
+    for(uint32_t frame : frames){
+        if(--frame_refcounts.at(frame / mem::kPageSize) == 0){
+            freed.push_back(frame);
+        }
+    }
+    allocator->FreePageFrames(freed.size(), freed);
+}
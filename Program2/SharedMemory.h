@@ -0,0 +1,162 @@
+//
+// SharedMemory - regions of page frames mapped into several page tables
+//
+
+#ifndef LAB03_SHAREDMEMORY_H
+#define LAB03_SHAREDMEMORY_H
+
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#include <MMU.h>
+
+#include "MemoryAllocator.h"
+
+/**
+ * SharedMemory - creates regions of frames taken from a MemoryAllocator and
+ * maps them into any number of page tables. Each frame has a reference count:
+ * one for the region itself plus one for each page table mapping it. A frame
+ * goes back to the allocator when its count drops to 0, so a destroyed
+ * region stays usable through its remaining mappings.
+ *
+ * Page table entries are written directly in physical memory and marked
+ * dirty in the MMU; the TLB is flushed whenever a mapping is removed. The
+ * entries have kPTE_SharedMask set, so MMU::ForkPageTable copies them into
+ * the child still shared rather than copy-on-write; ForkMappings then
+ * records the child's mappings.
+ */
+class SharedMemory {
+public:
+    /**
+     *
+     * @param memory_ MMU holding the page tables
+     * @param allocator_ source of frames for regions
+     */
+    SharedMemory(mem::MMU *memory_, MemoryAllocator *allocator_);
+    ~SharedMemory(){};
+    SharedMemory(SharedMemory& orig) = delete;
+    SharedMemory(SharedMemory&& orig)= delete;
+    SharedMemory& operator=(SharedMemory& right) = delete;
+    SharedMemory& operator=(SharedMemory&& right)=delete;
+
+    /**
+     * creates a region of zeroed frames
+     *
+     * @param page_count number of pages in the region (> 0)
+     * @param policy home node and placement of the frames
+     * @return region id, or -1 if there are not enough free frames
+     */
+    int CreateRegion(uint32_t page_count,
+                     const MemoryAllocator::PlacementPolicy &policy
+                         = MemoryAllocator::PlacementPolicy());
+
+    /**
+     * drops the region's own reference to its frames; frames still mapped
+     * are freed when their last mapping is removed
+     *
+     * @param region_id id of the region
+     * @throws std::runtime_error if the region does not exist
+     */
+    void DestroyRegion(int region_id);
+
+    /**
+     * maps all pages of a region, starting at vaddress, into a page table
+     *
+     * @param region_id id of the region
+     * @param page_table_base physical address of the page table
+     * @param vaddress first virtual address (multiple of the page size)
+     * @param writable true if the pages are writable
+     * @throws std::runtime_error if the region does not exist, the address
+     *         is not aligned, or the pages overlap a present page
+     */
+    void Map(int region_id, mem::Addr page_table_base, mem::Addr vaddress,
+             bool writable);
+
+    /**
+     * removes a mapping made by Map, even if the region has been destroyed
+     *
+     * @param region_id id of the region
+     * @param page_table_base physical address of the page table
+     * @param vaddress virtual address passed to Map
+     * @throws std::runtime_error if Map did not map the region there, the
+     *         mapping was already removed, or its page table entries no
+     *         longer map the region's frames
+     */
+    void Unmap(int region_id, mem::Addr page_table_base, mem::Addr vaddress);
+
+    /**
+     * records a page table made by MMU::ForkPageTable as mapping every region
+     * its parent maps, at the same addresses, so the child's mappings can be
+     * removed with Unmap
+     *
+     * @param parent_page_table physical address of the forked page table
+     * @param child_page_table physical address of the new page table
+     */
+    void ForkMappings(mem::Addr parent_page_table, mem::Addr child_page_table);
+
+    /**
+     *
+     * @param region_id id of the region
+     * @return frames of the region, in page order
+     */
+    const std::vector<uint32_t> &get_region_frames(int region_id) const;
+
+    /**
+     *
+     * @param frame physical address of a frame
+     * @return number of references to the frame (0 if not shared)
+     */
+    uint32_t get_frame_refcount(uint32_t frame) const {
+        return frame_refcounts.at(frame / mem::kPageSize);
+    }
+
+private:
+    mem::MMU *memory;
+    MemoryAllocator *allocator;
+
+    /**
+     * Region - frames of one region, whether the region still exists, and
+     * where it is mapped
+     */
+    class Region {
+    public:
+        std::vector<uint32_t> frames;
+        bool live;
+        //page table base and virtual address of each mapping made by Map
+        std::vector<std::pair<mem::Addr, mem::Addr>> mappings;
+    };
+    std::vector<Region> regions;
+
+    //reference count of each frame, indexed by frame number
+    std::vector<uint32_t> frame_refcounts;
+
+    /**
+     *
+     * @param region_id id of the region
+     * @return the region, if it exists and has not been destroyed
+     */
+    Region &get_region(int region_id);
+
+    /**
+     * drops one reference to each frame, freeing frames which reach 0
+     *
+     * @param frames frames to release
+     */
+    void release_frames(const std::vector<uint32_t> &frames);
+
+    /**
+     *
+     * @param page_table_base physical address of the page table
+     * @param vaddress virtual address in the page
+     * @return physical address of the page table entry for vaddress
+     */
+    static mem::Addr pt_entry_address(mem::Addr page_table_base, mem::Addr vaddress) {
+        return page_table_base
+               + (vaddress >> mem::kPageSizeBits) * sizeof(mem::PageTableEntry);
+    }
+};
+
+
+#endif //LAB03_SHAREDMEMORY_H
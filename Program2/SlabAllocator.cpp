@@ -0,0 +1,217 @@
+//
+// SlabAllocator - small object allocator built on MemoryAllocator frames
+//
+
+#include "SlabAllocator.h"
+#include <algorithm>
+
+SlabAllocator::SlabAllocator(mem::MMU *memory_, MemoryAllocator *allocator_,
+                             const MemoryAllocator::PlacementPolicy &policy_)
+: memory(memory_),
+  allocator(allocator_),
+  policy(policy_),
+  size_classes(size_class_count) {
+    for(uint32_t i = 0; i < size_class_count; i++){
+        SizeClass &size_class = size_classes[i];
+        size_class.object_size = get_size_class_size(i);
+        //align objects to their size, up to a cache line
+        uint32_t alignment = std::min<uint32_t>(size_class.object_size, 64);
+        size_class.first_object = (header_size + alignment - 1) / alignment * alignment;
+        size_class.objects_per_slab = std::min<uint32_t>(
+            (page_frame_size - size_class.first_object) / size_class.object_size,
+            bitmap_words * 64);
+        size_class.head = end_of_list;
+        size_class.tail = end_of_list;
+        size_class.empty_slabs = 0;
+    }
+}
+
+bool SlabAllocator::Allocate(uint32_t size, uint32_t &address) {
+    if(size == 0 || size > max_object_size){
+        throw std::runtime_error("Slab object size out of range\n");
+    }
+    uint32_t class_number = 0;
+    while(get_size_class_size(class_number) < size){
+        class_number++;
+    }
+    SizeClass &size_class = size_classes[class_number];
+    if(size_class.head == end_of_list && !new_slab(class_number)){
+        return false;
+    }
+
+    //find a free object with one read of the bitmap
+    uint32_t slab = size_class.head;
+    uint64_t bitmap[bitmap_words];
+    memory->get_physical_memory().get_bytes(reinterpret_cast<uint8_t*>(bitmap),
+                                            slab + bitmap_offset, sizeof(bitmap));
+    uint32_t word = 0;
+    while(bitmap[word] == 0){
+        word++;
+    }
+    uint32_t bit = __builtin_ctzll(bitmap[word]);
+    bitmap[word] &= ~(uint64_t(1) << bit);
+    memory->get_physical_memory().put_64(slab + bitmap_offset + word * sizeof(uint64_t),
+                                         bitmap[word]);
+    memory->MarkDirty(slab);
+
+    uint32_t free_count = read_word(slab + free_count_offset);
+    if(free_count == size_class.objects_per_slab){
+        size_class.empty_slabs--;
+    }
+    store_word(slab + free_count_offset, --free_count);
+    if(free_count == 0){
+        unlink(size_class, slab);
+    }
+    size_class.stats.objects_in_use++;
+    address = slab + size_class.first_object + (word * 64 + bit) * size_class.object_size;
+    return true;
+}
+
+void SlabAllocator::Free(uint32_t address) {
+    uint32_t slab = address & ~(page_frame_size - 1);
+    if(read_word(slab + magic_offset) != slab_magic){
+        throw std::runtime_error("Freed address is not in a slab\n");
+    }
+    uint32_t class_number = read_word(slab + size_class_offset);
+    SizeClass &size_class = size_classes.at(class_number);
+    uint32_t offset = address - slab;
+    uint32_t index = (offset - size_class.first_object) / size_class.object_size;
+    if(offset < size_class.first_object
+       || (offset - size_class.first_object) % size_class.object_size != 0
+       || index >= size_class.objects_per_slab){
+        throw std::runtime_error("Freed address is not a slab object\n");
+    }
+    uint32_t word_address = slab + bitmap_offset + index / 64 * sizeof(uint64_t);
+    uint64_t word;
+    memory->get_physical_memory().get_64(&word, word_address);
+    uint64_t bit = uint64_t(1) << (index % 64);
+    if((word & bit) != 0){
+        throw std::runtime_error("Slab object freed twice\n");
+    }
+    word |= bit;
+    memory->get_physical_memory().put_64(word_address, word);
+    memory->MarkDirty(word_address);
+
+    uint32_t free_count = read_word(slab + free_count_offset) + 1;
+    store_word(slab + free_count_offset, free_count);
+    size_class.stats.objects_in_use--;
+    if(free_count == 1){
+        //was full, so on no list; allocate from it next
+        push_head(size_class, slab);
+    }
+    if(free_count == size_class.objects_per_slab){
+        if(size_class.empty_slabs > 0){
+            unlink(size_class, slab);
+            release_slab(class_number, slab);
+        } else {
+            //keep one empty slab, behind the partly used ones
+            if(size_class.objects_per_slab > 1){
+                unlink(size_class, slab);
+                push_tail(size_class, slab);
+            }
+            size_class.empty_slabs++;
+        }
+    }
+}
+
+void SlabAllocator::ReleaseEmptySlabs() {
+    for(uint32_t i = 0; i < size_class_count; i++){
+        SizeClass &size_class = size_classes[i];
+        //empty slabs are at the tail of the list
+        while(size_class.empty_slabs > 0){
+            uint32_t slab = size_class.tail;
+            unlink(size_class, slab);
+            release_slab(i, slab);
+            size_class.empty_slabs--;
+        }
+    }
+}
+
+void SlabAllocator::get_stats(uint32_t size_class, SlabStats &stats) const {
+    stats = size_classes.at(size_class).stats;
+}
+
+uint32_t SlabAllocator::read_word(uint32_t address) const {
+    uint32_t v32;
+    memory->get_physical_memory().get_32(&v32, address);
+    return v32;
+}
+
+void SlabAllocator::store_word(uint32_t address, uint32_t data) {
+    memory->get_physical_memory().put_32(address, data);
+    memory->MarkDirty(address);
+}
+
+bool SlabAllocator::new_slab(uint32_t class_number) {
+    SizeClass &size_class = size_classes[class_number];
+    std::vector<uint32_t> frames;
+    if(!allocator->AllocatePageFrames(1, frames, policy)){
+        return false;
+    }
+    uint32_t slab = frames[0];
+
+    //header and bitmap written with one transfer
+    uint8_t header[header_size] = {0};
+    uint32_t *words = reinterpret_cast<uint32_t*>(header);
+    words[magic_offset / sizeof(uint32_t)] = slab_magic;
+    words[size_class_offset / sizeof(uint32_t)] = class_number;
+    words[free_count_offset / sizeof(uint32_t)] = size_class.objects_per_slab;
+    uint64_t *bitmap = reinterpret_cast<uint64_t*>(header + bitmap_offset);
+    for(uint32_t i = 0; i < size_class.objects_per_slab; i++){
+        bitmap[i / 64] |= uint64_t(1) << (i % 64);
+    }
+    memory->get_physical_memory().put_bytes(slab, header_size, header);
+    memory->MarkDirty(slab);
+
+    push_head(size_class, slab);
+    size_class.empty_slabs++;
+    size_class.stats.slabs++;
+    size_class.stats.object_capacity += size_class.objects_per_slab;
+    return true;
+}
+
+void SlabAllocator::release_slab(uint32_t class_number, uint32_t slab) {
+    SizeClass &size_class = size_classes[class_number];
+    store_word(slab + magic_offset, 0);
+    std::vector<uint32_t> frames(1, slab);
+    allocator->FreePageFrames(1, frames);
+    size_class.stats.slabs--;
+    size_class.stats.object_capacity -= size_class.objects_per_slab;
+}
+
+void SlabAllocator::push_head(SizeClass &size_class, uint32_t slab) {
+    store_word(slab + next_offset, size_class.head);
+    store_word(slab + prev_offset, end_of_list);
+    if(size_class.head != end_of_list){
+        store_word(size_class.head + prev_offset, slab);
+    } else {
+        size_class.tail = slab;
+    }
+    size_class.head = slab;
+}
+
+void SlabAllocator::push_tail(SizeClass &size_class, uint32_t slab) {
+    store_word(slab + next_offset, end_of_list);
+    store_word(slab + prev_offset, size_class.tail);
+    if(size_class.tail != end_of_list){
+        store_word(size_class.tail + next_offset, slab);
+    } else {
+        size_class.head = slab;
+    }
+    size_class.tail = slab;
+}
+
+void SlabAllocator::unlink(SizeClass &size_class, uint32_t slab) {
+    uint32_t next = read_word(slab + next_offset);
+    uint32_t prev = read_word(slab + prev_offset);
+    if(prev == end_of_list){
+        size_class.head = next;
+    } else {
+        store_word(prev + next_offset, next);
+    }
+    if(next == end_of_list){
+        size_class.tail = prev;
+    } else {
+        store_word(next + prev_offset, prev);
+    }
+}
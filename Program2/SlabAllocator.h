@@ -0,0 +1,168 @@
+//
+// SlabAllocator - small object allocator built on MemoryAllocator frames
+//
+
+#ifndef LAB03_SLABALLOCATOR_H
+#define LAB03_SLABALLOCATOR_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+#include <MMU.h>
+
+#include "MemoryAllocator.h"
+
+/**
+ * SlabAllocator - allocates objects of up to 2048 bytes. Each request is
+ * rounded up to a power of two size class (16 to 2048 bytes). A slab is one
+ * frame from the MemoryAllocator holding objects of one size class, so
+ * objects are packed densely and aligned to their size (up to 64 bytes).
+ *
+ * Each slab starts with a header in the simulated memory:
+ *   magic, size class, free object count, next and previous slab in the
+ *   size class's list, then a free bitmap (1 bit per object, 1 = free) of
+ *   64 bytes, which is read with one access when allocating.
+ * Objects follow the header. Slabs with free objects are kept on a doubly
+ * linked list per size class; full slabs are on no list. Allocate takes
+ * from the head slab, and a full slab goes to the head when one of its
+ * objects is freed, so new objects fill recently full slabs before
+ * emptier ones. The list is not sorted by free count, which keeps
+ * Allocate and Free O(1). One empty slab per size class is kept for
+ * reuse at the tail; other empty slabs go back to the MemoryAllocator.
+ */
+class SlabAllocator {
+public:
+    /**
+     * SlabStats - state of one size class
+     */
+    class SlabStats {
+    public:
+        SlabStats() : slabs(0), objects_in_use(0), object_capacity(0) {}
+
+        uint32_t slabs;            // slabs (frames) held
+        uint32_t objects_in_use;   // objects allocated
+        uint32_t object_capacity;  // objects the slabs can hold
+    };
+
+    /**
+     *
+     * @param memory_ MMU whose physical memory holds the slabs
+     * @param allocator_ source of frames for slabs
+     * @param policy_ placement of slab frames
+     */
+    SlabAllocator(mem::MMU *memory_, MemoryAllocator *allocator_,
+                  const MemoryAllocator::PlacementPolicy &policy_ =
+                      MemoryAllocator::PlacementPolicy());
+    ~SlabAllocator(){};
+    SlabAllocator(SlabAllocator& orig) = delete;
+    SlabAllocator(SlabAllocator&& orig)= delete;
+    SlabAllocator& operator=(SlabAllocator& right) = delete;
+    SlabAllocator& operator=(SlabAllocator&& right)=delete;
+
+    /**
+     * allocates an object
+     *
+     * @param size size of object in bytes (1 to max_object_size)
+     * @param address set to physical address of the object
+     * @return true if allocated, false if no frame was available for a slab
+     * @throws std::runtime_error if size is 0 or too large
+     */
+    bool Allocate(uint32_t size, uint32_t &address);
+
+    /**
+     * frees an object
+     *
+     * @param address physical address returned by Allocate
+     * @throws std::runtime_error if address is not an allocated object
+     */
+    void Free(uint32_t address);
+
+    /**
+     * returns all empty slabs to the MemoryAllocator
+     */
+    void ReleaseEmptySlabs();
+
+    /**
+     *
+     * @return number of size classes
+     */
+    static uint32_t get_size_class_count() { return size_class_count; }
+
+    /**
+     *
+     * @param size_class size class number
+     * @return object size of the size class
+     */
+    static uint32_t get_size_class_size(uint32_t size_class) {
+        return min_object_size << size_class;
+    }
+
+    /**
+     *
+     * @param size_class size class number
+     * @param stats set to the state of the size class
+     */
+    void get_stats(uint32_t size_class, SlabStats &stats) const;
+
+    static const uint32_t max_object_size = 2048;
+
+private:
+    mem::MMU *memory;
+    MemoryAllocator *allocator;
+    MemoryAllocator::PlacementPolicy policy;
+
+    static const uint32_t page_frame_size = 0x2000;
+    static const uint32_t min_object_size = 16;
+    static const uint32_t size_class_count = 8;
+    static const uint32_t end_of_list = 0xffffffff;
+    static const uint32_t slab_magic = 0x534c4142;  // "SLAB"
+    //offsets in slab header
+    static const uint32_t magic_offset = 0;
+    static const uint32_t size_class_offset = sizeof(uint32_t);
+    static const uint32_t free_count_offset = 2 * sizeof(uint32_t);
+    static const uint32_t next_offset = 3 * sizeof(uint32_t);
+    static const uint32_t prev_offset = 4 * sizeof(uint32_t);
+    static const uint32_t bitmap_offset = 32;
+    static const uint32_t bitmap_words = 8;  // 64 bit words
+    static const uint32_t header_size = bitmap_offset + bitmap_words * sizeof(uint64_t);
+
+    /**
+     * SizeClass - list of slabs with free objects, and counts
+     */
+    class SizeClass {
+    public:
+        uint32_t object_size;
+        uint32_t first_object;     // offset of first object in slab
+        uint32_t objects_per_slab;
+        uint32_t head;             // slab objects are allocated from
+        uint32_t tail;             // kept empty slab, if any
+        uint32_t empty_slabs;
+        SlabStats stats;
+    };
+    std::vector<SizeClass> size_classes;
+
+    uint32_t read_word(uint32_t address) const;
+    void store_word(uint32_t address, uint32_t data);
+
+    /**
+     * takes a frame from the MemoryAllocator and adds it as an empty slab
+     * at the head of a size class's list
+     *
+     * @return true if a frame was available
+     */
+    bool new_slab(uint32_t size_class);
+
+    /**
+     * returns an empty slab's frame to the MemoryAllocator
+     */
+    void release_slab(uint32_t size_class, uint32_t slab);
+
+    void push_head(SizeClass &size_class, uint32_t slab);
+    void push_tail(SizeClass &size_class, uint32_t slab);
+    void unlink(SizeClass &size_class, uint32_t slab);
+};
+
+
+#endif //LAB03_SLABALLOCATOR_H
@@ -0,0 +1,226 @@
+//
+// SwapFile - page sized slots in a host file, backing store for Pager
+//
+
+#include "SwapFile.h"
+
+#include <cstring>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <algorithm>
+
+SwapFile::SwapFile(const std::string &file_name_, uint32_t slot_size_,
+                   uint32_t worker_count, uint32_t max_pending_, bool durable)
+: file_name(file_name_),
+  slot_size(slot_size_),
+  slot_count(0),
+  max_pending(std::max<uint32_t>(max_pending_, 1)),
+  stopping(false),
+  write_failed(false) {
+    fd = open(file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC | (durable ? O_DSYNC : 0), 0600);
+    if(fd < 0){
+        throw std::runtime_error("Unable to open swap file " + file_name + "\n");
+    }
+    for(uint32_t i = 0; i < worker_count; i++){
+        workers.emplace_back(&SwapFile::worker, this);
+    }
+}
+
+SwapFile::~SwapFile() {
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        work_done.wait(lock, [this]{ return pending.empty() || write_failed; });
+        stopping = true;
+    }
+    work_ready.notify_all();
+    for(std::thread &t : workers){
+        t.join();
+    }
+    close(fd);
+}
+
+uint32_t SwapFile::AllocateSlot() {
+    if(free_slots.empty()){
+        return slot_count++;
+    }
+    uint32_t slot = free_slots.back();
+    free_slots.pop_back();
+    return slot;
+}
+
+void SwapFile::FreeSlot(uint32_t slot) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        auto entry = pending.find(slot);
+        if(entry != pending.end() && !entry->second.in_flight){
+            //still queued; the worker skips slots with no pending entry
+            pending.erase(entry);
+            work_done.notify_all();
+        }
+    }
+    free_slots.push_back(slot);
+}
+
+void SwapFile::ReadSlot(uint32_t slot, uint8_t *data) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        swap_stats.reads++;
+        auto entry = pending.find(slot);
+        if(entry != pending.end()){
+            memcpy(data, entry->second.data->data(), slot_size);
+            swap_stats.pending_read_hits++;
+            return;
+        }
+    }
+    if(pread(fd, data, slot_size, off_t(slot) * slot_size) != ssize_t(slot_size)){
+        throw std::runtime_error("Swap file read failed\n");
+    }
+}
+
+void SwapFile::WriteSlot(uint32_t slot, const uint8_t *data) {
+    if(workers.empty()){
+        swap_stats.writes++;
+        swap_stats.write_calls++;
+        if(pwrite(fd, data, slot_size, off_t(slot) * slot_size) != ssize_t(slot_size)){
+            throw std::runtime_error("Swap file write failed\n");
+        }
+        return;
+    }
+
+    //copy outside the lock; the caller reuses its buffer at once
+    auto copy = std::make_shared<std::vector<uint8_t>>(data, data + slot_size);
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    if(write_failed){
+        throw std::runtime_error("Swap file write failed\n");
+    }
+    swap_stats.writes++;
+    auto entry = pending.find(slot);
+    if(entry == pending.end()){
+        if(pending.size() >= max_pending){
+            swap_stats.write_stalls++;
+            work_done.wait(lock, [this]{ return pending.size() < max_pending || write_failed; });
+        }
+        if(write_failed){
+            throw std::runtime_error("Swap file write failed\n");
+        }
+        PendingWrite &write = pending[slot];
+        write.data = copy;
+        write.version = 0;
+        write.queued = false;
+        write.in_flight = false;
+        entry = pending.find(slot);
+    } else {
+        if(!entry->second.in_flight){
+            swap_stats.combined_writes++;
+        }
+        entry->second.data = copy;
+        entry->second.version++;
+    }
+    if(!entry->second.queued && !entry->second.in_flight){
+        entry->second.queued = true;
+        write_queue.push_back(slot);
+        work_ready.notify_one();
+    }
+}
+
+void SwapFile::Sync() {
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    work_done.wait(lock, [this]{ return pending.empty() || write_failed; });
+    if(write_failed){
+        throw std::runtime_error("Swap file write failed\n");
+    }
+}
+
+void SwapFile::get_stats(SwapStats &stats) {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    stats = swap_stats;
+}
+
+void SwapFile::worker() {
+    std::vector<std::pair<uint32_t, std::shared_ptr<std::vector<uint8_t>>>> batch;
+    std::vector<uint64_t> versions;
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    while(true){
+        work_ready.wait(lock, [this]{ return stopping || !write_queue.empty(); });
+        if(write_queue.empty()){
+            return;  // stopping
+        }
+
+        //take every queued slot which is still pending
+        batch.clear();
+        versions.clear();
+        while(!write_queue.empty()){
+            uint32_t slot = write_queue.front();
+            write_queue.pop_front();
+            auto entry = pending.find(slot);
+            if(entry == pending.end() || !entry->second.queued){
+                continue;  // freed while queued
+            }
+            entry->second.queued = false;
+            entry->second.in_flight = true;
+            batch.push_back(std::make_pair(slot, entry->second.data));
+        }
+        if(batch.empty()){
+            continue;
+        }
+        std::sort(batch.begin(), batch.end(),
+                  [](const std::pair<uint32_t, std::shared_ptr<std::vector<uint8_t>>> &a,
+                     const std::pair<uint32_t, std::shared_ptr<std::vector<uint8_t>>> &b) {
+                      return a.first < b.first;
+                  });
+        for(auto &write : batch){
+            versions.push_back(pending[write.first].version);
+        }
+        swap_stats.write_batches++;
+
+        lock.unlock();
+        bool ok = write_batch(batch);
+        lock.lock();
+
+        write_failed |= !ok;
+        for(size_t i = 0; i < batch.size(); i++){
+            PendingWrite &write = pending[batch[i].first];
+            write.in_flight = false;
+            if(ok && write.version == versions[i]){
+                pending.erase(batch[i].first);
+            } else if(!write.queued && !write_failed){
+                //written again while in flight; write the newer data
+                write.queued = true;
+                write_queue.push_back(batch[i].first);
+            }
+            //after a failed write the data stays pending, so ReadSlot
+            //still returns it
+        }
+        work_done.notify_all();
+    }
+}
+
+bool SwapFile::write_batch(const std::vector<std::pair<uint32_t,
+                           std::shared_ptr<std::vector<uint8_t>>>> &batch) {
+    std::vector<struct iovec> iov;
+    size_t run_start = 0;
+    while(run_start < batch.size()){
+        //extend the run while slots are adjacent
+        size_t run_end = run_start + 1;
+        while(run_end < batch.size() && run_end - run_start < IOV_MAX
+              && batch[run_end].first == batch[run_end - 1].first + 1){
+            run_end++;
+        }
+        iov.clear();
+        for(size_t i = run_start; i < run_end; i++){
+            iov.push_back({batch[i].second->data(), slot_size});
+        }
+        ssize_t length = ssize_t(run_end - run_start) * slot_size;
+        if(pwritev(fd, iov.data(), iov.size(), off_t(batch[run_start].first) * slot_size) != length){
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            swap_stats.write_calls++;
+        }
+        run_start = run_end;
+    }
+    return true;
+}
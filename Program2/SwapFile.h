@@ -0,0 +1,187 @@
+//
+// SwapFile - page sized slots in a host file, backing store for Pager
+//
+
+#ifndef LAB03_SWAPFILE_H
+#define LAB03_SWAPFILE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+#include <memory>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+/**
+ * SwapFile - a host file divided into page sized slots. The file is created
+ * (or truncated) when the SwapFile is constructed and grows as slots are
+ * used. Freed slots are reused before the file grows.
+ *
+ * With worker threads, WriteSlot copies the data and returns at once; the
+ * workers write queued slots in the background, taking all queued slots
+ * at once and writing runs of adjacent slots with one pwritev. A slot
+ * written again before its write starts is written once, with the newest
+ * data. ReadSlot of a slot whose write is pending copies the pending data
+ * instead of reading the file, so a page can be read back as soon as it is
+ * queued. Reads of other slots go to the file without waiting for the
+ * writes. WriteSlot blocks while max_pending slots are waiting.
+ * Without worker threads every write goes to the file before returning.
+ *
+ * If a background write fails, the data of the slots it held stays pending,
+ * so ReadSlot still returns the newest data of every slot, and no further
+ * background writes are queued: WriteSlot and Sync throw from then on.
+ */
+class SwapFile {
+public:
+    /**
+     * SwapStats - swap file activity
+     */
+    class SwapStats {
+    public:
+        SwapStats() : reads(0), writes(0), pending_read_hits(0),
+            combined_writes(0), write_batches(0), write_calls(0),
+            write_stalls(0) {}
+
+        uint64_t reads;              // slots read
+        uint64_t writes;             // slots written by WriteSlot
+        uint64_t pending_read_hits;  // reads copied from a pending write
+        uint64_t combined_writes;    // writes replaced before they started
+        uint64_t write_batches;      // groups of slots taken by a worker
+        uint64_t write_calls;        // pwrite/pwritev calls
+        uint64_t write_stalls;       // WriteSlot calls which waited
+    };
+
+    /**
+     *
+     * @param file_name_ path of the host file
+     * @param slot_size_ bytes per slot
+     * @param worker_count number of background writer threads, 0 to write
+     *        synchronously
+     * @param max_pending_ most slots waiting to be written
+     * @param durable true to open the file with O_DSYNC, so each write
+     *        reaches the device before it completes, as with a swap device
+     *        rather than a file in the host page cache
+     * @throws std::runtime_error if the file can't be opened
+     */
+    SwapFile(const std::string &file_name_, uint32_t slot_size_,
+             uint32_t worker_count = 0, uint32_t max_pending_ = 256,
+             bool durable = false);
+
+    /**
+     * Destructor - finishes pending writes and stops the workers
+     */
+    ~SwapFile();
+    SwapFile(SwapFile& orig) = delete;
+    SwapFile(SwapFile&& orig)= delete;
+    SwapFile& operator=(SwapFile& right) = delete;
+    SwapFile& operator=(SwapFile&& right)=delete;
+
+    /**
+     *
+     * @return number of a free slot
+     */
+    uint32_t AllocateSlot();
+
+    /**
+     * frees a slot, dropping its pending write if it has not started
+     *
+     * @param slot slot returned by AllocateSlot
+     */
+    void FreeSlot(uint32_t slot);
+
+    /**
+     * reads one slot, from its pending write if it has one (including a
+     * write which failed)
+     *
+     * @param slot slot to read
+     * @param data buffer of slot size bytes
+     * @throws std::runtime_error on I/O error
+     */
+    void ReadSlot(uint32_t slot, uint8_t *data);
+
+    /**
+     * writes one slot, in the background if there are worker threads.
+     * The data is copied before returning.
+     *
+     * @param slot slot to write
+     * @param data buffer of slot size bytes
+     * @throws std::runtime_error on I/O error, including an error in an
+     *         earlier background write
+     */
+    void WriteSlot(uint32_t slot, const uint8_t *data);
+
+    /**
+     * waits until all pending writes are in the file
+     *
+     * @throws std::runtime_error if a background write failed
+     */
+    void Sync();
+
+    /**
+     *
+     * @return number of slots in use
+     */
+    uint32_t get_slots_used() const { return slot_count - free_slots.size(); }
+
+    /**
+     *
+     * @return size of a slot in bytes
+     */
+    uint32_t get_slot_size() const { return slot_size; }
+
+    /**
+     *
+     * @param stats set to the swap file activity so far
+     */
+    void get_stats(SwapStats &stats);
+
+private:
+    std::string file_name;
+    uint32_t slot_size;
+    int fd;
+    uint32_t slot_count;               // slots ever allocated
+    std::vector<uint32_t> free_slots;  // freed slots, reused first
+
+    /**
+     * PendingWrite - newest data for a slot not yet written
+     */
+    class PendingWrite {
+    public:
+        std::shared_ptr<std::vector<uint8_t>> data;
+        uint64_t version;  // incremented by each WriteSlot
+        bool queued;       // slot is in write_queue
+        bool in_flight;    // a worker is writing the slot
+    };
+
+    // all below guarded by queue_mutex
+    std::mutex queue_mutex;
+    std::condition_variable work_ready;    // slots queued or stopping
+    std::condition_variable work_done;     // a write finished
+    std::map<uint32_t, PendingWrite> pending;
+    std::deque<uint32_t> write_queue;
+    uint32_t max_pending;
+    bool stopping;
+    bool write_failed;     // a background write failed; its slots stay pending
+    SwapStats swap_stats;
+    std::vector<std::thread> workers;
+
+    /**
+     * writer thread: takes all queued slots and writes them
+     */
+    void worker();
+
+    /**
+     * writes runs of adjacent slots, one pwritev per run
+     *
+     * @return false if a write failed
+     */
+    bool write_batch(const std::vector<std::pair<uint32_t,
+                     std::shared_ptr<std::vector<uint8_t>>>> &batch);
+};
+
+
+#endif //LAB03_SWAPFILE_H
@@ -0,0 +1,100 @@
+/*
+ * BulkFrameBench - MemoryAllocator batch allocation through vectors and
+ *   caller arrays, and process teardown, with the metadata in simulated
+ *   memory and in host arrays
+ *
+ * Workloads:
+ *   vector   - allocate and free all frames, 64 per call, std::vector API
+ *   array    - the same through the caller array API
+ *   teardown - a process allocates all frames, 64 per call, then is
+ *              destroyed; the time is for DestroyProcess only, compared
+ *              with freeing the same frames 64 at a time
+ *
+ * Usage: BulkFrameBench [frame_count]   (default 262144)
+ *
+ * Build and run with "make bench" in the project directory.
+ *
+ * File:   BulkFrameBench.cpp
+ */
+
+#include "../MemoryAllocator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+const uint32_t kBatch = 64;
+const int kRounds = 5;
+
+double ElapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(
+          std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Run - time the workloads with one metadata mode
+ */
+void Run(const char *label, uint32_t frame_count, MemoryAllocator::MetadataMode mode) {
+  mem::MMU memory(frame_count);
+  MemoryAllocator allocator(&memory, mode);
+  uint32_t batches = allocator.get_page_frames_free() / kBatch;
+  uint32_t frames = batches * kBatch;
+
+  double vector_ns = 0, array_ns = 0, free_ns = 0, teardown_ns = 0;
+  for (int round = 0; round < kRounds; ++round) {
+    std::vector<uint32_t> held;
+    held.reserve(frames);
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < batches; ++i) {
+      allocator.AllocatePageFrames(kBatch, held);
+    }
+    for (uint32_t i = 0; i < batches; ++i) {
+      allocator.FreePageFrames(kBatch, held);
+    }
+    vector_ns += ElapsedNs(start);
+
+    std::vector<uint32_t> array(frames);
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < batches; ++i) {
+      allocator.AllocatePageFrames(kBatch, array.data() + i * kBatch);
+    }
+    for (uint32_t i = 0; i < batches; ++i) {
+      allocator.FreePageFrames(kBatch, array.data() + i * kBatch);
+    }
+    array_ns += ElapsedNs(start);
+
+    int process = allocator.CreateProcess();
+    for (uint32_t i = 0; i < batches; ++i) {
+      allocator.AllocateProcessPageFrames(process, kBatch);
+    }
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < batches; ++i) {
+      allocator.FreeProcessPageFrames(process, kBatch);
+    }
+    free_ns += ElapsedNs(start);
+    for (uint32_t i = 0; i < batches; ++i) {
+      allocator.AllocateProcessPageFrames(process, kBatch);
+    }
+    start = std::chrono::steady_clock::now();
+    allocator.DestroyProcess(process);
+    teardown_ns += ElapsedNs(start);
+  }
+  double per_frame = 1.0 / (kRounds * double(frames));
+  printf("%-10s %-9s %8.2f ns/frame\n", label, "vector", vector_ns * per_frame / 2);
+  printf("%-10s %-9s %8.2f ns/frame\n", label, "array", array_ns * per_frame / 2);
+  printf("%-10s %-9s %8.2f ns/frame (batch frees %.2f)\n", label, "teardown",
+         teardown_ns * per_frame, free_ns * per_frame);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  uint32_t frame_count = argc > 1 ? strtoul(argv[1], nullptr, 0) : 262144;
+  printf("%u frames, %u per call\n", frame_count, kBatch);
+  Run("in memory", frame_count, MemoryAllocator::MetadataMode::kInMemory);
+  Run("host", frame_count, MemoryAllocator::MetadataMode::kHost);
+  return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * FrameAllocatorBench - compare the free list MemoryAllocator, with its
+ *   metadata in simulated memory and in host arrays, with the
+ *   BitmapAllocator
+ *
+ * Workloads, per allocator:
+ *   fill     - allocate every free frame, one frame per call
+ *   batch    - allocate every free frame, 64 frames per call
+ *   churn    - free and reallocate random batches of 1 to 64 frames with
+ *              memory 90% full
+ *
+ * Usage: FrameAllocatorBench [frame_count]   (default 65536; the 32 bit
+ * physical address space limits memory to 524288 frames)
+ *
+ * Build and run with "make bench" in the project directory.
+ *
+ * File:   FrameAllocatorBench.cpp
+ */
+
+#include "../BitmapAllocator.h"
+#include "../MemoryAllocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+const int kChurnRounds = 20000;
+
+/**
+ * Time - run a benchmark body and print nanoseconds per frame
+ *
+ * @param label allocator name
+ * @param workload workload name
+ * @param body function to time, returning the number of frames handled
+ */
+template <typename Body>
+void Time(const char *label, const char *workload, Body body) {
+  auto start = std::chrono::steady_clock::now();
+  uint64_t frames = body();
+  double ns = std::chrono::duration<double, std::nano>(
+          std::chrono::steady_clock::now() - start).count();
+  printf("%-10s %-6s %8.1f ns/frame\n", label, workload, ns / frames);
+}
+
+/**
+ * Run - time the workloads on one allocator
+ */
+template <typename Allocator>
+void Run(const char *label, Allocator &allocator) {
+  std::vector<uint32_t> frames;
+  uint32_t free_frames = allocator.get_page_frames_free();
+  
+  Time(label, "fill", [&]() {
+    while (allocator.AllocatePageFrames(1, frames)) {}
+    return frames.size();
+  });
+  allocator.FreePageFrames(frames.size(), frames);
+  
+  Time(label, "batch", [&]() {
+    while (allocator.AllocatePageFrames(64, frames)) {}
+    return frames.size();
+  });
+  allocator.FreePageFrames(frames.size(), frames);
+  
+  // Fill to 90%, shuffled so frees are scattered
+  allocator.AllocatePageFrames(free_frames / 10 * 9, frames);
+  std::mt19937 rng(1);
+  std::shuffle(frames.begin(), frames.end(), rng);
+  Time(label, "churn", [&]() {
+    uint64_t handled = 0;
+    for (int round = 0; round < kChurnRounds; ++round) {
+      uint32_t count = rng() % 64 + 1;
+      allocator.FreePageFrames(count, frames);
+      allocator.AllocatePageFrames(count, frames);
+      handled += 2 * count;
+    }
+    return handled;
+  });
+  allocator.FreePageFrames(frames.size(), frames);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  uint32_t frame_count = argc > 1 ? strtoul(argv[1], nullptr, 0) : 65536;
+  printf("%u frames\n", frame_count);
+  {
+    mem::MMU memory(frame_count);
+    MemoryAllocator allocator(&memory);
+    Run("free list", allocator);
+  }
+  {
+    mem::MMU memory(frame_count);
+    MemoryAllocator allocator(&memory, MemoryAllocator::MetadataMode::kHost);
+    Run("host list", allocator);
+  }
+  {
+    mem::MMU memory(frame_count);
+    BitmapAllocator allocator(&memory);
+    Run("bitmap", allocator);
+  }
+  return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * ReplacementSweep - fault rate curves of the page replacement policies
+ *   in ReplacementSim
+ *
+ * Usage: ReplacementSweep [-j threads] [-n points] [-r] [file...]
+ *   file  Program2 trace file, or with -r a recorded reference stream
+ *         (see ReferenceRecorder); all files are joined into one stream
+ *   -j    threads for the sweep (default one per core)
+ *   -n    number of frame counts, evenly spaced up to the number of
+ *         distinct pages (default 16)
+ * With no files, a synthetic stream is used: a hot set with skewed use,
+ * interrupted by sequential scans larger than memory, with some writes.
+ *
+ * Output is CSV: frame count, then the fault rate (faults per reference)
+ * of each policy.
+ *
+ * Build and run with "make bench" in the project directory.
+ *
+ * File:   ReplacementSweep.cpp
+ */
+
+#include "../ReplacementSim.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const uint32_t kPageSize = 0x2000;
+
+/**
+ * AddSyntheticStream - 200000 references over 1024 pages
+ */
+void AddSyntheticStream(ReplacementSim &sim) {
+  std::mt19937 random(3361);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  uint32_t scan_page = 0;
+  for (int i = 0; i < 200000; ++i) {
+    uint32_t page;
+    if (i % 10000 < 1500) {
+      page = 256 + scan_page++ % 768;  // scan
+    } else {
+      page = uint32_t(256 * uniform(random) * uniform(random));  // skewed hot set
+    }
+    sim.AddReference(page * kPageSize, uniform(random) < 0.3);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  uint32_t thread_count = 0;
+  uint32_t points = 16;
+  bool recorded = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "j:n:r")) != -1) {
+    switch (opt) {
+      case 'j': thread_count = strtoul(optarg, nullptr, 10); break;
+      case 'n': points = std::max<uint32_t>(strtoul(optarg, nullptr, 10), 1); break;
+      case 'r': recorded = true; break;
+      default:
+        fprintf(stderr, "usage: %s [-j threads] [-n points] [-r] [file...]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  ReplacementSim sim;
+  try {
+    if (optind == argc) {
+      AddSyntheticStream(sim);
+    }
+    for (int i = optind; i < argc; ++i) {
+      std::ifstream in(argv[i]);
+      if (!in) {
+        fprintf(stderr, "ERROR: unable to open %s\n", argv[i]);
+        return 2;
+      }
+      if (recorded) {
+        sim.AddReferences(in);
+      } else {
+        sim.AddTrace(in);
+      }
+    }
+  } catch (std::runtime_error &e) {
+    fprintf(stderr, "ERROR: %s", e.what());
+    return 2;
+  }
+  if (sim.get_reference_count() == 0) {
+    fprintf(stderr, "ERROR: no references\n");
+    return 2;
+  }
+
+  std::vector<uint32_t> frame_counts;
+  for (uint32_t i = 1; i <= points; ++i) {
+    uint32_t frames = std::max<uint32_t>(uint64_t(sim.get_page_count()) * i / points, 1);
+    if (frame_counts.empty() || frames != frame_counts.back()) {
+      frame_counts.push_back(frames);
+    }
+  }
+  std::vector<ReplacementSim::Policy> policies = ReplacementSim::get_all_policies();
+  std::vector<std::vector<uint64_t>> faults;
+  auto start = std::chrono::steady_clock::now();
+  sim.Sweep(policies, frame_counts, thread_count, faults);
+  double seconds = std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - start).count();
+
+  printf("# %llu references, %u pages, %zu runs in %.2f s\n",
+         (unsigned long long) sim.get_reference_count(), sim.get_page_count(),
+         policies.size() * frame_counts.size(), seconds);
+  printf("frames");
+  for (ReplacementSim::Policy policy : policies) {
+    printf(",%s", ReplacementSim::get_policy_name(policy));
+  }
+  printf("\n");
+  for (size_t f = 0; f < frame_counts.size(); ++f) {
+    printf("%u", frame_counts[f]);
+    for (size_t p = 0; p < policies.size(); ++p) {
+      printf(",%.4f", double(faults[p][f]) / sim.get_reference_count());
+    }
+    printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * SwapBench - fault cost of a Pager evicting modified pages, with swap
+ *   writes done before the fault returns and by background workers
+ *
+ * A process writes one word in each page of a region four times the size
+ * of its frame limit, in order, so every fault evicts a modified page.
+ * The swap file is in the current directory, first in the host page cache,
+ * then durable (O_DSYNC), where each synchronous write waits for the
+ * device. Results are in microseconds per fault, with the share of swap
+ * reads copied from pending writes.
+ *
+ * Build and run with "make bench" in the project directory.
+ *
+ * File:   SwapBench.cpp
+ */
+
+#include "../MemoryAllocator.h"
+#include "../Pager.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace mem;
+
+namespace {
+
+const Addr kFrames = 512;
+const uint32_t kResidentFrames = 256;
+const uint32_t kPages = 4 * kResidentFrames;
+const int kRounds = 8;
+
+/**
+ * RunPager - write every page kRounds times, return microseconds per fault
+ */
+double RunPager(uint32_t swap_workers, bool durable,
+                double &pending_hit_share) {
+  MMU vm(kFrames, 64);
+  MemoryAllocator allocator(&vm);
+  std::vector<uint32_t> page_tables;
+  allocator.AllocatePageFrames(2, page_tables);
+  PageTable kernel_page_table;
+  for (Addr i = 0; i < kFrames; ++i) {
+    kernel_page_table.at(i) = (i << kPageSizeBits) | kPTE_PresentMask
+            | kPTE_WritableMask;
+  }
+  vm.put_bytes(page_tables[0], kPageTableSizeBytes, &kernel_page_table);
+  PageTable user_page_table;
+  vm.put_bytes(page_tables[1], kPageTableSizeBytes, &user_page_table);
+  vm.enter_virtual_mode(PMCB(page_tables[0]));
+
+  auto pager = std::make_shared<Pager>(&vm, &allocator, "SwapBench.swap",
+                                       Pager::ReplacementPolicy::kFIFO,
+                                       kResidentFrames, swap_workers, durable);
+  vm.SetPageFaultHandler(pager);
+  pager->MapPages(page_tables[1], 0, kPages, true);
+  vm.set_user_PMCB(PMCB(page_tables[1]));
+  vm.FlushTLB();
+
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < kRounds; ++round) {
+    for (uint32_t page = 0; page < kPages; ++page) {
+      uint32_t value = round;
+      vm.put_bytes(page * kPageSize, sizeof(value), &value);
+    }
+  }
+  double us = std::chrono::duration<double, std::micro>(
+          std::chrono::steady_clock::now() - start).count();
+
+  Pager::PagerStats stats;
+  pager->get_stats(stats);
+  SwapFile::SwapStats swap_stats;
+  pager->get_swap_stats(swap_stats);
+  pending_hit_share = swap_stats.reads == 0 ? 0.0
+          : double(swap_stats.pending_read_hits) / swap_stats.reads;
+  vm.set_kernel_PMCB();
+  return us / stats.faults;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  printf("%-34s %12s %14s\n", "swap writes", "us/fault", "pending reads");
+  for (bool durable : {false, true}) {
+    for (uint32_t workers : {0, 1, 2, 4}) {
+      double pending_hit_share;
+      double us = RunPager(workers, durable, pending_hit_share);
+      char label[48];
+      if (workers == 0) {
+        snprintf(label, sizeof(label), "%s, synchronous",
+                 durable ? "durable" : "cached");
+      } else {
+        snprintf(label, sizeof(label), "%s, %u background worker%s",
+                 durable ? "durable" : "cached", workers, workers == 1 ? "" : "s");
+      }
+      printf("%-34s %12.2f %13.1f%%\n", label, us, 100.0 * pending_hit_share);
+    }
+  }
+  remove("SwapBench.swap");
+  return 0;
+}
@@ -23,9 +23,9 @@ using namespace mem;
  */
 int main(int argc, char** argv) {
 
-    //MMU mem(256);
+    MMU memory(256);
     
-    MemoryAllocator(256);
+    MemoryAllocator allocator(&memory);
     
     return 0;
 }
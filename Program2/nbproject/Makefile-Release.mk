@@ -35,11 +35,38 @@ OBJECTDIR=${CND_BUILDDIR}/${CND_CONF}/${CND_PLATFORM}
 
 # Object Files
 OBJECTFILES= \
+	${OBJECTDIR}/BitmapAllocator.o \
+	${OBJECTDIR}/BuddyAllocator.o \
+	${OBJECTDIR}/FrameCache.o \
 	${OBJECTDIR}/MemoryAllocator.o \
+	${OBJECTDIR}/Pager.o \
 	${OBJECTDIR}/Process.o \
+	${OBJECTDIR}/ReplacementSim.o \
+	${OBJECTDIR}/SharedMemory.o \
+	${OBJECTDIR}/SlabAllocator.o \
+	${OBJECTDIR}/SwapFile.o \
 	${OBJECTDIR}/main.o
 
 
+# Test Directory
+TESTDIR=${CND_BUILDDIR}/${CND_CONF}/${CND_PLATFORM}/tests
+
+# Test Files
+TESTFILES= \
+	${TESTDIR}/TestFiles/f1
+
+# Test Object Files
+TESTOBJECTFILES= \
+	${TESTDIR}/tests/BitmapAllocatorTests.o \
+	${TESTDIR}/tests/BuddyAllocatorTests.o \
+	${TESTDIR}/tests/FrameCacheTests.o \
+	${TESTDIR}/tests/MemoryAllocatorTests.o \
+	${TESTDIR}/tests/PagerTests.o \
+	${TESTDIR}/tests/ReplacementSimTests.o \
+	${TESTDIR}/tests/SharedMemoryTests.o \
+	${TESTDIR}/tests/SlabAllocatorTests.o \
+	${TESTDIR}/tests/SwapFileTests.o
+
 # C Compiler Flags
 CFLAGS=
 
@@ -66,16 +93,56 @@ ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/program2: ${OBJECTFILES}
 	${MKDIR} -p ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}
 	${LINK.cc} -o ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/program2 ${OBJECTFILES} ${LDLIBSOPTIONS}
 
+${OBJECTDIR}/BitmapAllocator.o: BitmapAllocator.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/BitmapAllocator.o BitmapAllocator.cpp
+
+${OBJECTDIR}/BuddyAllocator.o: BuddyAllocator.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/BuddyAllocator.o BuddyAllocator.cpp
+
+${OBJECTDIR}/FrameCache.o: FrameCache.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/FrameCache.o FrameCache.cpp
+
 ${OBJECTDIR}/MemoryAllocator.o: MemoryAllocator.cpp
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
 	$(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/MemoryAllocator.o MemoryAllocator.cpp
 
+${OBJECTDIR}/Pager.o: Pager.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/Pager.o Pager.cpp
+
 ${OBJECTDIR}/Process.o: Process.cpp
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
 	$(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/Process.o Process.cpp
 
+${OBJECTDIR}/ReplacementSim.o: ReplacementSim.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/ReplacementSim.o ReplacementSim.cpp
+
+${OBJECTDIR}/SharedMemory.o: SharedMemory.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/SharedMemory.o SharedMemory.cpp
+
+${OBJECTDIR}/SlabAllocator.o: SlabAllocator.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/SlabAllocator.o SlabAllocator.cpp
+
+${OBJECTDIR}/SwapFile.o: SwapFile.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/SwapFile.o SwapFile.cpp
+
 ${OBJECTDIR}/main.o: main.cpp
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
@@ -85,6 +152,213 @@ ${OBJECTDIR}/main.o: main.cpp
 .build-subprojects:
 	cd ../MemorySubsystemF2018 && ${MAKE}  -f Makefile CONF=Debug
 
+# Build Test Targets
+.build-tests-conf: .build-tests-subprojects .build-conf ${TESTFILES}
+.build-tests-subprojects:
+
+${TESTDIR}/TestFiles/f1: ${TESTDIR}/tests/BitmapAllocatorTests.o ${TESTDIR}/tests/BuddyAllocatorTests.o ${TESTDIR}/tests/FrameCacheTests.o ${TESTDIR}/tests/MemoryAllocatorTests.o ${TESTDIR}/tests/PagerTests.o ${TESTDIR}/tests/ReplacementSimTests.o ${TESTDIR}/tests/SharedMemoryTests.o ${TESTDIR}/tests/SlabAllocatorTests.o ${TESTDIR}/tests/SwapFileTests.o ${OBJECTFILES:%.o=%_nomain.o}
+	${MKDIR} -p ${TESTDIR}/TestFiles
+	${LINK.cc} -o ${TESTDIR}/TestFiles/f1 $^ ${LDLIBSOPTIONS}   -L/usr/src/gtest -L/usr/lib/x86_64-linux-gnu -lgtest -lgtest_main -lpthread 
+
+
+${TESTDIR}/tests/BitmapAllocatorTests.o: tests/BitmapAllocatorTests.cpp 
+	${MKDIR} -p ${TESTDIR}/tests
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I. -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${TESTDIR}/tests/BitmapAllocatorTests.o tests/BitmapAllocatorTests.cpp
+
+${TESTDIR}/tests/BuddyAllocatorTests.o: tests/BuddyAllocatorTests.cpp 
+	${MKDIR} -p ${TESTDIR}/tests
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I. -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${TESTDIR}/tests/BuddyAllocatorTests.o tests/BuddyAllocatorTests.cpp
+
+${TESTDIR}/tests/FrameCacheTests.o: tests/FrameCacheTests.cpp 
+	${MKDIR} -p ${TESTDIR}/tests
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I. -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${TESTDIR}/tests/FrameCacheTests.o tests/FrameCacheTests.cpp
+
+${TESTDIR}/tests/MemoryAllocatorTests.o: tests/MemoryAllocatorTests.cpp 
+	${MKDIR} -p ${TESTDIR}/tests
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I. -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${TESTDIR}/tests/MemoryAllocatorTests.o tests/MemoryAllocatorTests.cpp
+
+${TESTDIR}/tests/PagerTests.o: tests/PagerTests.cpp 
+	${MKDIR} -p ${TESTDIR}/tests
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I. -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${TESTDIR}/tests/PagerTests.o tests/PagerTests.cpp
+
+${TESTDIR}/tests/ReplacementSimTests.o: tests/ReplacementSimTests.cpp 
+	${MKDIR} -p ${TESTDIR}/tests
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I. -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${TESTDIR}/tests/ReplacementSimTests.o tests/ReplacementSimTests.cpp
+
+${TESTDIR}/tests/SharedMemoryTests.o: tests/SharedMemoryTests.cpp 
+	${MKDIR} -p ${TESTDIR}/tests
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I. -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${TESTDIR}/tests/SharedMemoryTests.o tests/SharedMemoryTests.cpp
+
+${TESTDIR}/tests/SlabAllocatorTests.o: tests/SlabAllocatorTests.cpp 
+	${MKDIR} -p ${TESTDIR}/tests
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I. -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${TESTDIR}/tests/SlabAllocatorTests.o tests/SlabAllocatorTests.cpp
+
+${TESTDIR}/tests/SwapFileTests.o: tests/SwapFileTests.cpp 
+	${MKDIR} -p ${TESTDIR}/tests
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -I. -I../MemorySubsystemF2018 -std=c++14 -MMD -MP -MF "$@.d" -o ${TESTDIR}/tests/SwapFileTests.o tests/SwapFileTests.cpp
+
+
+${OBJECTDIR}/BitmapAllocator_nomain.o: ${OBJECTDIR}/BitmapAllocator.o BitmapAllocator.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/BitmapAllocator.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/BitmapAllocator_nomain.o BitmapAllocator.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/BitmapAllocator.o ${OBJECTDIR}/BitmapAllocator_nomain.o;\
+	fi
+
+${OBJECTDIR}/BuddyAllocator_nomain.o: ${OBJECTDIR}/BuddyAllocator.o BuddyAllocator.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/BuddyAllocator.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/BuddyAllocator_nomain.o BuddyAllocator.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/BuddyAllocator.o ${OBJECTDIR}/BuddyAllocator_nomain.o;\
+	fi
+
+${OBJECTDIR}/FrameCache_nomain.o: ${OBJECTDIR}/FrameCache.o FrameCache.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/FrameCache.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/FrameCache_nomain.o FrameCache.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/FrameCache.o ${OBJECTDIR}/FrameCache_nomain.o;\
+	fi
+
+${OBJECTDIR}/MemoryAllocator_nomain.o: ${OBJECTDIR}/MemoryAllocator.o MemoryAllocator.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/MemoryAllocator.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/MemoryAllocator_nomain.o MemoryAllocator.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/MemoryAllocator.o ${OBJECTDIR}/MemoryAllocator_nomain.o;\
+	fi
+
+${OBJECTDIR}/Pager_nomain.o: ${OBJECTDIR}/Pager.o Pager.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/Pager.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/Pager_nomain.o Pager.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/Pager.o ${OBJECTDIR}/Pager_nomain.o;\
+	fi
+
+${OBJECTDIR}/Process_nomain.o: ${OBJECTDIR}/Process.o Process.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/Process.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/Process_nomain.o Process.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/Process.o ${OBJECTDIR}/Process_nomain.o;\
+	fi
+
+${OBJECTDIR}/ReplacementSim_nomain.o: ${OBJECTDIR}/ReplacementSim.o ReplacementSim.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/ReplacementSim.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/ReplacementSim_nomain.o ReplacementSim.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/ReplacementSim.o ${OBJECTDIR}/ReplacementSim_nomain.o;\
+	fi
+
+${OBJECTDIR}/SharedMemory_nomain.o: ${OBJECTDIR}/SharedMemory.o SharedMemory.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/SharedMemory.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/SharedMemory_nomain.o SharedMemory.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/SharedMemory.o ${OBJECTDIR}/SharedMemory_nomain.o;\
+	fi
+
+${OBJECTDIR}/SlabAllocator_nomain.o: ${OBJECTDIR}/SlabAllocator.o SlabAllocator.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/SlabAllocator.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/SlabAllocator_nomain.o SlabAllocator.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/SlabAllocator.o ${OBJECTDIR}/SlabAllocator_nomain.o;\
+	fi
+
+${OBJECTDIR}/SwapFile_nomain.o: ${OBJECTDIR}/SwapFile.o SwapFile.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/SwapFile.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/SwapFile_nomain.o SwapFile.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/SwapFile.o ${OBJECTDIR}/SwapFile_nomain.o;\
+	fi
+
+${OBJECTDIR}/main_nomain.o: ${OBJECTDIR}/main.o main.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/main.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -I../MemorySubsystemF2018 -std=c++14 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/main_nomain.o main.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/main.o ${OBJECTDIR}/main_nomain.o;\
+	fi
+
+# Run Test Targets
+.test-conf:
+	@if [ "${TEST}" = "" ]; \
+	then  \
+	    ${TESTDIR}/TestFiles/f1 || true; \
+	else  \
+	    ./${TEST} || true; \
+	fi
+
 # Clean Targets
 .clean-conf: ${CLEAN_SUBPROJECTS}
 	${RM} -r ${CND_BUILDDIR}/${CND_CONF}
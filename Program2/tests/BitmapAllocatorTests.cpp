@@ -0,0 +1,92 @@
+/*
+ * File:   BitmapAllocatorTests.cpp
+ */
+#include "../BitmapAllocator.h"
+
+#include <MMU.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+using namespace mem;
+
+TEST(BitmapAllocatorTests, WrapAround) {
+  MMU vm(5000);
+  BitmapAllocator bitmap(&vm);
+  uint32_t total = bitmap.get_page_frames_free();
+  EXPECT_EQ(5000 - bitmap.get_header_frames(), total);
+  
+  std::vector<uint32_t> frames;
+  ASSERT_TRUE(bitmap.AllocatePageFrames(3, frames, 1000));
+  EXPECT_EQ(std::vector<uint32_t>({ 1000 * kPageSize, 1001 * kPageSize,
+                                    1002 * kPageSize }), frames);
+  
+  // Searching from near the end wraps around to the low frames
+  std::vector<uint32_t> frames2;
+  ASSERT_TRUE(bitmap.AllocatePageFrames(20, frames2, 4990));
+  EXPECT_EQ(4990 * kPageSize, frames2[0]);
+  EXPECT_EQ(4999 * kPageSize, frames2[9]);
+  EXPECT_EQ(bitmap.get_header_frames() * kPageSize, frames2[10]);
+  
+  ASSERT_TRUE(bitmap.AllocatePageFrames(total - 23, frames, 2500));
+  EXPECT_EQ(0, bitmap.get_page_frames_free());
+  EXPECT_FALSE(bitmap.AllocatePageFrames(1, frames));
+  frames.insert(frames.end(), frames2.begin(), frames2.end());
+  EXPECT_EQ(total, std::set<uint32_t>(frames.begin(), frames.end()).size());
+  
+  EXPECT_TRUE(bitmap.FreePageFrames(total, frames));
+  EXPECT_EQ(total, bitmap.get_page_frames_free());
+}
+
+TEST(BitmapAllocatorTests, DoubleFree) {
+  MMU vm(256);
+  BitmapAllocator bitmap(&vm);
+  uint32_t total = bitmap.get_page_frames_free();
+  std::vector<uint32_t> frames;
+  ASSERT_TRUE(bitmap.AllocatePageFrames(4, frames));
+  
+  // A frame listed twice frees nothing
+  std::vector<uint32_t> twice({ frames[0], frames[1], frames[0] });
+  EXPECT_THROW(bitmap.FreePageFrames(3, twice), std::runtime_error);
+  EXPECT_EQ(total - 4, bitmap.get_page_frames_free());
+  EXPECT_FALSE(bitmap.is_frame_free(frames[1]));
+  
+  std::vector<uint32_t> freed({ frames[3] });
+  EXPECT_TRUE(bitmap.FreePageFrames(1, freed));
+  freed.push_back(frames[3]);
+  EXPECT_THROW(bitmap.FreePageFrames(1, freed), std::runtime_error);
+  std::vector<uint32_t> header({ 0 });
+  EXPECT_THROW(bitmap.FreePageFrames(1, header), std::runtime_error);
+  std::vector<uint32_t> unaligned({ frames[0] + 1 });
+  EXPECT_THROW(bitmap.FreePageFrames(1, unaligned), std::runtime_error);
+  EXPECT_EQ(total - 3, bitmap.get_page_frames_free());
+}
+
+TEST(BitmapAllocatorTests, Random) {
+  MMU vm(5000);
+  BitmapAllocator bitmap(&vm);
+  uint32_t total = bitmap.get_page_frames_free();
+  std::vector<uint32_t> frames;
+  std::mt19937 rng(2);
+  for (int i = 0; i < 2000; ++i) {
+    if (rng() % 2 && !frames.empty()) {
+      uint32_t count = std::min<size_t>(frames.size(), rng() % 70 + 1);
+      ASSERT_TRUE(bitmap.FreePageFrames(count, frames));
+    } else {
+      uint32_t count = rng() % 70 + 1;
+      std::vector<uint32_t> allocated;
+      if (bitmap.AllocatePageFrames(count, allocated, rng() % 5000)) {
+        ASSERT_EQ(count, allocated.size());
+        frames.insert(frames.end(), allocated.begin(), allocated.end());
+      }
+    }
+    ASSERT_EQ(frames.size(),
+              std::set<uint32_t>(frames.begin(), frames.end()).size());
+    ASSERT_EQ(total, bitmap.get_page_frames_free() + frames.size());
+  }
+}
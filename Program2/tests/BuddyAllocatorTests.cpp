@@ -0,0 +1,93 @@
+/*
+ * File:   BuddyAllocatorTests.cpp
+ */
+#include "../BuddyAllocator.h"
+
+#include <MMU.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+
+using namespace mem;
+
+TEST(BuddyAllocatorTests, SplitCoalesce) {
+  MMU vm(256);
+  // Header at frame 4, blocks from frame 5 to frame 203
+  BuddyAllocator buddy(&vm, 4, 200);
+  EXPECT_EQ(199, buddy.get_page_frames_free());
+  EXPECT_EQ(6, buddy.get_max_order());
+  
+  // Frames 64 to 191 form the two order 6 blocks
+  EXPECT_EQ(2, buddy.get_free_block_count(6));
+  uint32_t block;
+  ASSERT_TRUE(buddy.AllocateBlock(0, block));
+  EXPECT_EQ(5 * kPageSize, block);
+  uint32_t block2;
+  ASSERT_TRUE(buddy.AllocateBlock(4, block2));
+  EXPECT_EQ(0, (block2 / kPageSize) % 16);
+  EXPECT_EQ(199 - 17, buddy.get_page_frames_free());
+  
+  buddy.FreeBlock(block2);
+  buddy.FreeBlock(block);
+  EXPECT_EQ(199, buddy.get_page_frames_free());
+  EXPECT_EQ(2, buddy.get_free_block_count(6));
+  BuddyAllocator::BuddyStats stats;
+  buddy.get_stats(stats);
+  EXPECT_EQ(stats.splits, stats.merges);
+  EXPECT_THROW(buddy.FreeBlock(block), std::runtime_error);
+  EXPECT_THROW(buddy.FreeBlock(block + 1), std::runtime_error);
+}
+
+TEST(BuddyAllocatorTests, RandomAlignment) {
+  MMU vm(256);
+  BuddyAllocator buddy(&vm, 4, 200);
+  uint32_t total = buddy.get_page_frames_free();
+  std::mt19937 rng(1);
+  std::map<uint32_t, uint32_t> live;  // block -> order
+  std::set<uint32_t> used;
+  for (int i = 0; i < 5000; ++i) {
+    if (live.empty() || rng() % 2) {
+      uint32_t order = rng() % 5;
+      uint32_t block;
+      if (buddy.AllocateBlock(order, block)) {
+        ASSERT_EQ(0, (block / kPageSize) % (1u << order));
+        for (uint32_t f = 0; f < (1u << order); ++f) {
+          ASSERT_TRUE(used.insert(block + f * kPageSize).second);
+        }
+        live[block] = order;
+      }
+    } else {
+      auto it = live.begin();
+      std::advance(it, rng() % live.size());
+      buddy.FreeBlock(it->first);
+      for (uint32_t f = 0; f < (1u << it->second); ++f) {
+        used.erase(it->first + f * kPageSize);
+      }
+      live.erase(it);
+    }
+    ASSERT_EQ(total, buddy.get_page_frames_free() + used.size());
+  }
+  for (auto &l : live) buddy.FreeBlock(l.first);
+  BuddyAllocator::FragmentationStats stats;
+  buddy.get_fragmentation_stats(stats);
+  EXPECT_EQ(total, stats.free_frames);
+  EXPECT_EQ(6, stats.largest_free_order);
+}
+
+TEST(BuddyAllocatorTests, LargeCounts) {
+  MMU vm(64);
+  BuddyAllocator buddy(&vm, 0, 64);
+  uint32_t block;
+  EXPECT_FALSE(buddy.AllocateFrames(64, block));
+  EXPECT_FALSE(buddy.AllocateFrames(0x80000001, block));
+  EXPECT_FALSE(buddy.AllocateFrames(0xffffffff, block));
+  EXPECT_TRUE(buddy.AllocateFrames(3, block));
+  EXPECT_EQ(0, (block / kPageSize) % 4);
+  EXPECT_EQ(31, BuddyAllocator::order_for(0x80000000));
+  EXPECT_THROW(BuddyAllocator::order_for(0x80000001), std::runtime_error);
+  EXPECT_THROW(BuddyAllocator::order_for(0), std::runtime_error);
+}
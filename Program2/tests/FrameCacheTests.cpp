@@ -0,0 +1,77 @@
+/*
+ * File:   FrameCacheTests.cpp
+ */
+#include "../FrameCache.h"
+#include "../MemoryAllocator.h"
+
+#include <MMU.h>
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace mem;
+
+TEST(FrameCacheTests, CrossThreadExhaustion) {
+  MMU vm(64);
+  MemoryAllocator allocator(&vm);
+  FrameCache cache(&allocator, 4);
+  std::vector<uint32_t> frames;
+  while (cache.AllocatePageFrames(1, frames)) {}
+  ASSERT_EQ(63, frames.size());
+  
+  // Another thread frees every frame; its magazines keep some of them
+  std::thread freeing([&cache, &frames] {
+    EXPECT_TRUE(cache.FreePageFrames(frames.size(), frames));
+  });
+  freeing.join();
+  EXPECT_TRUE(frames.empty());
+  
+  // This thread gets them all back: from the depot, the allocator, and
+  // the other thread's magazines
+  while (cache.AllocatePageFrames(1, frames)) {}
+  EXPECT_EQ(63, frames.size());
+  EXPECT_EQ(63, std::set<uint32_t>(frames.begin(), frames.end()).size());
+  FrameCache::CacheStats stats;
+  cache.get_stats(stats);
+  EXPECT_LT(0, stats.depot_puts);
+  EXPECT_EQ(stats.depot_puts, stats.depot_gets);
+  EXPECT_LT(0, stats.steals);
+  EXPECT_EQ(0, allocator.get_page_frames_free());
+}
+
+TEST(FrameCacheTests, LargeRequestEmptiesDepot) {
+  MMU vm(64);
+  MemoryAllocator allocator(&vm);
+  FrameCache cache(&allocator, 4);
+  std::vector<uint32_t> frames;
+  while (cache.AllocatePageFrames(1, frames)) {}
+  ASSERT_TRUE(cache.FreePageFrames(frames.size(), frames));
+  EXPECT_GT(40, allocator.get_page_frames_free());
+  
+  // Larger than a magazine: served by the allocator once the depot is back
+  EXPECT_TRUE(cache.AllocatePageFrames(40, frames));
+  EXPECT_EQ(40, frames.size());
+  ASSERT_TRUE(cache.FreePageFrames(frames.size(), frames));
+}
+
+TEST(FrameCacheTests, DestroyReturnsFrames) {
+  MMU vm(64);
+  MemoryAllocator allocator(&vm);
+  for (int i = 0; i < 3; ++i) {
+    FrameCache cache(&allocator, 4);
+    std::vector<uint32_t> frames;
+    std::thread other([&cache] {
+      std::vector<uint32_t> frames;
+      EXPECT_TRUE(cache.AllocatePageFrames(4, frames));
+      EXPECT_TRUE(cache.FreePageFrames(4, frames));
+    });
+    other.join();
+    while (cache.AllocatePageFrames(1, frames)) {}
+    EXPECT_EQ(63, frames.size());
+    ASSERT_TRUE(cache.FreePageFrames(frames.size(), frames));
+  }
+  EXPECT_EQ(63, allocator.get_page_frames_free());
+}
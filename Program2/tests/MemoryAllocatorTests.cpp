@@ -0,0 +1,202 @@
+/*
+ * File:   MemoryAllocatorTests.cpp
+ */
+#include "../MemoryAllocator.h"
+
+#include <MMU.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace mem;
+
+TEST(MemoryAllocatorTests, ProcessIdReuse) {
+  MMU vm(64);
+  MemoryAllocator allocator(&vm);
+  EXPECT_EQ(0, allocator.CreateProcess());
+  EXPECT_EQ(1, allocator.CreateProcess());
+  EXPECT_EQ(2, allocator.CreateProcess());
+  EXPECT_TRUE(allocator.AllocateProcessPageFrames(1, 5));
+  
+  // The lowest destroyed id is reused first
+  allocator.DestroyProcess(2);
+  allocator.DestroyProcess(1);
+  EXPECT_EQ(1, allocator.get_process_count());
+  EXPECT_EQ(63, allocator.get_page_frames_free());
+  EXPECT_THROW(allocator.AllocateProcessPageFrames(1, 1), std::runtime_error);
+  EXPECT_THROW(allocator.DestroyProcess(2), std::runtime_error);
+  EXPECT_EQ(1, allocator.CreateProcess());
+  EXPECT_TRUE(allocator.get_process_vector(1).empty());
+  EXPECT_EQ(2, allocator.CreateProcess());
+  EXPECT_EQ(3, allocator.get_process_count());
+  
+  EXPECT_THROW(allocator.get_process_vector(-1), std::runtime_error);
+  EXPECT_THROW(allocator.get_process_vector(3), std::runtime_error);
+}
+
+TEST(MemoryAllocatorTests, FreeProcessPageFrame) {
+  MMU vm(64);
+  MemoryAllocator allocator(&vm);
+  int process = allocator.CreateProcess();
+  int other = allocator.CreateProcess();
+  ASSERT_TRUE(allocator.AllocateProcessPageFrames(process, 4));
+  ASSERT_TRUE(allocator.AllocateProcessPageFrames(other, 1));
+  std::vector<uint32_t> frames = allocator.get_process_vector(process);
+  
+  // The last frame takes the freed frame's place
+  allocator.FreeProcessPageFrame(process, frames[1]);
+  EXPECT_EQ(std::vector<uint32_t>({ frames[0], frames[3], frames[2] }),
+            allocator.get_process_vector(process));
+  EXPECT_EQ(59, allocator.get_page_frames_free());
+  EXPECT_THROW(allocator.FreeProcessPageFrame(process, frames[1]),
+               std::runtime_error);
+  EXPECT_THROW(allocator.FreeProcessPageFrame(
+                   process, allocator.get_process_vector(other)[0]),
+               std::runtime_error);
+  
+  // Frames keep their positions through later allocations and frees
+  allocator.FreeProcessPageFrame(process, frames[2]);
+  ASSERT_TRUE(allocator.AllocateProcessPageFrames(process, 1));
+  allocator.FreeProcessPageFrame(process, frames[0]);
+  std::vector<uint32_t> left = allocator.get_process_vector(process);
+  ASSERT_EQ(2, left.size());
+  EXPECT_EQ(frames[3], left[1]);
+  allocator.FreeProcessPageFrame(process, left[0]);
+  allocator.FreeProcessPageFrame(process, frames[3]);
+  EXPECT_TRUE(allocator.get_process_vector(process).empty());
+  EXPECT_EQ(62, allocator.get_page_frames_free());
+}
+
+TEST(MemoryAllocatorTests, HostMetadata) {
+  for (auto mode : { MemoryAllocator::MetadataMode::kInMemory,
+                     MemoryAllocator::MetadataMode::kHost }) {
+    MMU vm(256);
+    std::vector<uint8_t> pattern(256 * kPageSize);
+    for (size_t i = 0; i < pattern.size(); ++i) pattern[i] = i * 7;
+    vm.get_physical_memory().put_bytes(0, pattern.size(), pattern.data());
+    MemoryAllocator allocator(&vm, mode);
+    bool host = mode == MemoryAllocator::MetadataMode::kHost;
+    uint32_t total = host ? 256 : 255;
+    EXPECT_EQ(total, allocator.get_page_frames_free());
+    
+    std::mt19937 rng(2);
+    std::vector<uint32_t> frames;
+    for (int i = 0; i < 2000; ++i) {
+      uint32_t count = rng() % 20 + 1;
+      if (rng() % 2) {
+        allocator.AllocatePageFrames(count, frames);
+      } else {
+        allocator.FreePageFrames(std::min<size_t>(count, frames.size()), frames);
+      }
+      ASSERT_EQ(frames.size(),
+                std::set<uint32_t>(frames.begin(), frames.end()).size());
+      ASSERT_EQ(total, allocator.get_page_frames_free() + frames.size());
+    }
+    int process = allocator.CreateProcess();
+    EXPECT_TRUE(allocator.AllocateProcessPageFrames(process, 5));
+    allocator.DestroyProcess(process);
+    
+    // Host metadata leaves the simulated memory untouched
+    std::vector<uint8_t> contents(pattern.size());
+    vm.get_physical_memory().get_bytes(contents.data(), 0, contents.size());
+    EXPECT_EQ(host, contents == pattern);
+    allocator.FreePageFrames(frames.size(), frames);
+    EXPECT_EQ(total, allocator.get_page_frames_free());
+  }
+}
+
+TEST(MemoryAllocatorTests, ArrayBulk) {
+  MMU vm(64);
+  vm.get_physical_memory().set_banks({ PhysicalMemory::BankConfig(32, 1, 3),
+                                       PhysicalMemory::BankConfig(32, 1, 3) });
+  MemoryAllocator allocator(&vm);
+  uint32_t frames[40];
+  EXPECT_FALSE(allocator.AllocatePageFrames(40, frames,
+      MemoryAllocator::PlacementPolicy(1, MemoryAllocator::Placement::kBind)));
+  EXPECT_EQ(63, allocator.get_page_frames_free());
+  ASSERT_TRUE(allocator.AllocatePageFrames(40, frames,
+      MemoryAllocator::PlacementPolicy(1, MemoryAllocator::Placement::kInterleave)));
+  EXPECT_EQ(23, allocator.get_page_frames_free());
+  EXPECT_EQ(40, std::set<uint32_t>(frames, frames + 40).size());
+  
+  // Each frame goes back to its own node; frames[0] is allocated next
+  allocator.FreePageFrames(40, frames);
+  EXPECT_EQ(31, allocator.get_node_page_frames_free(0));
+  EXPECT_EQ(32, allocator.get_node_page_frames_free(1));
+  uint32_t frame;
+  ASSERT_TRUE(allocator.AllocatePageFrames(1, &frame,
+      MemoryAllocator::PlacementPolicy(frames[0] / kPageSize / 32)));
+  EXPECT_EQ(frames[0], frame);
+}
+
+TEST(MemoryAllocatorTests, TeardownRuns) {
+  MMU vm(64);
+  MemoryAllocator allocator(&vm, MemoryAllocator::MetadataMode::kHost);
+  int process = allocator.CreateProcess();
+  ASSERT_TRUE(allocator.AllocateProcessPageFrames(process, 5));
+  ASSERT_TRUE(allocator.AllocateProcessPageFrames(process, 3));
+  std::vector<uint32_t> frames = allocator.get_process_vector(process);
+  
+  // Each allocation's run is spliced back whole, so the last run is first
+  allocator.DestroyProcess(process);
+  EXPECT_EQ(64, allocator.get_page_frames_free());
+  std::vector<uint32_t> reallocated;
+  ASSERT_TRUE(allocator.AllocatePageFrames(8, reallocated));
+  EXPECT_EQ(std::vector<uint32_t>(frames.begin() + 5, frames.end()),
+            std::vector<uint32_t>(reallocated.begin(), reallocated.begin() + 3));
+  EXPECT_EQ(std::vector<uint32_t>(frames.begin(), frames.begin() + 5),
+            std::vector<uint32_t>(reallocated.begin() + 3, reallocated.end()));
+  allocator.FreePageFrames(8, reallocated);
+}
+
+TEST(MemoryAllocatorTests, TeardownRunsRandom) {
+  MMU vm(512);
+  vm.get_physical_memory().set_banks({ PhysicalMemory::BankConfig(200, 1, 3),
+                                       PhysicalMemory::BankConfig(112, 1, 3),
+                                       PhysicalMemory::BankConfig(200, 1, 3) });
+  MemoryAllocator allocator(&vm, MemoryAllocator::MetadataMode::kHost);
+  std::mt19937 rng(1);
+  for (int round = 0; round < 50; ++round) {
+    std::vector<int> processes;
+    std::vector<uint32_t> loose;
+    for (int i = 0; i < 4; ++i) {
+      processes.push_back(allocator.CreateProcess(MemoryAllocator::PlacementPolicy(
+          rng() % 3, MemoryAllocator::Placement(rng() % 3))));
+    }
+    for (int i = 0; i < 40; ++i) {
+      if (rng() % 4 == 0) {
+        allocator.AllocatePageFrames(rng() % 5 + 1, loose);
+      } else {
+        allocator.AllocateProcessPageFrames(processes[rng() % 4], rng() % 9 + 1);
+      }
+      if (rng() % 5 == 0 && !loose.empty()) allocator.FreePageFrames(1, loose);
+    }
+    for (int process : processes) allocator.DestroyProcess(process);
+    
+    // Every free frame is on a free list exactly once
+    std::istringstream free_list(allocator.get_free_list_string());
+    std::set<std::string> listed;
+    std::string frame;
+    size_t count = 0;
+    while (free_list >> frame) {
+      listed.insert(frame);
+      ++count;
+    }
+    ASSERT_EQ(count, listed.size());
+    ASSERT_EQ(512 - loose.size(), count);
+    ASSERT_EQ(512 - loose.size(), allocator.get_page_frames_free());
+    uint32_t node_free = 0;
+    for (uint32_t node = 0; node < 3; ++node) {
+      node_free += allocator.get_node_page_frames_free(node);
+    }
+    ASSERT_EQ(512 - loose.size(), node_free);
+    allocator.FreePageFrames(loose.size(), loose);
+  }
+}
@@ -0,0 +1,161 @@
+/*
+ * File:   PagerTests.cpp
+ */
+#include "../Pager.h"
+#include "../MemoryAllocator.h"
+
+#include <MMU.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace mem;
+
+namespace {
+
+const char *kSwapFileName = "PagerTests.swap";
+
+}
+
+class PagerTests : public ::testing::Test {
+protected:
+  PagerTests() : vm(64, 16), allocator(&vm) {
+    allocator.AllocatePageFrames(3, page_tables);
+    
+    // Kernel maps all of memory; the user page tables start empty
+    PageTable page_table;
+    for (Addr i = 0; i < 64; ++i) {
+      page_table[i] = (i << kPageSizeBits) | kPTE_PresentMask | kPTE_WritableMask;
+    }
+    vm.put_bytes(page_tables[0], kPageTableSizeBytes, &page_table);
+    page_table.fill(0);
+    vm.put_bytes(page_tables[1], kPageTableSizeBytes, &page_table);
+    vm.put_bytes(page_tables[2], kPageTableSizeBytes, &page_table);
+    vm.enter_virtual_mode(PMCB(page_tables[0]));
+  }
+  
+  ~PagerTests() {
+    std::remove(kSwapFileName);
+  }
+  
+  std::shared_ptr<Pager> MakePager(Pager::ReplacementPolicy policy,
+                                   uint32_t swap_workers = 0) {
+    auto pager = std::make_shared<Pager>(&vm, &allocator, kSwapFileName,
+                                         policy, 8, swap_workers);
+    vm.SetPageFaultHandler(pager);
+    return pager;
+  }
+  
+  void UsePageTable(int page_table) {
+    vm.set_user_PMCB(PMCB(page_tables[page_table]));
+    vm.FlushTLB();
+  }
+  
+  uint32_t Read(Addr vaddress) {
+    uint32_t value;
+    EXPECT_TRUE(vm.get_bytes(&value, vaddress, sizeof(value)));
+    return value;
+  }
+  
+  void Write(Addr vaddress, uint32_t value) {
+    EXPECT_TRUE(vm.put_bytes(vaddress, sizeof(value), &value));
+  }
+  
+  MMU vm;
+  MemoryAllocator allocator;
+  std::vector<uint32_t> page_tables;
+};
+
+TEST_F(PagerTests, SwapRoundTrip) {
+  for (auto policy : { Pager::ReplacementPolicy::kClock,
+                       Pager::ReplacementPolicy::kLRU,
+                       Pager::ReplacementPolicy::kFIFO,
+                       Pager::ReplacementPolicy::kAging }) {
+    for (uint32_t workers = 0; workers < 2; ++workers) {
+      SCOPED_TRACE(int(policy) * 2 + workers);
+      uint32_t free_frames = allocator.get_page_frames_free();
+      auto pager = MakePager(policy, workers);
+      pager->MapPages(page_tables[1], 0, 40, true);
+      UsePageTable(1);
+      
+      // Skewed accesses to 40 pages through 8 frames
+      std::mt19937 rng(static_cast<int>(policy));
+      std::vector<uint32_t> values(40, 0);
+      for (int i = 0; i < 3000; ++i) {
+        uint32_t page = rng() % 10 < 8 ? rng() % 6 : rng() % 40;
+        if (rng() % 3 == 0) {
+          values[page] = rng();
+          Write(page * kPageSize + 100, values[page]);
+        } else {
+          ASSERT_EQ(values[page], Read(page * kPageSize + 100));
+        }
+        if (i % 20 == 0) pager->Sample();
+      }
+      Pager::PagerStats stats;
+      pager->get_stats(stats);
+      EXPECT_LT(0, stats.swap_ins);
+      EXPECT_LT(0, stats.swap_outs);
+      EXPECT_EQ(stats.faults, stats.zero_fills + stats.swap_ins);
+      EXPECT_EQ(8, pager->get_resident_count());
+      
+      vm.set_kernel_PMCB();
+      pager->RemovePageTable(page_tables[1]);
+      EXPECT_EQ(0, pager->get_resident_count());
+      EXPECT_EQ(0, pager->get_swapped_count());
+      EXPECT_EQ(free_frames, allocator.get_page_frames_free());
+      vm.SetPageFaultHandler(nullptr);
+    }
+  }
+}
+
+TEST_F(PagerTests, Fork) {
+  auto pager = MakePager(Pager::ReplacementPolicy::kFIFO);
+  pager->MapPages(page_tables[1], 0, 20, true);
+  UsePageTable(1);
+  for (uint32_t page = 0; page < 12; ++page) {
+    Write(page * kPageSize, page + 1);
+  }
+  EXPECT_EQ(8, pager->get_resident_count());
+  uint32_t swapped = pager->get_swapped_count();
+  
+  // The child gets its own swap copy of each page the parent has
+  vm.set_kernel_PMCB();
+  pager->ForkPageTable(page_tables[1], page_tables[2]);
+  EXPECT_EQ(swapped + 12, pager->get_swapped_count());
+  
+  // Parent writes go to its own frames, without copy-on-write
+  UsePageTable(1);
+  for (uint32_t page = 0; page < 12; ++page) {
+    Write(page * kPageSize, 100 + page);
+  }
+  UsePageTable(2);
+  for (uint32_t page = 0; page < 12; ++page) {
+    ASSERT_EQ(page + 1, Read(page * kPageSize));
+    Write(page * kPageSize, 200 + page);
+  }
+  EXPECT_EQ(0, Read(15 * kPageSize));
+  UsePageTable(1);
+  for (uint32_t page = 0; page < 12; ++page) {
+    ASSERT_EQ(100 + page, Read(page * kPageSize));
+  }
+  MMU::CopyOnWriteStats cow_stats;
+  vm.get_CopyOnWriteStats(cow_stats);
+  EXPECT_EQ(0, cow_stats.frames_copied);
+  
+  // Each page table's pages are freed independently
+  vm.set_kernel_PMCB();
+  pager->RemovePageTable(page_tables[1]);
+  UsePageTable(2);
+  for (uint32_t page = 0; page < 12; ++page) {
+    ASSERT_EQ(200 + page, Read(page * kPageSize));
+  }
+  vm.set_kernel_PMCB();
+  pager->RemovePageTable(page_tables[2]);
+  EXPECT_EQ(0, pager->get_resident_count());
+  EXPECT_EQ(0, pager->get_swapped_count());
+  EXPECT_EQ(60, allocator.get_page_frames_free());
+}
@@ -0,0 +1,83 @@
+/*
+ * File:   ReplacementSimTests.cpp
+ */
+#include "../ReplacementSim.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <sstream>
+#include <vector>
+
+TEST(ReplacementSimTests, MatchesReference) {
+  std::mt19937 rng(9);
+  for (int trace = 0; trace < 50; ++trace) {
+    ReplacementSim sim;
+    std::vector<uint32_t> pages;
+    uint32_t page_count = 1 + rng() % 20;
+    uint32_t reference_count = 1 + rng() % 300;
+    for (uint32_t i = 0; i < reference_count; ++i) {
+      uint32_t page = rng() % page_count;
+      pages.push_back(page);
+      sim.AddReference(page * 0x2000 + rng() % 0x2000, rng() % 2);
+    }
+    for (uint32_t frames = 1; frames <= page_count + 1; ++frames) {
+      // Straightforward LRU, FIFO and OPT on the page numbers
+      std::vector<uint32_t> lru;
+      std::deque<uint32_t> fifo;
+      std::vector<uint32_t> opt;
+      uint64_t lru_faults = 0, fifo_faults = 0, opt_faults = 0;
+      for (size_t i = 0; i < pages.size(); ++i) {
+        auto found = std::find(lru.begin(), lru.end(), pages[i]);
+        if (found != lru.end()) {
+          lru.erase(found);
+        } else {
+          ++lru_faults;
+          if (lru.size() == frames) lru.erase(lru.begin());
+        }
+        lru.push_back(pages[i]);
+        
+        if (std::find(fifo.begin(), fifo.end(), pages[i]) == fifo.end()) {
+          ++fifo_faults;
+          if (fifo.size() == frames) fifo.pop_front();
+          fifo.push_back(pages[i]);
+        }
+        
+        if (std::find(opt.begin(), opt.end(), pages[i]) == opt.end()) {
+          ++opt_faults;
+          if (opt.size() == frames) {
+            size_t victim = 0, victim_next = 0;
+            for (size_t k = 0; k < opt.size(); ++k) {
+              size_t next = i + 1;
+              while (next < pages.size() && pages[next] != opt[k]) ++next;
+              if (next >= victim_next) {
+                victim_next = next;
+                victim = k;
+              }
+            }
+            opt.erase(opt.begin() + victim);
+          }
+          opt.push_back(pages[i]);
+        }
+      }
+      ASSERT_EQ(lru_faults, sim.CountFaults(ReplacementSim::Policy::kLRU, frames));
+      ASSERT_EQ(fifo_faults, sim.CountFaults(ReplacementSim::Policy::kFIFO, frames));
+      ASSERT_EQ(opt_faults, sim.CountFaults(ReplacementSim::Policy::kOPT, frames));
+      for (auto policy : ReplacementSim::get_all_policies()) {
+        ASSERT_LE(opt_faults, sim.CountFaults(policy, frames));
+      }
+    }
+  }
+}
+
+TEST(ReplacementSimTests, Trace) {
+  std::istringstream trace("1000 mem\n# comment\n"
+                           "1ff0 sto 1 2 3 4 5 6 7 8 9 a b c d e f 10 11\n"
+                           "0 rep 4000 1\n2000 cpy 10 8000\n\n4000 dmp 1\n");
+  ReplacementSim sim;
+  sim.AddTrace(trace);
+  EXPECT_LT(0, sim.get_reference_count());
+  EXPECT_LE(3, sim.get_page_count());
+}
@@ -0,0 +1,94 @@
+/*
+ * File:   SharedMemoryTests.cpp
+ */
+#include "../SharedMemory.h"
+#include "../MemoryAllocator.h"
+
+#include <MMU.h>
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+using namespace mem;
+
+class SharedMemoryTests : public ::testing::Test {
+protected:
+  SharedMemoryTests() : vm(64), allocator(&vm), shm(&vm, &allocator) {
+    allocator.AllocatePageFrames(3, page_tables);
+    
+    // Kernel maps the first 64 pages; the two user page tables start empty
+    PageTable page_table;
+    for (Addr i = 0; i < 64; ++i) {
+      page_table[i] = (i << kPageSizeBits) | kPTE_PresentMask | kPTE_WritableMask;
+    }
+    vm.put_bytes(page_tables[0], kPageTableSizeBytes, &page_table);
+    page_table.fill(0);
+    vm.put_bytes(page_tables[1], kPageTableSizeBytes, &page_table);
+    vm.put_bytes(page_tables[2], kPageTableSizeBytes, &page_table);
+    vm.enter_virtual_mode(PMCB(page_tables[0]));
+  }
+  
+  MMU vm;
+  MemoryAllocator allocator;
+  SharedMemory shm;
+  std::vector<uint32_t> page_tables;
+};
+
+TEST_F(SharedMemoryTests, StaleUnmap) {
+  int region = shm.CreateRegion(2);
+  shm.Map(region, page_tables[1], 0, true);
+  shm.DestroyRegion(region);
+  shm.Unmap(region, page_tables[1], 0);
+  
+  // The frames are reused by the next region; the old id no longer unmaps
+  int region2 = shm.CreateRegion(2);
+  EXPECT_EQ(shm.get_region_frames(region), shm.get_region_frames(region2));
+  shm.Map(region2, page_tables[1], 0, true);
+  EXPECT_THROW(shm.Unmap(region, page_tables[1], 0), std::runtime_error);
+  EXPECT_EQ(2, shm.get_frame_refcount(shm.get_region_frames(region2)[0]));
+  
+  shm.Unmap(region2, page_tables[1], 0);
+  EXPECT_THROW(shm.Unmap(region2, page_tables[1], 0), std::runtime_error);
+  EXPECT_EQ(1, shm.get_frame_refcount(shm.get_region_frames(region2)[0]));
+}
+
+TEST_F(SharedMemoryTests, ForkKeepsShared) {
+  int region = shm.CreateRegion(2);
+  shm.Map(region, page_tables[1], 0, true);
+  vm.ForkPageTable(page_tables[1], page_tables[2]);
+  
+  // The child's mapping is unknown until ForkMappings records it
+  EXPECT_THROW(shm.Unmap(region, page_tables[2], 0), std::runtime_error);
+  shm.ForkMappings(page_tables[1], page_tables[2]);
+  uint32_t frame = shm.get_region_frames(region)[0];
+  EXPECT_EQ(3, shm.get_frame_refcount(frame));
+  
+  // A write in the parent is seen by the child: no copy-on-write
+  uint32_t value = 0x1234;
+  vm.set_user_PMCB(PMCB(page_tables[1]));
+  vm.FlushTLB();
+  EXPECT_TRUE(vm.put_bytes(8, sizeof(value), &value));
+  vm.set_user_PMCB(PMCB(page_tables[2]));
+  vm.FlushTLB();
+  value = 0;
+  EXPECT_TRUE(vm.get_bytes(&value, 8, sizeof(value)));
+  EXPECT_EQ(0x1234, value);
+  vm.set_kernel_PMCB();
+  vm.FlushTLB();
+  
+  shm.Unmap(region, page_tables[1], 0);
+  shm.DestroyRegion(region);
+  EXPECT_EQ(1, shm.get_frame_refcount(frame));
+  uint32_t free_frames = allocator.get_page_frames_free();
+  shm.Unmap(region, page_tables[2], 0);
+  EXPECT_EQ(free_frames + 2, allocator.get_page_frames_free());
+}
+
+TEST_F(SharedMemoryTests, ChangedMapping) {
+  int region = shm.CreateRegion(1);
+  shm.Map(region, page_tables[1], 0, true);
+  vm.get_physical_memory().put_32(page_tables[1], 0);
+  EXPECT_THROW(shm.Unmap(region, page_tables[1], 0), std::runtime_error);
+}
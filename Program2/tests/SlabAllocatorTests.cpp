@@ -0,0 +1,123 @@
+/*
+ * File:   SlabAllocatorTests.cpp
+ */
+#include "../SlabAllocator.h"
+#include "../MemoryAllocator.h"
+
+#include <MMU.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace mem;
+
+TEST(SlabAllocatorTests, AllocFree) {
+  MMU vm(64);
+  MemoryAllocator allocator(&vm);
+  SlabAllocator slab(&vm, &allocator);
+  uint32_t free_frames = allocator.get_page_frames_free();
+  
+  uint32_t address;
+  ASSERT_TRUE(slab.Allocate(24, address));
+  EXPECT_EQ(0, address % 32);
+  uint32_t address2;
+  ASSERT_TRUE(slab.Allocate(32, address2));
+  EXPECT_EQ(address & ~(kPageSize - 1), address2 & ~(kPageSize - 1));
+  EXPECT_EQ(free_frames - 1, allocator.get_page_frames_free());
+  SlabAllocator::SlabStats stats;
+  slab.get_stats(1, stats);
+  EXPECT_EQ(1, stats.slabs);
+  EXPECT_EQ(2, stats.objects_in_use);
+  
+  slab.Free(address);
+  EXPECT_THROW(slab.Free(address), std::runtime_error);
+  EXPECT_THROW(slab.Free(address2 + 1), std::runtime_error);
+  EXPECT_THROW(slab.Free(0), std::runtime_error);
+  EXPECT_THROW(slab.Allocate(0, address), std::runtime_error);
+  EXPECT_THROW(slab.Allocate(SlabAllocator::max_object_size + 1, address),
+               std::runtime_error);
+  
+  // The last empty slab is kept until released
+  slab.Free(address2);
+  slab.get_stats(1, stats);
+  EXPECT_EQ(1, stats.slabs);
+  EXPECT_EQ(0, stats.objects_in_use);
+  slab.ReleaseEmptySlabs();
+  slab.get_stats(1, stats);
+  EXPECT_EQ(0, stats.slabs);
+  EXPECT_EQ(free_frames, allocator.get_page_frames_free());
+}
+
+TEST(SlabAllocatorTests, RefillsFullSlab) {
+  MMU vm(64);
+  MemoryAllocator allocator(&vm);
+  SlabAllocator slab(&vm, &allocator);
+  SlabAllocator::SlabStats stats;
+  
+  // Fill two 2048 byte slabs and start a third
+  std::vector<uint32_t> objects;
+  uint32_t address;
+  do {
+    ASSERT_TRUE(slab.Allocate(2048, address));
+    objects.push_back(address);
+    slab.get_stats(7, stats);
+  } while (stats.slabs < 3);
+  uint32_t per_slab = (objects.size() - 1) / 2;
+  
+  // A full slab with a freed object is allocated from next
+  slab.Free(objects[0]);
+  ASSERT_TRUE(slab.Allocate(2048, address));
+  EXPECT_EQ(objects[0], address);
+  
+  for (auto object : objects) slab.Free(object);
+  slab.get_stats(7, stats);
+  EXPECT_EQ(1, stats.slabs);
+  EXPECT_EQ(per_slab, stats.object_capacity);
+  slab.ReleaseEmptySlabs();
+  EXPECT_EQ(63, allocator.get_page_frames_free());
+}
+
+TEST(SlabAllocatorTests, Random) {
+  MMU vm(128);
+  MemoryAllocator allocator(&vm);
+  SlabAllocator slab(&vm, &allocator);
+  uint32_t free_frames = allocator.get_page_frames_free();
+  std::vector<uint32_t> live;
+  std::set<uint32_t> addresses;
+  std::mt19937 rng(1);
+  for (int i = 0; i < 20000; ++i) {
+    if (live.empty() || rng() % 2) {
+      uint32_t size = 1 + rng() % SlabAllocator::max_object_size;
+      uint32_t address;
+      if (!slab.Allocate(size, address)) continue;
+      ASSERT_TRUE(addresses.insert(address).second);
+      uint32_t size_class = 0;
+      while (SlabAllocator::get_size_class_size(size_class) < size) ++size_class;
+      uint32_t object_size = SlabAllocator::get_size_class_size(size_class);
+      ASSERT_EQ(0, address % std::min<uint32_t>(64, object_size));
+      ASSERT_GE(kPageSize, (address & (kPageSize - 1)) + object_size);
+      live.push_back(address);
+    } else {
+      size_t index = rng() % live.size();
+      slab.Free(live[index]);
+      addresses.erase(live[index]);
+      live[index] = live.back();
+      live.pop_back();
+    }
+  }
+  for (auto address : live) slab.Free(address);
+  for (uint32_t c = 0; c < SlabAllocator::get_size_class_count(); ++c) {
+    SlabAllocator::SlabStats stats;
+    slab.get_stats(c, stats);
+    EXPECT_EQ(0, stats.objects_in_use);
+    EXPECT_GE(1, stats.slabs);
+  }
+  slab.ReleaseEmptySlabs();
+  EXPECT_EQ(free_frames, allocator.get_page_frames_free());
+}
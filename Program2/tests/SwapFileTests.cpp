@@ -0,0 +1,96 @@
+/*
+ * File:   SwapFileTests.cpp
+ */
+#include "../SwapFile.h"
+
+#include <gtest/gtest.h>
+
+#include <csignal>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <sys/resource.h>
+#include <vector>
+
+namespace {
+
+const char *kSwapFileName = "SwapFileTests.swap";
+const uint32_t kSlotSize = 512;
+
+}
+
+class SwapFileTests : public ::testing::Test {
+protected:
+  ~SwapFileTests() {
+    std::remove(kSwapFileName);
+  }
+};
+
+TEST_F(SwapFileTests, RoundTrip) {
+  for (uint32_t workers = 0; workers < 3; ++workers) {
+    SCOPED_TRACE(workers);
+    SwapFile swap(kSwapFileName, kSlotSize, workers, 8);
+    std::mt19937 rng(5);
+    std::vector<std::vector<uint8_t>> contents;
+    std::vector<uint32_t> live;
+    std::vector<uint8_t> data(kSlotSize);
+    for (int i = 0; i < 20000; ++i) {
+      int op = rng() % 10;
+      if (op < 4 || live.empty()) {
+        uint32_t slot = swap.AllocateSlot();
+        if (contents.size() <= slot) contents.resize(slot + 1);
+        contents[slot].assign(kSlotSize, uint8_t(rng()));
+        swap.WriteSlot(slot, contents[slot].data());
+        live.push_back(slot);
+      } else if (op < 6) {
+        uint32_t slot = live[rng() % live.size()];
+        contents[slot].assign(kSlotSize, uint8_t(rng()));
+        swap.WriteSlot(slot, contents[slot].data());
+      } else if (op < 9) {
+        uint32_t slot = live[rng() % live.size()];
+        swap.ReadSlot(slot, data.data());
+        ASSERT_EQ(contents[slot], data);
+      } else {
+        size_t index = rng() % live.size();
+        swap.FreeSlot(live[index]);
+        live[index] = live.back();
+        live.pop_back();
+      }
+    }
+    swap.Sync();
+    EXPECT_EQ(live.size(), swap.get_slots_used());
+    for (auto slot : live) {
+      swap.ReadSlot(slot, data.data());
+      ASSERT_EQ(contents[slot], data);
+    }
+  }
+}
+
+TEST_F(SwapFileTests, FailedWriteKeepsData) {
+  // Writes past 2 slots fail with EFBIG instead of raising SIGXFSZ
+  struct rlimit old_limit;
+  getrlimit(RLIMIT_FSIZE, &old_limit);
+  struct rlimit limit = old_limit;
+  limit.rlim_cur = 2 * kSlotSize;
+  ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &limit));
+  auto old_handler = std::signal(SIGXFSZ, SIG_IGN);
+  {
+    SwapFile swap(kSwapFileName, kSlotSize, 1);
+    std::vector<uint8_t> data(kSlotSize, 1);
+    swap.WriteSlot(0, data.data());
+    swap.WriteSlot(1, data.data());
+    swap.Sync();
+    std::vector<uint8_t> failed(kSlotSize, 5);
+    swap.WriteSlot(5, failed.data());
+    EXPECT_THROW(swap.Sync(), std::runtime_error);
+    
+    std::vector<uint8_t> read_back(kSlotSize);
+    swap.ReadSlot(5, read_back.data());
+    EXPECT_EQ(failed, read_back);
+    swap.ReadSlot(1, read_back.data());
+    EXPECT_EQ(data, read_back);
+    EXPECT_THROW(swap.WriteSlot(1, data.data()), std::runtime_error);
+  }
+  std::signal(SIGXFSZ, old_handler);
+  setrlimit(RLIMIT_FSIZE, &old_limit);
+}